@@ -17,13 +17,64 @@
 #include <metashell/parse_config.hpp>
 #include <metashell/config.hpp>
 #include <metashell/default_environment_detector.hpp>
+#include <metashell/cached_environment_detector.hpp>
+#include <metashell/startup_profile.hpp>
+#include <metashell/prebuilt_precompiled_headers.hpp>
 #include <metashell/shell.hpp>
 #include <metashell/console_config.hpp>
 #include <metashell/logger.hpp>
 #include <metashell/fstream_file_writer.hpp>
 
+#include <boost/algorithm/string/trim.hpp>
+
+#include <fstream>
 #include <iostream>
 #include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+  std::vector<std::string> read_metaprograms(const std::string& filename_)
+  {
+    std::ifstream f(filename_.c_str());
+    if (!f)
+    {
+      throw std::runtime_error("Error reading file " + filename_);
+    }
+
+    std::vector<std::string> result;
+    std::string line;
+    while (std::getline(f, line))
+    {
+      boost::algorithm::trim(line);
+      if (!line.empty())
+      {
+        result.push_back(line);
+      }
+    }
+    return result;
+  }
+
+  std::string toolchain_cache_dir(
+    const metashell::user_config& ucfg_,
+    metashell::iface::environment_detector& env_detector_
+  )
+  {
+    if (ucfg_.cache_enabled)
+    {
+      const std::string dir =
+        ucfg_.cache_dir.empty() ?
+          env_detector_.default_cache_dir() :
+          ucfg_.cache_dir;
+      return dir.empty() ? "" : dir + "/toolchain";
+    }
+    else
+    {
+      return "";
+    }
+  }
+}
 
 int main(int argc_, const char* argv_[])
 {
@@ -32,9 +83,13 @@ int main(int argc_, const char* argv_[])
     using metashell::parse_config;
     using metashell::parse_config_result;
 
+    metashell::startup_profile profile;
+
     const parse_config_result
       r = parse_config(argc_, argv_, &std::cout, &std::cerr);
 
+    profile.phase_finished("Parsing the arguments");
+
     metashell::console_config
       ccfg(r.cfg.con_type, r.cfg.indent, r.cfg.syntax_highlight);
 
@@ -56,31 +111,74 @@ int main(int argc_, const char* argv_[])
     METASHELL_LOG(&logger, "Start logging");
 
     metashell::default_environment_detector det(argv_[0], &logger);
-    const metashell::config cfg = detect_config(r.cfg, det, std::cerr, &logger);
+    metashell::cached_environment_detector
+      cached_det(det, toolchain_cache_dir(r.cfg, det), &logger);
+    const metashell::config
+      cfg =
+        detect_config(
+          r.cfg,
+          cached_det,
+          std::cerr,
+          &logger,
+          r.cfg.startup_profile ? &profile : nullptr
+        );
 
-    if (r.should_run_shell())
+    if (
+      r.should_run_shell() && !r.cfg.prebuild_precompiled_headers.empty()
+    )
+    {
+      METASHELL_LOG(&logger, "Prebuilding precompiled headers");
+
+      metashell::prebuild_precompiled_headers(
+        r.cfg,
+        cached_det,
+        r.cfg.prebuild_precompiled_headers,
+        ccfg.displayer(),
+        std::cerr,
+        &logger
+      );
+    }
+    else if (r.should_run_shell())
     {
       METASHELL_LOG(&logger, "Running shell");
 
       std::unique_ptr<metashell::shell>
         shell(new metashell::shell(cfg, ccfg.processor_queue(), &logger));
 
-      if (cfg.splash_enabled)
+      profile.phase_finished("Starting the shell");
+      if (r.cfg.startup_profile)
       {
-        shell->display_splash(ccfg.displayer());
+        profile.display(std::cerr);
       }
 
-      ccfg.processor_queue().push(move(shell));
+      if (r.cfg.batch_file.empty())
+      {
+        if (cfg.splash_enabled)
+        {
+          shell->display_splash(ccfg.displayer());
+        }
 
-      METASHELL_LOG(&logger, "Starting input loop");
-      
-      metashell::input_loop(
-        ccfg.processor_queue(),
-        ccfg.displayer(),
-        ccfg.reader()
-      );
+        ccfg.processor_queue().push(move(shell));
+
+        METASHELL_LOG(&logger, "Starting input loop");
+
+        metashell::input_loop(
+          ccfg.processor_queue(),
+          ccfg.displayer(),
+          ccfg.reader()
+        );
 
-      METASHELL_LOG(&logger, "Input loop finished");
+        METASHELL_LOG(&logger, "Input loop finished");
+      }
+      else
+      {
+        METASHELL_LOG(&logger, "Evaluating batch file " + r.cfg.batch_file);
+
+        shell->run_metaprograms(
+          read_metaprograms(r.cfg.batch_file),
+          ccfg.displayer()
+        );
+      }
     }
     else
     {
@@ -0,0 +1,81 @@
+#ifndef METASHELL_CACHED_ENVIRONMENT_DETECTOR_HPP
+#define METASHELL_CACHED_ENVIRONMENT_DETECTOR_HPP
+
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/logger.hpp>
+#include <metashell/iface/environment_detector.hpp>
+
+#include <boost/optional.hpp>
+
+#include <string>
+#include <vector>
+
+namespace metashell
+{
+  // Stores the results of the expensive checks of another detector (the
+  // ones running the Clang binary or libclang) in a directory, so later
+  // Metashell processes do not have to repeat them. The results belong to
+  // the path, modification time and size of the Clang binary and the
+  // version of libclang, thus they are not reused after any of them
+  // changes. The other checks are forwarded to the other detector.
+  class cached_environment_detector : public iface::environment_detector
+  {
+  public:
+    cached_environment_detector(
+      iface::environment_detector& detector_,
+      const std::string& directory_,
+      logger* logger_
+    );
+
+    virtual std::string search_clang_binary() override;
+    virtual bool file_exists(const std::string& path_) override;
+
+    virtual bool on_windows() override;
+    virtual bool on_osx() override;
+
+    virtual void append_to_path(const std::string& path_) override;
+
+    virtual std::vector<std::string> default_clang_sysinclude(
+      const std::string& clang_path_
+    ) override;
+    virtual std::vector<std::string> extra_sysinclude() override;
+
+    virtual std::string path_of_executable() override;
+
+    virtual bool clang_binary_works_with_libclang(const config& cfg_) override;
+
+    virtual std::string default_cache_dir() override;
+  private:
+    iface::environment_detector& _detector;
+    std::string _directory;
+    logger* _logger;
+
+    // Returns an empty string when the Clang binary can not be checked
+    std::string key(
+      const std::string& check_,
+      const std::string& clang_path_,
+      const std::vector<std::string>& args_
+    ) const;
+
+    boost::optional<std::vector<std::string>> find(const std::string& key_);
+    void store(const std::string& key_, const std::vector<std::string>& v_);
+  };
+}
+
+#endif
+
@@ -34,6 +34,10 @@ namespace metashell
 
     void cancel_operation();
     void line_available(const std::string& cmd_, iface::displayer& displayer_);
+    void lines_available(
+      const std::vector<std::string>& cmds_,
+      iface::displayer& displayer_
+    );
     void code_complete(
       const std::string& s_,
       std::set<std::string>& out_
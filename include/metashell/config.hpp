@@ -21,6 +21,7 @@
 #include <metashell/logger.hpp>
 #include <metashell/iface/environment_detector.hpp>
 
+#include <cstddef>
 #include <string>
 #include <vector>
 #include <iosfwd>
@@ -28,6 +29,7 @@
 namespace metashell
 {
   struct user_config;
+  class startup_profile;
 
   class config
   {
@@ -44,6 +46,18 @@ namespace metashell
     unsigned templight_trace_capacity;
     bool saving_enabled;
     bool splash_enabled;
+    std::size_t cache_memory_limit;
+    std::string cache_dir;
+    std::size_t cache_disc_limit;
+    std::size_t precompiled_header_cache_limit;
+    // The precompiled headers installed with Metashell
+    std::string prebuilt_precompiled_header_dir;
+    unsigned jobs;
+    bool subprocess_evaluation;
+    unsigned evaluation_timeout;
+    std::size_t evaluation_memory_limit;
+    bool watch_headers;
+    bool use_modules;
 
     config();
   };
@@ -52,7 +66,8 @@ namespace metashell
     const user_config& ucfg_,
     iface::environment_detector& env_detector_,
     std::ostream& stderr_,
-    logger* logger_
+    logger* logger_,
+    startup_profile* profile_ = nullptr
   );
 
   config empty_config(const std::string& argv0_);
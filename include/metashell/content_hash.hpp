@@ -0,0 +1,51 @@
+#ifndef METASHELL_CONTENT_HASH_HPP
+#define METASHELL_CONTENT_HASH_HPP
+
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <boost/uuid/sha1.hpp>
+
+#include <string>
+#include <vector>
+
+namespace metashell
+{
+  // Incrementally calculated SHA-1 hash of a sequence of strings. Every
+  // string is hashed together with its length, therefore adding "ab" and
+  // "c" is different from adding "a" and "bc".
+  class content_hash
+  {
+  public:
+    content_hash();
+
+    content_hash& add(const std::string& s_);
+    content_hash& add(const std::vector<std::string>& v_);
+
+    // Adds the characters without their length. Hashing the same characters
+    // in one or more calls to add_raw gives the same result.
+    content_hash& add_raw(const std::string& s_);
+
+    // Hexadecimal representation of the hash of everything added so far. The
+    // object can be extended further after calling it.
+    std::string digest() const;
+  private:
+    boost::uuids::detail::sha1 _sha1;
+  };
+}
+
+#endif
+
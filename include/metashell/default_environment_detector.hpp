@@ -45,6 +45,8 @@ namespace metashell
     virtual bool clang_binary_works_with_libclang(
       const config& clang_path_
     ) override;
+
+    virtual std::string default_cache_dir() override;
   private:
     std::string _argv0;
     logger* _logger;
@@ -18,13 +18,18 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <boost/utility.hpp>
+#include <boost/optional.hpp>
 
+#include <chrono>
+#include <memory>
 #include <string>
 #include <vector>
 
 namespace metashell
 {
+  class config;
   class headers;
+  class logger;
 
   class environment : boost::noncopyable
   {
@@ -46,7 +51,46 @@ namespace metashell
     virtual const headers& get_headers() const = 0;
 
     // Returns parts that are in precompiled header files as well
-    virtual std::string get_all() const = 0;
+    virtual const std::string& get_all() const = 0;
+
+    // The hash of what get_all returns. It is maintained while the
+    // environment is extended, thus it is cheap to get.
+    virtual std::string get_all_digest() const = 0;
+
+    // The hash of the content of the headers the precompiled parts of the
+    // environment were built from. It is empty when they are not known.
+    virtual std::string get_dependencies_digest() const = 0;
+
+    // False when the environment may include headers that are not covered
+    // by the digest of the dependencies (eg. by the parts of the environment
+    // that are not precompiled). The results of the evaluations can not be
+    // cached then, since the changes of those headers would not be noticed.
+    virtual bool dependencies_known() const = 0;
+
+    // Environments doing work in the background start using its results.
+    // When wait_ is true, the work in progress is finished first. The
+    // environment does not change between two update calls.
+    virtual void update(bool wait_) = 0;
+
+    // Makes the environment use the current content of the headers it has
+    // built something from. Returns false when none of them has changed.
+    virtual bool reload() = 0;
+
+    // Creates an environment with the same content to be extended while
+    // this one is kept unchanged. It returns null when the environment has
+    // nothing worth sharing and the new one should be built from get_all.
+    virtual std::unique_ptr<environment> create_successor(
+      const config& config_,
+      logger* logger_
+    ) const = 0;
+
+    // Starts precompiling the environment in the background when it
+    // supports precompiled headers.
+    virtual void precompile_in_background() = 0;
+
+    virtual bool rebuilding_precompiled_header() const = 0;
+    virtual boost::optional<std::chrono::milliseconds> last_rebuild_time()
+      const = 0;
   };
 }
 
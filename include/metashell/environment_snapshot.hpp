@@ -0,0 +1,90 @@
+#ifndef METASHELL_ENVIRONMENT_SNAPSHOT_HPP
+#define METASHELL_ENVIRONMENT_SNAPSHOT_HPP
+
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/environment.hpp>
+#include <metashell/headers.hpp>
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace metashell
+{
+  // What the evaluation of a metaprogram needs from an environment. It can
+  // be serialised, thus a process that has not built the environment can
+  // evaluate metaprograms in it. The snapshot can not be extended.
+  class environment_snapshot : public environment
+  {
+  public:
+    environment_snapshot();
+    explicit environment_snapshot(const environment& env_);
+
+    virtual void append(const std::string& s_) override;
+    virtual std::string get() const override;
+    virtual std::string get_appended(const std::string& s_) const override;
+
+    virtual std::string internal_dir() const override;
+
+    virtual std::vector<std::string>& clang_arguments() override;
+    virtual const std::vector<std::string>& clang_arguments() const override;
+
+    virtual const headers& get_headers() const override;
+
+    virtual const std::string& get_all() const override;
+    virtual std::string get_all_digest() const override;
+    virtual std::string get_dependencies_digest() const override;
+    virtual bool dependencies_known() const override;
+
+    virtual void update(bool wait_) override;
+    virtual bool reload() override;
+    virtual std::unique_ptr<environment> create_successor(
+      const config& config_,
+      logger* logger_
+    ) const override;
+    virtual void precompile_in_background() override;
+    virtual bool rebuilding_precompiled_header() const override;
+    virtual boost::optional<std::chrono::milliseconds> last_rebuild_time()
+      const override;
+
+    friend void write_environment(
+      std::ostream& out_,
+      const environment_snapshot& env_
+    );
+    friend bool read_environment(
+      std::istream& in_,
+      environment_snapshot& env_
+    );
+  private:
+    std::string _content;
+    // What the environments put in front of the appended code
+    std::string _prefix;
+    std::string _all;
+    std::string _all_digest;
+    std::string _dependencies_digest;
+    bool _dependencies_known;
+    headers _headers;
+    std::vector<std::string> _clang_args;
+  };
+
+  void write_environment(std::ostream& out_, const environment_snapshot& env_);
+  bool read_environment(std::istream& in_, environment_snapshot& env_);
+}
+
+#endif
+
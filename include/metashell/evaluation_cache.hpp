@@ -0,0 +1,104 @@
+#ifndef METASHELL_EVALUATION_CACHE_HPP
+#define METASHELL_EVALUATION_CACHE_HPP
+
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/environment.hpp>
+#include <metashell/result.hpp>
+#include <metashell/persistent_evaluation_cache.hpp>
+#include <metashell/logger.hpp>
+
+#include <boost/optional.hpp>
+
+#include <cstddef>
+#include <list>
+#include <map>
+#include <string>
+
+namespace metashell
+{
+  // Stores the results of earlier evaluations. When the memory used by the
+  // stored results exceeds the limit, the least recently used ones are
+  // dropped. The results can also be stored on disc to make them available
+  // for other Metashell processes.
+  class evaluation_cache
+  {
+  public:
+    explicit evaluation_cache(std::size_t memory_limit_);
+
+    // An empty directory_ disables storing the results on disc
+    evaluation_cache(
+      std::size_t memory_limit_,
+      const std::string& directory_,
+      std::size_t disc_limit_,
+      logger* logger_
+    );
+
+    static std::string key(
+      const environment& env_,
+      const std::string& tmp_exp_,
+      const std::string& input_filename_,
+      bool formatted_,
+      bool verbose_
+    );
+
+    boost::optional<result> find(const std::string& key_);
+    void store(const std::string& key_, const result& result_);
+
+    void clear();
+
+    bool enabled() const;
+
+    unsigned hits() const;
+    unsigned disc_hits() const;
+    unsigned misses() const;
+
+    std::size_t size() const;
+    std::size_t memory_usage() const;
+    std::size_t memory_limit() const;
+
+    const persistent_evaluation_cache* on_disc() const;
+  private:
+    struct entry
+    {
+      std::string key;
+      result value;
+      std::size_t memory;
+    };
+
+    // The most recently used entry is at the front
+    typedef std::list<entry> entry_list;
+
+    entry_list _entries;
+    std::map<std::string, entry_list::iterator> _index;
+
+    std::size_t _memory_usage;
+    std::size_t _memory_limit;
+
+    boost::optional<persistent_evaluation_cache> _on_disc;
+
+    unsigned _hits;
+    unsigned _disc_hits;
+    unsigned _misses;
+
+    void store_in_memory(const std::string& key_, const result& result_);
+    void drop_least_recently_used();
+  };
+}
+
+#endif
+
@@ -0,0 +1,56 @@
+#ifndef METASHELL_EVALUATION_POOL_HPP
+#define METASHELL_EVALUATION_POOL_HPP
+
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/config.hpp>
+#include <metashell/environment.hpp>
+#include <metashell/evaluation_session.hpp>
+#include <metashell/logger.hpp>
+#include <metashell/result.hpp>
+
+#include <boost/utility.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace metashell
+{
+  // Evaluates metaprograms on multiple threads. Every worker has its own
+  // libclang index and keeps its translation unit between the batches.
+  class evaluation_pool : boost::noncopyable
+  {
+  public:
+    evaluation_pool(unsigned size_, logger* logger_);
+
+    unsigned size() const;
+
+    // The results are in the order of the metaprograms
+    std::vector<result> eval_tmp_batch(
+      const environment& env_,
+      const std::vector<std::string>& tmp_exps_,
+      const config& config_,
+      const std::string& input_filename_
+    );
+  private:
+    std::vector<std::unique_ptr<evaluation_session>> _workers;
+  };
+}
+
+#endif
+
@@ -0,0 +1,76 @@
+#ifndef METASHELL_EVALUATION_SESSION_HPP
+#define METASHELL_EVALUATION_SESSION_HPP
+
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/environment.hpp>
+#include <metashell/unsaved_file.hpp>
+#include <metashell/logger.hpp>
+
+#include <boost/utility.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace metashell
+{
+  class cxindex;
+  class cxtranslationunit;
+
+  // Keeps a libclang index and the last translation unit alive between
+  // evaluations. As long as only the content of the main file changes, the
+  // translation unit is reparsed instead of being built from scratch.
+  class evaluation_session : boost::noncopyable
+  {
+  public:
+    explicit evaluation_session(logger* logger_ = nullptr);
+    ~evaluation_session();
+
+    // The result is valid until the next parse_code or reset call
+    cxtranslationunit& parse_code(
+      const unsaved_file& src_,
+      const environment& env_
+    );
+
+    // Drops the translation unit. The next parse_code call parses the code
+    // from scratch.
+    void reset();
+
+    bool has_translation_unit() const;
+
+    logger* get_logger() const;
+  private:
+    std::unique_ptr<cxindex> _index;
+    std::unique_ptr<cxtranslationunit> _tu;
+
+    // The input of the translation unit in _tu
+    std::string _filename;
+    std::vector<std::string> _clang_args;
+    std::vector<unsaved_file> _headers;
+    std::string _env_digest;
+    std::string _dependencies_digest;
+
+    logger* _logger;
+
+    bool can_reparse(const unsaved_file& src_, const environment& env_) const;
+    void remember_input(const unsaved_file& src_, const environment& env_);
+  };
+}
+
+#endif
+
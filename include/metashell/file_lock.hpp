@@ -0,0 +1,61 @@
+#ifndef METASHELL_FILE_LOCK_HPP
+#define METASHELL_FILE_LOCK_HPP
+
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <boost/utility.hpp>
+
+#include <string>
+
+namespace metashell
+{
+  // Advisory lock of a file shared with other Metashell processes. The lock
+  // belongs to the object, thus it works between the threads of the same
+  // process as well. The file is created when it does not exist.
+  class file_lock : boost::noncopyable
+  {
+  public:
+    enum class mode
+    {
+      shared,
+      exclusive
+    };
+
+    // Waits for the lock. Throws an exception when the file can not be
+    // opened.
+    file_lock(const std::string& path_, mode mode_);
+
+    ~file_lock();
+
+    // Returns nullptr when the file can not be locked without waiting
+    static file_lock* try_lock(const std::string& path_, mode mode_);
+
+    const std::string& path() const;
+  private:
+    std::string _path;
+#ifdef _WIN32
+    void* _handle;
+#else
+    int _fd;
+#endif
+
+    file_lock(const std::string& path_, mode mode_, bool wait_, bool* locked_);
+  };
+}
+
+#endif
+
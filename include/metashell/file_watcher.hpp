@@ -0,0 +1,72 @@
+#ifndef METASHELL_FILE_WATCHER_HPP
+#define METASHELL_FILE_WATCHER_HPP
+
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/logger.hpp>
+
+#include <boost/utility.hpp>
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace metashell
+{
+  // Notices the changes of files using inotify. The directories of the files
+  // are watched, thus replacing a file (which is what most editors do) is
+  // noticed as well. On other platforms it never notices anything.
+  class file_watcher : boost::noncopyable
+  {
+  public:
+    // When changed_ is set, the changes are waited for by a background
+    // thread calling changed_ for them. It is not called after the
+    // destructor has started.
+    explicit file_watcher(
+      logger* logger_,
+      const std::function<void ()>& changed_ = std::function<void ()>()
+    );
+    ~file_watcher();
+
+    // Replaces the set of watched files
+    void watch(const std::vector<std::string>& files_);
+
+    // Checks (without blocking) if any of the directories of the watched
+    // files has changed since the last call.
+    bool changed();
+  private:
+    logger* _logger;
+    int _fd;
+    std::vector<int> _watches;
+
+    std::function<void ()> _changed_callback;
+    // Written to stop the background thread
+    int _stop_fds[2];
+    std::thread _thread;
+    // Set by the background thread, cleared by changed
+    std::atomic<bool> _changed;
+
+    void remove_watches();
+    bool read_events();
+    void wait_for_events();
+  };
+}
+
+#endif
+
@@ -0,0 +1,88 @@
+#ifndef METASHELL_HEADER_DEPENDENCIES_HPP
+#define METASHELL_HEADER_DEPENDENCIES_HPP
+
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/content_hash.hpp>
+
+#include <cstdint>
+#include <ctime>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace metashell
+{
+  // The header files something was built from, together with their size,
+  // modification time and the hash of their content at that time.
+  class header_dependencies
+  {
+  public:
+    header_dependencies();
+
+    // Records the current state of the file. Files that can not be read are
+    // recorded as missing ones.
+    void add(const std::string& path_);
+
+    // Checks if any of the files has changed since it was added. The
+    // content of a file is checked only when its size or modification time
+    // is different or when it was modified around the time it was added.
+    bool changed() const;
+
+    // The hash of the names and the recorded content of the files
+    std::string digest() const;
+
+    std::vector<std::string> paths() const;
+
+    bool empty() const;
+
+    friend void write_header_dependencies(
+      std::ostream& out_,
+      const header_dependencies& deps_
+    );
+    friend bool read_header_dependencies(
+      std::istream& in_,
+      header_dependencies& deps_
+    );
+  private:
+    struct header
+    {
+      std::string path;
+      bool exists;
+      std::time_t modified;
+      std::uintmax_t size;
+      std::string content_digest;
+      std::time_t recorded;
+    };
+
+    std::vector<header> _headers;
+    content_hash _hash;
+
+    static header current_state(const std::string& path_);
+  };
+
+  // Serialisation of the recorded state to store it next to a cached
+  // precompiled header
+  void write_header_dependencies(
+    std::ostream& out_,
+    const header_dependencies& deps_
+  );
+  bool read_header_dependencies(std::istream& in_, header_dependencies& deps_);
+}
+
+#endif
+
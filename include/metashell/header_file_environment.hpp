@@ -19,16 +19,63 @@
 
 #include <metashell/in_memory_environment.hpp>
 #include <metashell/headers.hpp>
+#include <metashell/header_dependencies.hpp>
+#include <metashell/file_watcher.hpp>
+#include <metashell/file_lock.hpp>
+#include <metashell/precompiled_header_cache.hpp>
 
 #include <just/temp.hpp>
 
+#include <boost/optional.hpp>
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
 namespace metashell
 {
+  // When precompiled headers are used, the environment is stored in two
+  // layers: a precompiled header and a tail which is parsed by every
+  // evaluation. Appending to the environment extends the tail and the
+  // precompiled header is rebuilt only when the tail gets too long or
+  // headers are included, thus appending a small definition is cheap.
+  // The precompiled header is rebuilt on a background thread. The new one
+  // replaces the old one (and the tail gets shorter) in update. The
+  // temporary directory is shared with the environments using its
+  // precompiled header. The headers the precompiled header was built from
+  // are recorded, thus it is rebuilt only when they change. The precompiled
+  // headers can be stored in a cache shared with other Metashell processes.
   class header_file_environment : public environment
   {
   public:
+    // The result of building a precompiled header
+    struct precompiled_header
+    {
+      std::chrono::milliseconds build_time;
+      header_dependencies dependencies;
+      // The header to include
+      std::string header;
+      // Set when the precompiled header is in the shared cache
+      std::shared_ptr<file_lock> lock;
+    };
+
     header_file_environment(const config& config_, logger* logger_);
 
+    // Creates an environment with the same content as base_ has. It uses the
+    // precompiled header of base_ until it builds its own one, thus no
+    // compilation is needed. base_ should not change while the new
+    // environment is in use.
+    header_file_environment(
+      const header_file_environment& base_,
+      const config& config_,
+      logger* logger_
+    );
+
+    virtual ~header_file_environment();
+
     virtual void append(const std::string& s_) override;
     virtual std::string get() const override;
     virtual std::string get_appended(const std::string& s_) const override;
@@ -40,18 +87,94 @@ namespace metashell
 
     virtual const headers& get_headers() const override;
 
-    virtual std::string get_all() const override;
+    virtual const std::string& get_all() const override;
+    virtual std::string get_all_digest() const override;
+    virtual std::string get_dependencies_digest() const override;
+    virtual bool dependencies_known() const override;
+
+    virtual void update(bool wait_) override;
+
+    // Rebuilds the precompiled header when a header it was built from has
+    // changed. Returns if it has rebuilt it.
+    virtual bool reload() override;
+
+    // The successor shares the precompiled header of this environment
+    virtual std::unique_ptr<environment> create_successor(
+      const config& config_,
+      logger* logger_
+    ) const override;
+
+    // Starts building a precompiled header of the tail in the background
+    // unless a build is already running. The tail is used until it is ready.
+    virtual void precompile_in_background() override;
+
+    virtual bool rebuilding_precompiled_header() const override;
+    virtual boost::optional<std::chrono::milliseconds> last_rebuild_time()
+      const override;
   private:
-    just::temp::directory _dir;
+    std::shared_ptr<just::temp::directory> _dir;
     in_memory_environment _buffer;
     std::vector<std::string> _clang_args;
-    headers _empty_headers;
+    headers _headers;
 
     bool _use_precompiled_headers;
-    std::string _clang_path;
 
-    void save();
+    std::string _tail;
+    int _tail_layers;
+
+    // The header the precompiled header in use was built from and the
+    // directory it is in. When the precompiled header is in the cache, the
+    // directory is null and the lock keeps it there. The precompiled headers
+    // installed with Metashell are never deleted, thus they are not locked.
+    std::string _precompiled;
+    std::shared_ptr<just::temp::directory> _precompiled_dir;
+    std::shared_ptr<file_lock> _precompiled_lock;
+    precompiled_header_cache _cache;
+    // The precompiled headers built when Metashell was installed
+    precompiled_header_cache _prebuilt;
+    boost::optional<std::chrono::milliseconds> _last_rebuild_time;
+    header_dependencies _dependencies;
+
+    // Guards the members used by the thread of the watcher. It starts the
+    // rebuilds when the dependencies change.
+    mutable std::mutex _mutex;
+
+    // Notices the changes of the dependencies in watch mode
+    std::unique_ptr<file_watcher> _watcher;
+    bool _dependencies_modified;
+
+    // The number of rebuilds caused by changed dependencies. The header is
+    // the same, thus it is used to give the precompiled header a new name.
+    int _reloads;
+
+    // The precompiled header being built and the header it is built from
+    std::future<precompiled_header> _rebuild;
+    std::string _rebuilt;
+
+    // The part of the tail not in the precompiled header being built
+    std::string _tail_since_rebuild;
+    int _layers_since_rebuild;
+    // The environment has changed since the rebuild in progress started.
+    // The next rebuild is started when it finishes.
+    bool _rebuild_requested;
+    // The last rebuild failed. Only the number of layers in the tail
+    // triggers the next one.
+    bool _rebuild_failed;
+
+    void update_headers();
+    void request_rebuild();
+    void start_rebuild();
+    void finish_rebuild();
+    void finish_rebuilds(bool wait_);
+    void dependencies_changed();
+    void check_dependencies();
+    void use_precompiled_header(
+      const std::string& fn_,
+      const std::shared_ptr<just::temp::directory>& dir_,
+      const std::shared_ptr<file_lock>& lock_
+    );
     std::string env_filename() const;
+    std::string tail_filename() const;
   };
 }
 
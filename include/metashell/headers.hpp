@@ -18,6 +18,7 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <metashell/unsaved_file.hpp>
+#include <metashell/content_hash.hpp>
 
 #include <clang-c/Index.h>
 
@@ -41,14 +42,18 @@ namespace metashell
 
     size_type size() const;
 
-    void generate() const;
-
     const std::string& internal_dir() const;
+
+    void add(const std::string& filename_, const std::string& content_);
+
+    // The hash of the names and the content of the headers. The internal
+    // directory is left out of the names, since it is different in every
+    // Metashell process. It is maintained while the headers are added.
+    std::string digest() const;
   private:
     std::vector<unsaved_file> _headers;
     std::string _internal_dir;
-
-    void add(const std::string& filename_, const std::string& content_);
+    content_hash _hash;
   };
 }
 
@@ -22,6 +22,7 @@
 
 #include <string>
 #include <set>
+#include <vector>
 
 namespace metashell
 {
@@ -39,6 +40,20 @@ namespace metashell
       ) = 0;
       virtual void cancel_operation() = 0;
 
+      // The lines are processed one by one unless the processor can handle
+      // the independent ones together
+      virtual void lines_available(
+        const std::vector<std::string>& cmds_,
+        iface::displayer& displayer_,
+        iface::history& history_
+      )
+      {
+        for (const std::string& cmd : cmds_)
+        {
+          line_available(cmd, displayer_, history_);
+        }
+      }
+
       virtual std::string prompt() const = 0;
       virtual bool stopped() const = 0;
 
@@ -49,6 +49,9 @@ namespace metashell
       virtual std::string path_of_executable() = 0;
 
       virtual bool clang_binary_works_with_libclang(const config& cfg_) = 0;
+
+      // Returns an empty string when no suitable directory is found
+      virtual std::string default_cache_dir() = 0;
     };
   }
 }
@@ -18,6 +18,7 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <metashell/environment.hpp>
+#include <metashell/content_hash.hpp>
 #include <metashell/headers.hpp>
 #include <metashell/logger.hpp>
 
@@ -50,11 +51,26 @@ namespace metashell
 
     void add_clang_arg(const std::string& arg_);
 
-    virtual std::string get_all() const override;
+    virtual const std::string& get_all() const override;
+    virtual std::string get_all_digest() const override;
+    virtual std::string get_dependencies_digest() const override;
+    virtual bool dependencies_known() const override;
+
+    virtual void update(bool wait_) override;
+    virtual bool reload() override;
+    virtual std::unique_ptr<environment> create_successor(
+      const config& config_,
+      logger* logger_
+    ) const override;
+    virtual void precompile_in_background() override;
+    virtual bool rebuilding_precompiled_header() const override;
+    virtual boost::optional<std::chrono::milliseconds> last_rebuild_time()
+      const override;
 
     logger* get_logger();
   private:
     std::string _buffer;
+    content_hash _buffer_hash;
     headers _headers;
     std::vector<std::string> _clang_args;
     logger* _logger;
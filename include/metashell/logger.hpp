@@ -21,6 +21,7 @@
 #include <metashell/iface/displayer.hpp>
 #include <metashell/iface/file_writer.hpp>
 
+#include <mutex>
 #include <string>
 
 namespace metashell
@@ -42,6 +43,8 @@ namespace metashell
     logging_mode _mode;
     iface::file_writer& _fwriter;
     iface::displayer& _displayer;
+    // The evaluation workers log from multiple threads
+    std::mutex _mutex;
   };
 }
 
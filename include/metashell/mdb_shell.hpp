@@ -17,7 +17,11 @@
 // You should have received a copy of the GNU General Public License
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
+#include <memory>
+#include <mutex>
+#include <set>
 #include <string>
+#include <vector>
 
 #include <boost/regex.hpp>
 #include <boost/optional.hpp>
@@ -26,6 +30,7 @@
 #include <metashell/metaprogram.hpp>
 #include <metashell/colored_string.hpp>
 #include <metashell/templight_environment.hpp>
+#include <metashell/templight_trace_reader.hpp>
 #include <metashell/mdb_command_handler_map.hpp>
 #include <metashell/logger.hpp>
 
@@ -98,14 +103,33 @@ protected:
     iface::displayer& displayer_
   );
 
+  // The metaprogram can be used only while it is locked, because it is
+  // being loaded in the background
+  std::unique_lock<templight_trace_reader> lock_metaprogram();
+
   bool is_wrap_type(const std::string& type);
   std::string trim_wrap_type(const std::string& type);
 
-  void filter_disable_everything();
-  void filter_enable_reachable_from_current_line();
-  void filter_unwrap_vertices();
-  void filter_similar_edges();
-  void filter_metaprogram();
+  // Orders the edges by the properties making them similar
+  struct similar_edge_less {
+    const metaprogram* mp;
+
+    bool operator()(
+      metaprogram::edge_descriptor lhs,
+      metaprogram::edge_descriptor rhs
+    ) const;
+  };
+
+  typedef
+    std::set<metaprogram::edge_descriptor, similar_edge_less>
+    similar_edges_t;
+
+  // The filters are applied to the edges while they are loaded
+  void filter_reset();
+  void filter_vertex(metaprogram::vertex_descriptor vertex);
+  void filter_edge(metaprogram::edge_descriptor edge);
+  void filter_enable_reachable_from(metaprogram::vertex_descriptor vertex);
+  bool is_followed_by_filter(metaprogram::edge_descriptor edge) const;
 
   breakpoints_t::iterator continue_metaprogram(
       metaprogram::direction_t direction);
@@ -121,13 +145,30 @@ protected:
     iface::displayer& displayer_
   ) const;
   void display_metaprogram_finished(iface::displayer& displayer_) const;
+  void display_loading_error(iface::displayer& displayer_);
 
   config conf;
   templight_environment env;
+  // Set to false when the templight in use can not write binary traces
+  bool binary_trace = true;
 
   boost::optional<metaprogram> mp;
+  // Declared after mp, because it has to stop loading before mp is
+  // destroyed
+  std::unique_ptr<templight_trace_reader> trace;
   breakpoints_t breakpoints;
 
+  // The state of the filters
+  int filter_line = 0;
+  std::vector<bool> filter_wrapped_vertices;
+  std::vector<bool> filter_non_template_vertices;
+  std::vector<bool> filter_reachable_vertices;
+  // Only the out edges of the root and the reachable vertices are stored
+  std::vector<similar_edges_t> filter_similar_edges;
+  // The edges which are followed although their kind has been changed to
+  // non_template_type
+  std::set<metaprogram::edge_descriptor> filter_non_template_edges;
+
   std::string prev_line;
   bool last_command_repeatable = false;
 
@@ -23,12 +23,14 @@
 #include <vector>
 
 #include <boost/optional.hpp>
+#include <boost/utility/string_ref.hpp>
 #include <boost/graph/graph_traits.hpp>
 #include <boost/graph/adjacency_list.hpp>
 
 #include <metashell/file_location.hpp>
 #include <metashell/instantiation_kind.hpp>
 #include <metashell/backtrace.hpp>
+#include <metashell/string_table.hpp>
 #include <metashell/type.hpp>
 
 namespace metashell {
@@ -62,6 +64,34 @@ public:
       const std::string& root_name,
       const type& evaluation_result);
 
+  // Reads the binary trace format of templight. The file is memory mapped.
+  static metaprogram create_from_binary_file(
+      const std::string& file,
+      bool full_mode,
+      const std::string& root_name,
+      const type& evaluation_result);
+
+  static metaprogram create_from_binary_string(
+      const std::string& string,
+      bool full_mode,
+      const std::string& root_name,
+      const type& evaluation_result);
+
+  // Processes the events as they arrive, thus it can read a trace that is
+  // still being written.
+  static metaprogram create_from_binary_stream(
+      std::istream& stream,
+      bool full_mode,
+      const std::string& root_name,
+      const type& evaluation_result);
+
+  // Checks if the first bytes of a trace (at least 8) are the beginning of
+  // a binary templight trace. Templight versions without binary support
+  // write their default format instead.
+  static bool is_binary_trace(const std::string& beginning);
+
+  static bool is_binary_trace_file(const std::string& file);
+
   struct vertex_property_tag {
     typedef boost::vertex_property_tag kind;
   };
@@ -69,8 +99,10 @@ public:
     typedef boost::edge_property_tag kind;
   };
 
+  // The name is an id in the string table of the metaprogram. Traces of
+  // big metaprograms have a lot of long template names.
   struct vertex_property {
-    std::string name;
+    string_table::id name;
   };
   struct edge_property {
     instantiation_kind kind;
@@ -104,10 +136,23 @@ public:
   typedef std::vector<optional_edge_descriptor> parent_edge_t;
   typedef std::stack<optional_edge_descriptor> edge_stack_t;
 
+  // The out edges of a vertex which is still open (its instantiation is
+  // still being loaded) are pushed onto the edge stack in multiple rounds.
+  // The next round is pushed when the traversal gets back to the edge stack
+  // size the previous round was pushed onto.
+  struct continuation_t {
+    vertex_descriptor vertex;
+    degree_size_type next_edge;
+    std::size_t edge_stack_size;
+  };
+
+  typedef std::stack<continuation_t> continuation_stack_t;
+
   struct state_t {
     discovered_t discovered;
     parent_edge_t parent_edge;
     edge_stack_t edge_stack;
+    continuation_stack_t continuations;
   };
 
   struct step_rollback_t {
@@ -115,11 +160,35 @@ public:
     optional_vertex_descriptor discovered_vertex;
     unsigned edge_stack_push_count = 0;
     boost::optional<optional_edge_descriptor> set_parent_edge;
+    // The continuations below this are not changed by the step. The ones
+    // above it before the step are stored in removed_continuations (top
+    // first).
+    std::size_t continuations_kept = 0;
+    std::vector<continuation_t> removed_continuations;
   };
 
   typedef std::stack<step_rollback_t> state_history_t;
 
-  vertex_descriptor add_vertex(const std::string& element);
+  // The metaprogram can be debugged while its trace is being loaded. The
+  // loader adds the rest of the vertices and edges.
+  class loader {
+  public:
+    virtual ~loader() {}
+
+    // An open vertex may get new out edges
+    virtual bool is_open(vertex_descriptor vertex) const = 0;
+
+    // Blocks until more events of the trace are processed. Returns false
+    // when the whole trace has been processed.
+    virtual bool wait_for_more_events() = 0;
+  };
+
+  // Vertices with already interned names can be added without looking the
+  // name up again
+  string_table::id intern_name(boost::string_ref name);
+
+  vertex_descriptor add_vertex(boost::string_ref element);
+  vertex_descriptor add_vertex(string_table::id element);
 
   edge_descriptor add_edge(
       vertex_descriptor from,
@@ -129,6 +198,17 @@ public:
 
   const type& get_evaluation_result() const;
 
+  // The trace can be processed before the evaluation finishes
+  void set_evaluation_result(const type& result);
+
+  // The loader is used until the whole trace is processed. It has to
+  // outlive that. nullptr means that the metaprogram is fully loaded.
+  void set_loader(loader* loader_);
+
+  // Waits until the instantiations made by the vertex are loaded. The
+  // root vertex is loaded when the whole trace is.
+  void wait_until_loaded(vertex_descriptor vertex);
+
   void reset_state();
 
   bool is_in_full_mode() const;
@@ -184,6 +264,10 @@ public:
   edge_property& get_edge_property(
       edge_descriptor edge);
 
+  // The result is valid while the metaprogram exists
+  boost::string_ref get_vertex_name(vertex_descriptor vertex) const;
+  void set_vertex_name(vertex_descriptor vertex, boost::string_ref name);
+
   frame to_frame(const edge_descriptor& e_) const;
 
 private:
@@ -193,13 +277,26 @@ private:
   unsigned get_full_traversal_count_helper(
       vertex_descriptor vertex, traversal_counts_t& traversal_counts) const;
 
+  bool is_open(vertex_descriptor vertex) const;
+  bool wait_for_more_events();
+
+  unsigned push_out_edges(
+      vertex_descriptor vertex,
+      degree_size_type begin,
+      degree_size_type end);
+  unsigned continue_open_vertices(step_rollback_t& rollback);
+  void save_top_continuation(step_rollback_t& rollback);
+
   graph_t graph;
+  string_table names;
 
   state_t state;
   state_history_t state_history;
 
   bool full_mode;
 
+  loader* trace_loader = nullptr;
+
   // This should be generally 0
   vertex_descriptor root_vertex;
 
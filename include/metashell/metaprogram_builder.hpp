@@ -0,0 +1,95 @@
+#ifndef METASHELL_METAPROGRAM_BUILDER_HPP
+#define METASHELL_METAPROGRAM_BUILDER_HPP
+
+
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2014, Andras Kucsma (andras.kucsma@gmail.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <functional>
+#include <istream>
+#include <stack>
+#include <string>
+#include <vector>
+
+#include <metashell/metaprogram.hpp>
+#include <metashell/file_location.hpp>
+#include <metashell/instantiation_kind.hpp>
+
+namespace metashell {
+
+// Builds a metaprogram from the events of a templight trace
+struct metaprogram_builder {
+
+  typedef
+    std::function<void (metaprogram::edge_descriptor)>
+    edge_added_callback;
+
+  // The vertices and edges are added to mp. edge_added is called after
+  // every new edge.
+  explicit metaprogram_builder(
+      metaprogram& mp,
+      const edge_added_callback& edge_added = edge_added_callback());
+
+  virtual ~metaprogram_builder() {}
+
+  virtual void handle_template_begin(
+    instantiation_kind kind,
+    const std::string& context,
+    const file_location& location,
+    double timestamp,
+    unsigned long long memory_usage);
+
+  virtual void handle_template_end(
+    instantiation_kind kind,
+    double timestamp,
+    unsigned long long memory_usage);
+
+  // Called after the last event. It throws when the trace is incomplete.
+  void finish() const;
+
+  // The instantiation of an open vertex has not ended yet, thus it can
+  // still get new out edges. The root vertex is not tracked.
+  bool is_open(metaprogram::vertex_descriptor vertex) const;
+
+private:
+  typedef metaprogram::vertex_descriptor vertex_descriptor;
+
+  vertex_descriptor add_vertex(const std::string& context);
+
+  metaprogram& mp;
+  edge_added_callback edge_added;
+
+  std::stack<vertex_descriptor> vertex_stack;
+
+  // The number of times a vertex is on vertex_stack
+  std::vector<unsigned> open_count;
+
+  // The vertex of a context by the id of its interned name. The names of
+  // the vertices may change after they are added, thus the ids of the
+  // contexts are tracked here. Ids without a vertex (eg. the root name) are
+  // mapped to no_vertex.
+  std::vector<vertex_descriptor> element_vertex_map;
+};
+
+// Read the events of a trace and pass them to the builder while the trace
+// is being read. They throw when the trace is invalid.
+void read_xml_trace(std::istream& stream, metaprogram_builder& builder);
+void read_binary_trace(std::istream& stream, metaprogram_builder& builder);
+
+}
+
+#endif
+
@@ -21,9 +21,12 @@
 #include <metashell/environment.hpp>
 #include <metashell/command.hpp>
 #include <metashell/logger.hpp>
+#include <metashell/evaluation_session.hpp>
+#include <metashell/evaluation_cache.hpp>
 
 #include "result.hpp"
 
+#include <functional>
 #include <set>
 #include <string>
 #include <vector>
@@ -38,6 +41,40 @@ namespace metashell
     logger* logger_
   );
 
+  result eval_tmp_unformatted(
+    const environment& env_,
+    const std::string& tmp_exp_,
+    const config& config_,
+    const std::string& input_filename_,
+    evaluation_session& session_
+  );
+
+  // The versions taking a cache return earlier results of the same
+  // evaluation when the environment is in a precompiled header
+  result eval_tmp_unformatted(
+    const environment& env_,
+    const std::string& tmp_exp_,
+    const config& config_,
+    const std::string& input_filename_,
+    evaluation_session& session_,
+    evaluation_cache& cache_
+  );
+
+  // Returns the result of an earlier evaluation of the same metaprogram in
+  // the same environment or calls evaluate_ and stores its result. evaluate_
+  // can set its argument to false to prevent storing the result (eg. when
+  // the evaluation timed out).
+  result cached_evaluation(
+    evaluation_cache& cache_,
+    const environment& env_,
+    const std::string& tmp_exp_,
+    const config& config_,
+    const std::string& input_filename_,
+    bool formatted_,
+    logger* logger_,
+    const std::function<result (bool&)>& evaluate_
+  );
+
   result eval_tmp_formatted(
     const environment& env_,
     const std::string& tmp_exp_,
@@ -46,6 +83,33 @@ namespace metashell
     logger* logger_
   );
 
+  result eval_tmp_formatted(
+    const environment& env_,
+    const std::string& tmp_exp_,
+    const config& config_,
+    const std::string& input_filename_,
+    evaluation_session& session_
+  );
+
+  result eval_tmp_formatted(
+    const environment& env_,
+    const std::string& tmp_exp_,
+    const config& config_,
+    const std::string& input_filename_,
+    evaluation_session& session_,
+    evaluation_cache& cache_
+  );
+
+  // Evaluates the metaprograms (using metashell::format) in one translation
+  // unit. The ones with errors are evaluated separately.
+  std::vector<result> eval_tmp_batch(
+    const environment& env_,
+    const std::vector<std::string>& tmp_exps_,
+    const config& config_,
+    const std::string& input_filename_,
+    evaluation_session& session_
+  );
+
   result validate_code(
     const std::string& s_,
     const config& config_,
@@ -54,6 +118,14 @@ namespace metashell
     logger* logger_
   );
 
+  result validate_code(
+    const std::string& s_,
+    const config& config_,
+    const environment& env_,
+    const std::string& intput_filename_,
+    evaluation_session& session_
+  );
+
   void code_complete(
     const environment& env_,
     const std::string& src_,
@@ -62,6 +134,14 @@ namespace metashell
     logger* logger_
   );
 
+  void code_complete(
+    const environment& env_,
+    const std::string& src_,
+    const std::string& input_filename_,
+    std::set<std::string>& out_,
+    evaluation_session& session_
+  );
+
   bool is_environment_setup_command(
     command::iterator begin_,
     const command::iterator& end_
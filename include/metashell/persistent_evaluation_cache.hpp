@@ -0,0 +1,64 @@
+#ifndef METASHELL_PERSISTENT_EVALUATION_CACHE_HPP
+#define METASHELL_PERSISTENT_EVALUATION_CACHE_HPP
+
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/result.hpp>
+#include <metashell/logger.hpp>
+
+#include <boost/optional.hpp>
+#include <boost/filesystem/path.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace metashell
+{
+  // Stores the results of evaluations in a directory, so they can be reused
+  // by other Metashell processes. Every result is stored in a separate file
+  // named after its key. When the total size of the files exceeds the limit,
+  // the least recently used ones are deleted until it drops to three quarters
+  // of the limit. The total is kept in a file of the directory, thus storing
+  // an entry does not scan the directory.
+  class persistent_evaluation_cache
+  {
+  public:
+    persistent_evaluation_cache(
+      const std::string& directory_,
+      std::size_t size_limit_,
+      logger* logger_
+    );
+
+    boost::optional<result> find(const std::string& key_);
+    void store(const std::string& key_, const result& result_);
+
+    const std::string& directory() const;
+    std::size_t size_limit() const;
+  private:
+    std::string _directory;
+    std::size_t _size_limit;
+    logger* _logger;
+
+    std::string path_of(const std::string& key_) const;
+    // Returns the total size of the entries left there
+    std::uintmax_t evict(const boost::filesystem::path& keep_);
+  };
+}
+
+#endif
+
@@ -18,14 +18,15 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <metashell/pragma_without_arguments.hpp>
-#include <metashell/environment.hpp>
 
 namespace metashell
 {
+  class shell;
+
   class pragma_environment : public pragma_without_arguments
   {
   public:
-    explicit pragma_environment(environment& env_);
+    explicit pragma_environment(shell& shell_);
 
     virtual iface::pragma_handler* clone() const override;
 
@@ -33,7 +34,7 @@ namespace metashell
 
     virtual void run(iface::displayer& displayer_) const override;
   private:
-    environment& _env;
+    shell& _shell;
   };
 }
 
@@ -19,17 +19,17 @@
 
 #include <metashell/iface/displayer.hpp>
 #include <metashell/iface/pragma_handler.hpp>
-#include <metashell/config.hpp>
-#include <metashell/environment.hpp>
 
 #include <string>
 
 namespace metashell
 {
+  class shell;
+
   class pragma_environment_save : public iface::pragma_handler
   {
   public:
-    pragma_environment_save(const config& config_, const environment& env_);
+    explicit pragma_environment_save(shell& shell_);
 
     virtual iface::pragma_handler* clone() const override;
 
@@ -42,8 +42,7 @@ namespace metashell
       iface::displayer& displayer_
     ) const override;
   private:
-    const config& _config;
-    const environment& _env;
+    shell& _shell;
   };
 }
 
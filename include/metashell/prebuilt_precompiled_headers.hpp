@@ -0,0 +1,47 @@
+#ifndef METASHELL_PREBUILT_PRECOMPILED_HEADERS_HPP
+#define METASHELL_PREBUILT_PRECOMPILED_HEADERS_HPP
+
+
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/user_config.hpp>
+#include <metashell/logger.hpp>
+#include <metashell/iface/displayer.hpp>
+#include <metashell/iface/environment_detector.hpp>
+
+#include <iosfwd>
+#include <string>
+
+namespace metashell
+{
+  // Precompiles the built-in definitions of the shell (and the built-in
+  // formatters on top of them) for every supported standard into the
+  // precompiled header cache in directory_/precompiled_headers. It is done
+  // when Metashell is installed, thus the shells started with the default
+  // settings find them in config::prebuilt_precompiled_header_dir.
+  void prebuild_precompiled_headers(
+    const user_config& ucfg_,
+    iface::environment_detector& env_detector_,
+    const std::string& directory_,
+    iface::displayer& displayer_,
+    std::ostream& stderr_,
+    logger* logger_
+  );
+}
+
+#endif
+
@@ -0,0 +1,114 @@
+#ifndef METASHELL_PRECOMPILED_HEADER_CACHE_HPP
+#define METASHELL_PRECOMPILED_HEADER_CACHE_HPP
+
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/header_dependencies.hpp>
+#include <metashell/file_lock.hpp>
+#include <metashell/logger.hpp>
+
+#include <boost/filesystem/path.hpp>
+#include <boost/optional.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace metashell
+{
+  // Stores the precompiled headers of environments in a directory, so they
+  // can be reused by other Metashell processes. The entries are named after
+  // the hash of the content of the environment and the clang arguments. An
+  // entry may contain multiple precompiled headers built from different
+  // versions of the included headers. The ones in use are locked, the others
+  // are deleted (least recently used first) when the total size of the
+  // files exceeds the limit.
+  class precompiled_header_cache
+  {
+  public:
+    struct entry
+    {
+      // The header to include. The precompiled header is next to it.
+      std::string header;
+      header_dependencies dependencies;
+      // The entry is not deleted while this is alive
+      std::shared_ptr<file_lock> lock;
+    };
+
+    // Builds the precompiled header of header_. The internal headers are in
+    // internal_dir_.
+    typedef
+      std::function<
+        header_dependencies (
+          const std::string& header_,
+          const std::string& internal_dir_,
+          const std::vector<std::string>& clang_args_
+        )
+      >
+      builder;
+
+    precompiled_header_cache(
+      const std::string& directory_,
+      std::size_t size_limit_,
+      logger* logger_
+    );
+
+    bool enabled() const;
+
+    // Returns a precompiled header of content_ built with clang_args_ using
+    // the current version of the included headers. internal_dir_ is the
+    // internal directory of the caller. When there is no such precompiled
+    // header in the cache, it is built using build_ and stored. Other
+    // processes needing the same entry wait for the build.
+    entry get(
+      const std::string& content_,
+      const std::vector<std::string>& clang_args_,
+      const std::string& internal_dir_,
+      const builder& build_
+    );
+
+    // Returns a precompiled header of content_ built with clang_args_ using
+    // the current version of the included headers if there is one in the
+    // cache. It does not modify the directory and does not lock anything, so
+    // it can be used on read-only caches (eg. the precompiled headers
+    // installed with Metashell).
+    boost::optional<entry> find(
+      const std::string& content_,
+      const std::vector<std::string>& clang_args_,
+      const std::string& internal_dir_
+    ) const;
+
+    const std::string& directory() const;
+    std::size_t size_limit() const;
+  private:
+    std::string _directory;
+    std::size_t _size_limit;
+    logger* _logger;
+
+    boost::filesystem::path entry_directory(
+      const std::string& content_,
+      const std::vector<std::string>& normalised_args_
+    ) const;
+
+    void evict();
+  };
+}
+
+#endif
+
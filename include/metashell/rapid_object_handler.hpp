@@ -23,6 +23,7 @@
 
 #include <map>
 #include <string>
+#include <vector>
 #include <cassert>
 
 namespace metashell
@@ -74,13 +75,20 @@ namespace metashell
 
     boost::optional<std::string> field(const std::string& name_) const;
 
+    // The fields whose values are arrays of strings
+    boost::optional<std::vector<std::string>> array_field(
+      const std::string& name_
+    ) const;
+
     bool empty() const;
   private:
     bool _empty;
     bool _failed;
     std::map<std::string, std::string> _fields;
+    std::map<std::string, std::vector<std::string>> _array_fields;
 
     bool _in_object;
+    bool _in_array;
     std::string _next_key;
 
     iface::displayer& _displayer;
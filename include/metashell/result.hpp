@@ -17,6 +17,7 @@
 // You should have received a copy of the GNU General Public License
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
+#include <iosfwd>
 #include <string>
 #include <vector>
 
@@ -44,6 +45,11 @@ namespace metashell
 
     bool has_errors() const;
   };
+
+  // Serialisation of the results to store them in files or send them to
+  // other processes
+  void write_result(std::ostream& out_, const result& result_);
+  bool read_result(std::istream& in_, result& result_);
 }
 
 #endif
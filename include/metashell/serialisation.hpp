@@ -0,0 +1,32 @@
+#ifndef METASHELL_SERIALISATION_HPP
+#define METASHELL_SERIALISATION_HPP
+
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <iosfwd>
+#include <string>
+
+namespace metashell
+{
+  // The strings are written as their length in decimal, a new line and
+  // their characters. They may contain any character, including new lines.
+  void write_string(std::ostream& out_, const std::string& s_);
+  bool read_string(std::istream& in_, std::string& s_);
+}
+
+#endif
+
@@ -19,6 +19,10 @@
 
 #include <metashell/config.hpp>
 #include <metashell/environment.hpp>
+#include <metashell/evaluation_session.hpp>
+#include <metashell/evaluation_cache.hpp>
+#include <metashell/evaluation_pool.hpp>
+#include <metashell/subprocess_evaluator.hpp>
 #include <metashell/pragma_handler_map.hpp>
 #include <metashell/command_processor_queue.hpp>
 #include <metashell/logger.hpp>
@@ -34,8 +38,9 @@
 #include <string>
 #include <set>
 #include <map>
-#include <stack>
 #include <memory>
+#include <utility>
+#include <vector>
 
 namespace metashell
 {
@@ -64,6 +69,14 @@ namespace metashell
       iface::history& history_
     ) override;
     void line_available(const std::string& s_, iface::displayer& displayer_);
+
+    // The consecutive metaprograms (which do not depend on each other) are
+    // evaluated together by the evaluation pool
+    virtual void lines_available(
+      const std::vector<std::string>& s_,
+      iface::displayer& displayer_,
+      iface::history& history_
+    ) override;
     virtual std::string prompt() const override;
 
     virtual void cancel_operation() override;
@@ -71,6 +84,12 @@ namespace metashell
     bool store_in_buffer(const std::string& s_, iface::displayer& displayer_);
     void run_metaprogram(const std::string& s_, iface::displayer& displayer_);
 
+    // Displays each metaprogram followed by the result of evaluating it
+    void run_metaprograms(
+      const std::vector<std::string>& s_,
+      iface::displayer& displayer_
+    );
+
     static const char* input_filename();
 
     virtual void code_complete(
@@ -98,7 +117,13 @@ namespace metashell
     void display_environment_stack_size(iface::displayer& displayer_);
     void rebuild_environment();
 
+    // Makes the environment use the current content of the included headers.
+    // Returns false when none of them has changed since they were processed.
+    bool reload_environment();
+
     const config& get_config() const;
+
+    const evaluation_cache& get_evaluation_cache() const;
   private:
     std::string _line_prefix;
     std::unique_ptr<environment> _env;
@@ -106,11 +131,25 @@ namespace metashell
     std::string _prev_line;
     pragma_handler_map _pragma_handlers;
     bool _stopped;
-    std::stack<std::string> _environment_stack;
+    // The content of the pushed environments and the environment objects
+    // themselves. They are reused by pop unless the configuration has
+    // changed since the push.
+    std::vector<std::pair<std::string, std::unique_ptr<environment>>>
+      _environment_stack;
     logger* _logger;
+    // Code completion needs it as well, which is a const operation
+    mutable evaluation_session _session;
+    evaluation_cache _cache;
+    // Created by the first batch evaluation. Interactive shells don't use
+    // it.
+    std::unique_ptr<evaluation_pool> _pool;
+    std::unique_ptr<subprocess_evaluator> _subprocess;
 
     void init(command_processor_queue* cpq_);
+    void start_subprocess_evaluator();
+    void update_environment(iface::displayer& displayer_, bool wait_);
     void rebuild_environment(const std::string& content_);
+    void add_default_environment();
   };
 }
 
@@ -0,0 +1,47 @@
+#ifndef METASHELL_STARTUP_PROFILE_HPP
+#define METASHELL_STARTUP_PROFILE_HPP
+
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <chrono>
+#include <iosfwd>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace metashell
+{
+  // Measures how long the phases of the startup take
+  class startup_profile
+  {
+  public:
+    startup_profile();
+
+    // The phase started when the previous one finished (or when the object
+    // was created)
+    void phase_finished(const std::string& name_);
+
+    void display(std::ostream& out_) const;
+  private:
+    std::chrono::steady_clock::time_point _start;
+    std::chrono::steady_clock::time_point _last;
+    std::vector<std::pair<std::string, std::chrono::microseconds>> _phases;
+  };
+}
+
+#endif
+
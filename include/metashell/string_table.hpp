@@ -0,0 +1,79 @@
+#ifndef METASHELL_STRING_TABLE_HPP
+#define METASHELL_STRING_TABLE_HPP
+
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <boost/utility/string_ref.hpp>
+
+namespace metashell {
+
+// Stores every distinct string once and refers to them by 32 bit ids. The
+// characters are stored in large blocks, thus interning a string allocates
+// rarely and the strings never move. The same string always gets the same
+// id.
+class string_table {
+public:
+  typedef std::uint32_t id;
+
+  string_table();
+
+  string_table(string_table&& other);
+  string_table& operator=(string_table&& other);
+
+  // The strings are copied one by one to keep the ids
+  string_table(const string_table& other);
+  string_table& operator=(const string_table& other);
+
+  id intern(boost::string_ref s);
+
+  // The result is valid until the table is destroyed
+  boost::string_ref get(id id_) const;
+
+  std::size_t size() const;
+
+private:
+  struct entry {
+    const char* data;
+    std::uint32_t size;
+    std::uint32_t hash;
+  };
+
+  static std::uint32_t hash(boost::string_ref s);
+
+  const char* store(boost::string_ref s);
+  void rehash(std::size_t slot_count);
+
+  std::vector<std::unique_ptr<char[]>> blocks;
+  char* block_free = nullptr;
+  std::size_t block_left = 0;
+
+  std::vector<entry> entries;
+
+  // Open addressing with linear probing. A slot is 0 when it is empty and
+  // the id + 1 of an entry otherwise.
+  std::vector<id> slots;
+};
+
+}
+
+#endif
+
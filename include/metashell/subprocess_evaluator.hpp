@@ -0,0 +1,114 @@
+#ifndef METASHELL_SUBPROCESS_EVALUATOR_HPP
+#define METASHELL_SUBPROCESS_EVALUATOR_HPP
+
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/result.hpp>
+#include <metashell/logger.hpp>
+
+#include <boost/utility.hpp>
+
+#include <csignal>
+#include <cstddef>
+#include <functional>
+#include <string>
+
+#ifndef _WIN32
+#  include <sys/types.h>
+#endif
+
+namespace metashell
+{
+  // Evaluates metaprograms in a child process. The child process is kept
+  // alive between the evaluations (even when the environment changes), thus
+  // it can reuse its translation unit. When an evaluation takes too long,
+  // runs out of memory or gets cancelled, the child process is killed and
+  // the evaluation returns a result with the reason as its error. The next
+  // evaluation starts a new child process. On Windows the metaprograms are
+  // evaluated in the current process.
+  //
+  // The child processes are not forked from Metashell, since it runs other
+  // threads (whose locks would be inherited by the child process in a
+  // locked state) and holds file locks (which would live on in the child
+  // process). A launcher process is forked by the constructor instead and
+  // it forks the evaluating processes. The constructor has to be called
+  // before Metashell starts other threads or takes file locks.
+  class subprocess_evaluator : boost::noncopyable
+  {
+  public:
+    typedef std::function<result (const std::string&)> evaluator;
+
+    // Called in the child process with the environment passed to evaluate
+    // and again every time the environment changes. The evaluator it returns
+    // evaluates the metaprograms in the child process.
+    typedef
+      std::function<evaluator (const std::string&)>
+      evaluator_factory;
+
+    // 0 means no limit for timeout_ (in seconds) and memory_limit_ (the
+    // size of the child process' address space in bytes).
+    subprocess_evaluator(
+      const evaluator_factory& factory_,
+      unsigned timeout_,
+      std::size_t memory_limit_,
+      logger* logger_
+    );
+    ~subprocess_evaluator();
+
+    // The new environment is sent to the child process when environment_key_
+    // is different from the one used by the previous evaluation.
+    // environment_ is called only then (or when a new child process is
+    // started) to get the environment.
+    result evaluate(
+      const std::string& tmp_exp_,
+      const std::string& environment_key_,
+      const std::function<std::string ()>& environment_
+    );
+
+    // Returns false when the last evaluation failed before the metaprogram
+    // could be evaluated (eg. it timed out or got cancelled). The errors of
+    // such results should not be cached.
+    bool evaluated() const;
+
+    // Safe to be called from a signal handler
+    void cancel();
+  private:
+    evaluator_factory _factory;
+    unsigned _timeout;
+    std::size_t _memory_limit;
+    logger* _logger;
+    std::string _environment_key;
+    bool _evaluated;
+
+#ifndef _WIN32
+    pid_t _launcher;
+    int _control;
+    pid_t _pid;
+    int _channel;
+    volatile std::sig_atomic_t _running;
+    volatile std::sig_atomic_t _cancelled;
+
+    bool start(const std::string& environment_);
+    std::string stop();
+    void launch(int control_);
+    void serve(const std::string& environment_, int channel_);
+#endif
+  };
+}
+
+#endif
+
@@ -29,11 +29,15 @@ public:
 
   // This should be called before the first evaluation
   // with this environment
-  void set_xml_location(const std::string& xml_location);
+  void set_trace_location(const std::string& trace_location);
+
+  // The format of the trace: "binary" (default) or "xml"
+  void set_trace_format(const std::string& trace_format);
 
 private:
   // Indexes into clang_arguments()
-  std::size_t xml_path_index;
+  std::size_t trace_format_index;
+  std::size_t trace_path_index;
 };
 
 }
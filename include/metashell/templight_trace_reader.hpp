@@ -0,0 +1,137 @@
+#ifndef METASHELL_TEMPLIGHT_TRACE_READER_HPP
+#define METASHELL_TEMPLIGHT_TRACE_READER_HPP
+
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/metaprogram.hpp>
+#include <metashell/metaprogram_builder.hpp>
+#include <metashell/temporary_file.hpp>
+
+#include <boost/optional.hpp>
+#include <boost/utility.hpp>
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace metashell {
+
+// Loads the trace templight writes during an evaluation into a
+// metaprogram. Templight writes it into a pipe. A background thread reads
+// it and another one adds the events to the metaprogram while it is being
+// debugged. Thus templight does not have to wait for the metaprogram until
+// the amount of unprocessed trace reaches a limit. On Windows the trace is
+// written into a temporary file which is loaded after the evaluation.
+//
+// The metaprogram can be used only while the reader is locked. The
+// background thread does not change it until the reader is unlocked or
+// wait_for_more_events is called.
+class templight_trace_reader :
+  public metaprogram::loader,
+  boost::noncopyable
+{
+public:
+  // binary: templight is asked to write its binary format instead of XML.
+  // edge_added is called by the background thread for every new edge.
+  templight_trace_reader(
+      bool binary,
+      metaprogram& mp,
+      const metaprogram_builder::edge_added_callback& edge_added =
+        metaprogram_builder::edge_added_callback());
+
+  // Stops loading the trace
+  ~templight_trace_reader();
+
+  // The file templight should write the trace into
+  const std::string& get_path() const;
+
+  // Called after the evaluation, while the reader is not locked. It
+  // returns false when templight was asked to write the binary format but
+  // it has written something else (the libclang in use does not support
+  // it).
+  bool evaluation_finished();
+
+  void lock();
+  void unlock();
+
+  // True when the whole trace has been processed or loading it failed
+  bool is_loaded() const;
+
+  // The reason loading the trace failed. It is returned only once.
+  boost::optional<std::string> take_error();
+
+  virtual bool is_open(metaprogram::vertex_descriptor vertex) const override;
+  virtual bool wait_for_more_events() override;
+
+private:
+  class locking_builder;
+
+  bool binary;
+  metaprogram& mp;
+  std::string path;
+
+  std::mutex mutex;
+  // The lock of the users of the metaprogram
+  std::unique_lock<std::mutex> user_lock;
+  // Notified when new events have been processed or loading has finished
+  std::condition_variable progress;
+
+  std::unique_ptr<locking_builder> builder;
+  std::size_t processed_events;
+  bool loaded;
+  boost::optional<std::string> error;
+
+#ifdef _WIN32
+  temporary_file trace_file;
+#else
+  int write_fd;
+  bool format_checked;
+  bool expected_format;
+  bool cancelled;
+
+  // The parts of the trace read from the pipe but not processed yet
+  std::mutex chunks_mutex;
+  std::condition_variable chunk_available;
+  std::condition_variable chunk_consumed;
+  std::deque<std::vector<char>> chunks;
+  std::size_t queued_bytes;
+  bool pipe_closed;
+
+  std::thread pipe_reader;
+  std::thread trace_builder;
+
+  void read_pipe(int read_fd);
+  // Blocks until the next chunk is available. Returns false at the end of
+  // the trace.
+  bool next_chunk(std::vector<char>& chunk);
+  void build();
+  void close_write_end();
+#endif
+
+  // Reports the errors by setting error
+  void load_trace(std::istream& trace);
+};
+
+}
+
+#endif
+
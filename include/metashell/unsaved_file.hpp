@@ -37,8 +37,6 @@ namespace metashell
 
     const std::string& filename() const;
     const std::string& content() const;
-
-    void generate() const;
   private:
     std::string _filename;
     std::string _content;
@@ -21,6 +21,7 @@
 #include <metashell/console_type.hpp>
 #include <metashell/logging_mode.hpp>
 
+#include <cstddef>
 #include <string>
 #include <vector>
 
@@ -45,8 +46,22 @@ namespace metashell
     bool saving_enabled = false;
     console_type con_type = console_type::plain;
     bool splash_enabled = true;
+    std::size_t cache_memory_limit = 16 * 1024 * 1024;
+    bool cache_enabled = true;
+    std::string cache_dir;
+    std::size_t cache_disc_limit = 0;
+    std::size_t precompiled_header_cache_limit = 512 * 1024 * 1024;
     logging_mode log_mode = logging_mode::none;
     std::string log_file;
+    std::string batch_file;
+    unsigned jobs = 1;
+    bool subprocess_evaluation = false;
+    unsigned evaluation_timeout = 0;
+    std::size_t evaluation_memory_limit = 0;
+    bool watch_headers = false;
+    bool use_modules = false;
+    bool startup_profile = false;
+    std::string prebuild_precompiled_headers;
   };
 }
 
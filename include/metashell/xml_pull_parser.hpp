@@ -0,0 +1,81 @@
+#ifndef METASHELL_XML_PULL_PARSER_HPP
+#define METASHELL_XML_PULL_PARSER_HPP
+
+
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <iosfwd>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace metashell
+{
+  // Reads an XML document from a stream one element boundary or text at a
+  // time. Only the current token is kept in memory, thus documents bigger
+  // than the available memory can be processed. The XML declaration,
+  // processing instructions, comments and DOCTYPE declarations are skipped.
+  // Empty elements (<a/>) are returned as a start and an end element.
+  class xml_pull_parser
+  {
+  public:
+    enum class token
+    {
+      start_element,
+      end_element,
+      text,
+      end_of_document
+    };
+
+    explicit xml_pull_parser(std::istream& in_);
+
+    token next();
+
+    // The name of the element after start_element and end_element
+    const std::string& name() const;
+
+    // The decoded text after text
+    const std::string& text() const;
+
+    // The value of an attribute of the element after start_element. It
+    // returns nullptr when the element has no such attribute.
+    const std::string* attribute(const std::string& name_) const;
+  private:
+    std::streambuf* _in;
+    std::string _name;
+    std::string _text;
+    // Reused for every element to avoid allocations
+    std::vector<std::pair<std::string, std::string>> _attributes;
+    int _attribute_count;
+    bool _pending_end;
+
+    int peek();
+    int get();
+    void expect(char c_);
+    void skip_whitespace();
+    void skip_until(const std::string& s_);
+    void read_name(std::string& out_);
+    void read_entity(std::string& out_);
+    void read_start_element();
+    void read_end_element();
+    void read_text();
+    void read_cdata();
+  };
+}
+
+#endif
+
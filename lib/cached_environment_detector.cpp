@@ -0,0 +1,234 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/cached_environment_detector.hpp>
+#include <metashell/in_memory_environment.hpp>
+#include <metashell/content_hash.hpp>
+#include <metashell/config.hpp>
+#include <metashell/version.hpp>
+#include <metashell/serialisation.hpp>
+
+#include <boost/filesystem.hpp>
+
+#include <fstream>
+
+using namespace metashell;
+
+namespace
+{
+  const char format_id[] = "metashell toolchain detection 1";
+}
+
+cached_environment_detector::cached_environment_detector(
+  iface::environment_detector& detector_,
+  const std::string& directory_,
+  logger* logger_
+) :
+  _detector(detector_),
+  _directory(directory_),
+  _logger(logger_)
+{}
+
+std::string cached_environment_detector::search_clang_binary()
+{
+  return _detector.search_clang_binary();
+}
+
+bool cached_environment_detector::file_exists(const std::string& path_)
+{
+  return _detector.file_exists(path_);
+}
+
+bool cached_environment_detector::on_windows()
+{
+  return _detector.on_windows();
+}
+
+bool cached_environment_detector::on_osx()
+{
+  return _detector.on_osx();
+}
+
+void cached_environment_detector::append_to_path(const std::string& path_)
+{
+  _detector.append_to_path(path_);
+}
+
+std::vector<std::string> cached_environment_detector::default_clang_sysinclude(
+  const std::string& clang_path_
+)
+{
+  const std::string k =
+    key("sysinclude", clang_path_, std::vector<std::string>());
+  if (const boost::optional<std::vector<std::string>> cached = find(k))
+  {
+    return *cached;
+  }
+  else
+  {
+    const std::vector<std::string>
+      result = _detector.default_clang_sysinclude(clang_path_);
+    store(k, result);
+    return result;
+  }
+}
+
+std::vector<std::string> cached_environment_detector::extra_sysinclude()
+{
+  return _detector.extra_sysinclude();
+}
+
+std::string cached_environment_detector::path_of_executable()
+{
+  return _detector.path_of_executable();
+}
+
+bool cached_environment_detector::clang_binary_works_with_libclang(
+  const config& cfg_
+)
+{
+  // The check is done using the arguments the environments get
+  const std::string k =
+    key(
+      "works_with_libclang",
+      cfg_.clang_path,
+      in_memory_environment("<internal_dir>", cfg_).clang_arguments()
+    );
+  if (const boost::optional<std::vector<std::string>> cached = find(k))
+  {
+    return cached->size() == 1 && cached->front() == "1";
+  }
+  else
+  {
+    const bool result = _detector.clang_binary_works_with_libclang(cfg_);
+    store(k, std::vector<std::string>(1, result ? "1" : "0"));
+    return result;
+  }
+}
+
+std::string cached_environment_detector::default_cache_dir()
+{
+  return _detector.default_cache_dir();
+}
+
+std::string cached_environment_detector::key(
+  const std::string& check_,
+  const std::string& clang_path_,
+  const std::vector<std::string>& args_
+) const
+{
+  boost::system::error_code ec;
+  const std::time_t modified =
+    boost::filesystem::last_write_time(clang_path_, ec);
+  const std::uintmax_t size =
+    ec ? 0 : boost::filesystem::file_size(clang_path_, ec);
+
+  if (_directory.empty() || ec)
+  {
+    return std::string();
+  }
+  else
+  {
+    return
+      content_hash()
+        .add(check_)
+        .add(version())
+        .add(libclang_version())
+        .add(clang_path_)
+        .add(std::to_string(modified))
+        .add(std::to_string(size))
+        .add(args_)
+        .digest();
+  }
+}
+
+boost::optional<std::vector<std::string>> cached_environment_detector::find(
+  const std::string& key_
+)
+{
+  if (!key_.empty())
+  {
+    const std::string path =
+      (boost::filesystem::path(_directory) / key_).string();
+    std::ifstream f(path.c_str(), std::ios::binary);
+    std::string id;
+    std::size_t count;
+    if (
+      f
+      && std::getline(f, id) && id == format_id
+      && f >> count && f.get() == '\n'
+    )
+    {
+      std::vector<std::string> result(count);
+      for (std::string& s : result)
+      {
+        if (!read_string(f, s))
+        {
+          return boost::none;
+        }
+      }
+      METASHELL_LOG(_logger, "Using cached toolchain detection " + path);
+      return result;
+    }
+  }
+  return boost::none;
+}
+
+void cached_environment_detector::store(
+  const std::string& key_,
+  const std::vector<std::string>& v_
+)
+{
+  using boost::filesystem::path;
+
+  if (!key_.empty())
+  {
+    try
+    {
+      create_directories(path(_directory));
+
+      // Other Metashell processes may be reading the same file
+      const path tmp =
+        path(_directory)
+          / boost::filesystem::unique_path("%%%%-%%%%-%%%%-%%%%.tmp");
+      {
+        std::ofstream f(tmp.string().c_str(), std::ios::binary);
+        f << format_id << '\n' << v_.size() << '\n';
+        for (const std::string& s : v_)
+        {
+          write_string(f, s);
+        }
+        if (!f)
+        {
+          METASHELL_LOG(_logger, "Failed to write " + tmp.string());
+          f.close();
+          boost::system::error_code ec;
+          remove(tmp, ec);
+          return;
+        }
+      }
+      rename(tmp, path(_directory) / key_);
+    }
+    catch (const boost::filesystem::filesystem_error& e_)
+    {
+      METASHELL_LOG(
+        _logger,
+        std::string("Failed to store toolchain detection: ") + e_.what()
+      );
+    }
+  }
+}
+
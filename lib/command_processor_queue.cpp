@@ -65,6 +65,19 @@ void command_processor_queue::line_available(
   }
 }
 
+void command_processor_queue::lines_available(
+  const std::vector<std::string>& cmds_,
+  iface::displayer& displayer_
+)
+{
+  assert(_history != nullptr);
+
+  if (!empty())
+  {
+    _items.back()->lines_available(cmds_, displayer_, *_history);
+  }
+}
+
 std::string command_processor_queue::prompt() const
 {
   assert(!empty());
@@ -19,6 +19,7 @@
 #include <metashell/default_environment_detector.hpp>
 #include <metashell/null_displayer.hpp>
 #include <metashell/fstream_file_writer.hpp>
+#include <metashell/startup_profile.hpp>
 
 #include <metashell/metashell.hpp>
 
@@ -30,6 +31,7 @@
 #include <iostream>
 #include <iterator>
 #include <sstream>
+#include <thread>
 
 using namespace metashell;
 
@@ -60,6 +62,14 @@ namespace
     return s.str();
   }
 
+  void phase_finished(startup_profile* profile_, const std::string& name_)
+  {
+    if (profile_)
+    {
+      profile_->phase_finished(name_);
+    }
+  }
+
   std::string directory_of_file(const std::string& path_)
   {
     boost::filesystem::path p(path_);
@@ -76,6 +86,19 @@ namespace
       + (env_detector_.on_windows() ? "\\clang\\clang.exe" : "/clang_metashell");
   }
 
+  std::string prebuilt_precompiled_header_dir(
+    iface::environment_detector& env_detector_
+  )
+  {
+    const std::string dir_of_executable =
+      directory_of_file(env_detector_.path_of_executable());
+
+    return
+      env_detector_.on_windows() ?
+        dir_of_executable + "\\precompiled_headers" :
+        dir_of_executable + "/../share/metashell/precompiled_headers";
+  }
+
   std::string detect_clang_binary(
     const std::string& user_defined_path_,
     iface::environment_detector& env_detector_,
@@ -302,14 +325,26 @@ config::config() :
   warnings_enabled(true),
   use_precompiled_headers(false),
   clang_path(),
-  splash_enabled(true)
+  splash_enabled(true),
+  cache_memory_limit(0),
+  cache_dir(),
+  cache_disc_limit(0),
+  precompiled_header_cache_limit(0),
+  prebuilt_precompiled_header_dir(),
+  jobs(1),
+  subprocess_evaluation(false),
+  evaluation_timeout(0),
+  evaluation_memory_limit(0),
+  watch_headers(false),
+  use_modules(false)
 {}
 
 config metashell::detect_config(
   const user_config& ucfg_,
   iface::environment_detector& env_detector_,
   std::ostream& stderr_,
-  logger* logger_
+  logger* logger_,
+  startup_profile* profile_
 )
 {
   METASHELL_LOG(logger_, "Detecting config");
@@ -325,6 +360,7 @@ config metashell::detect_config(
 
   cfg.clang_path =
     detect_clang_binary(ucfg_.clang_path, env_detector_, stderr_, logger_);
+  phase_finished(profile_, "Searching the Clang binary");
 
   cfg.include_path =
     determine_include_path(
@@ -333,6 +369,7 @@ config metashell::detect_config(
       env_detector_,
       logger_
     );
+  phase_finished(profile_, "Determining the include path");
 
   cfg.max_template_depth = ucfg_.max_template_depth;
 #ifndef METASHELL_DISABLE_TEMPLIGHT_TRACE_CAPACITY
@@ -366,8 +403,47 @@ config metashell::detect_config(
       stderr_,
       logger_
     );
+  phase_finished(profile_, "Checking precompiled header support");
+
+  if (cfg.use_precompiled_headers)
+  {
+    cfg.prebuilt_precompiled_header_dir =
+      prebuilt_precompiled_header_dir(env_detector_);
+  }
 
   cfg.splash_enabled = ucfg_.splash_enabled;
+  if (ucfg_.cache_enabled)
+  {
+    cfg.cache_memory_limit = ucfg_.cache_memory_limit;
+    cfg.cache_dir =
+      ucfg_.cache_dir.empty() ?
+        env_detector_.default_cache_dir() :
+        ucfg_.cache_dir;
+    cfg.cache_disc_limit = ucfg_.cache_disc_limit;
+    cfg.precompiled_header_cache_limit = ucfg_.precompiled_header_cache_limit;
+    METASHELL_LOG(logger_, "Cache directory: " + cfg.cache_dir);
+  }
+  else
+  {
+    METASHELL_LOG(logger_, "User disabled the evaluation cache.");
+  }
+
+  cfg.jobs =
+    ucfg_.jobs == 0 ?
+      std::max(std::thread::hardware_concurrency(), 1u) :
+      ucfg_.jobs;
+
+  // The limits can be enforced only when the evaluation runs in a separate
+  // process
+  cfg.evaluation_timeout = ucfg_.evaluation_timeout;
+  cfg.evaluation_memory_limit = ucfg_.evaluation_memory_limit;
+  cfg.subprocess_evaluation =
+    ucfg_.subprocess_evaluation
+    || ucfg_.evaluation_timeout > 0
+    || ucfg_.evaluation_memory_limit > 0;
+
+  cfg.watch_headers = ucfg_.watch_headers;
+  cfg.use_modules = ucfg_.use_modules;
 
   METASHELL_LOG(logger_, "Config detection completed");
 
@@ -378,6 +454,9 @@ config metashell::empty_config(const std::string& argv0_)
 {
   default_environment_detector ed(argv0_, nullptr);
   std::ostringstream s;
-  return detect_config(user_config(), ed, s, nullptr);
+  config cfg = detect_config(user_config(), ed, s, nullptr);
+  // The results of evaluations are not shared with other processes
+  cfg.cache_dir.clear();
+  return cfg;
 }
 
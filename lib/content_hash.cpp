@@ -0,0 +1,67 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/content_hash.hpp>
+
+#include <iomanip>
+#include <sstream>
+
+using namespace metashell;
+
+content_hash::content_hash() : _sha1() {}
+
+content_hash& content_hash::add(const std::string& s_)
+{
+  std::ostringstream len;
+  len << s_.size() << ':';
+  add_raw(len.str());
+  return add_raw(s_);
+}
+
+content_hash& content_hash::add(const std::vector<std::string>& v_)
+{
+  std::ostringstream len;
+  len << v_.size() << ':';
+  add_raw(len.str());
+  for (const std::string& s : v_)
+  {
+    add(s);
+  }
+  return *this;
+}
+
+content_hash& content_hash::add_raw(const std::string& s_)
+{
+  _sha1.process_bytes(s_.c_str(), s_.size());
+  return *this;
+}
+
+std::string content_hash::digest() const
+{
+  // get_digest finalises the object it is called on
+  boost::uuids::detail::sha1 h(_sha1);
+  unsigned int d[5];
+  h.get_digest(d);
+
+  std::ostringstream s;
+  s << std::hex << std::setfill('0');
+  for (unsigned int i : d)
+  {
+    s << std::setw(8) << i;
+  }
+  return s.str();
+}
+
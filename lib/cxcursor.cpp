@@ -88,6 +88,11 @@ cxcursor cxcursor::semantic_parent() const
   return cxcursor(clang_getCursorSemanticParent(_cursor));
 }
 
+bool cxcursor::is_in_main_file() const
+{
+  return clang_Location_isFromMainFile(clang_getCursorLocation(_cursor)) != 0;
+}
+
 cxcursor::namespace_iterator cxcursor::namespace_begin() const
 {
   return namespace_iterator(semantic_parent());
@@ -39,6 +39,8 @@ namespace metashell
 
     cxcursor semantic_parent() const;
 
+    bool is_in_main_file() const;
+
     cxtype type() const;
 
     namespace_iterator namespace_begin() const;
@@ -21,6 +21,30 @@
 
 using namespace metashell;
 
+namespace
+{
+  void add_main_file_lines(CXDiagnostic d_, std::set<unsigned>& out_)
+  {
+    const CXSourceLocation l = clang_getDiagnosticLocation(d_);
+    if (clang_Location_isFromMainFile(l))
+    {
+      unsigned line;
+      clang_getExpansionLocation(l, nullptr, &line, nullptr, nullptr);
+      out_.insert(line);
+    }
+
+    // The set of child diagnostics is owned by the parent
+    const CXDiagnosticSet children = clang_getChildDiagnostics(d_);
+    const unsigned child_count = clang_getNumDiagnosticsInSet(children);
+    for (unsigned i = 0; i != child_count; ++i)
+    {
+      const CXDiagnostic child = clang_getDiagnosticInSet(children, i);
+      add_main_file_lines(child, out_);
+      clang_disposeDiagnostic(child);
+    }
+  }
+}
+
 cxdiagnostic::cxdiagnostic(CXDiagnostic d_) : _d(d_) {}
 
 cxdiagnostic::~cxdiagnostic()
@@ -36,3 +60,9 @@ std::string cxdiagnostic::spelling() const
     );
 }
 
+std::set<unsigned> cxdiagnostic::main_file_lines() const
+{
+  std::set<unsigned> result;
+  add_main_file_lines(_d, result);
+  return result;
+}
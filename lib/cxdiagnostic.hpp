@@ -21,6 +21,7 @@
 
 #include <boost/utility.hpp>
 
+#include <set>
 #include <string>
 
 namespace metashell
@@ -33,6 +34,10 @@ namespace metashell
     ~cxdiagnostic();
 
     std::string spelling() const;
+
+    // The lines of the main file the diagnostic or its notes (eg. the
+    // "in instantiation of" ones) point to
+    std::set<unsigned> main_file_lines() const;
   private:
     CXDiagnostic _d;
   };
@@ -21,7 +21,10 @@
 using namespace metashell;
 
 cxindex::cxindex(logger* logger_) :
-  _index(clang_createIndex(0, 0)),
+  // Only the declarations of the main file are visited. Excluding the ones
+  // coming from precompiled headers makes libclang skip them without
+  // deserialising them.
+  _index(clang_createIndex(1, 0)),
   _logger(logger_)
 {}
 
@@ -32,12 +35,13 @@ cxindex::~cxindex()
 
 std::unique_ptr<cxtranslationunit> cxindex::parse_code(
   const unsaved_file& src_,
-  const environment& env_
+  const environment& env_,
+  unsigned options_
 )
 {
   return
     std::unique_ptr<cxtranslationunit>(
-      new cxtranslationunit(env_, src_, _index, _logger)
+      new cxtranslationunit(env_, src_, _index, _logger, options_)
     );
 }
 
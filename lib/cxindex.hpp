@@ -39,7 +39,8 @@ namespace metashell
 
     std::unique_ptr<cxtranslationunit> parse_code(
       const unsaved_file& src_,
-      const environment& env_
+      const environment& env_,
+      unsigned options_ = CXTranslationUnit_None
     );
   private:
     CXIndex _index;
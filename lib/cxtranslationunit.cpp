@@ -22,6 +22,7 @@
 #include "cxtranslationunit.hpp"
 #include "cxdiagnostic.hpp"
 #include "cxcodecompleteresults.hpp"
+#include "cxstring.hpp"
 
 #include <clang-c/Index.h>
 
@@ -45,8 +46,11 @@ namespace
     const cxtranslationunit::visitor& f =
       *static_cast<cxtranslationunit::visitor*>(client_data_);
 
-    f(cxcursor(cursor_), cxcursor(parent_));
-    return CXChildVisit_Recurse;
+    const cxcursor cursor(cursor_);
+    return
+      cursor.is_in_main_file() ?
+        f(cursor, cxcursor(parent_)) :
+        CXChildVisit_Continue;
   }
 
   std::string get_nth_error_msg(CXTranslationUnit tu_, int n_)
@@ -54,6 +58,18 @@ namespace
     return cxdiagnostic(clang_getDiagnostic(tu_, n_)).spelling();
   }
 
+  void collect_included_file(
+    CXFile included_file_,
+    CXSourceLocation*,
+    unsigned,
+    CXClientData client_data_
+  )
+  {
+    static_cast<std::vector<std::string>*>(client_data_)->push_back(
+      cxstring(clang_getFileName(included_file_))
+    );
+  }
+
   const char* c_str(const std::string& s_)
   {
     return s_.c_str();
@@ -91,7 +107,8 @@ cxtranslationunit::cxtranslationunit(
   const environment& env_,
   const unsaved_file& src_,
   CXIndex index_,
-  logger* logger_
+  logger* logger_,
+  unsigned options_
 ) :
   _src(src_),
   _unsaved_files(),
@@ -110,12 +127,7 @@ cxtranslationunit::cxtranslationunit(
     >
     c_str_it;
 
-  _unsaved_files.reserve(env_.get_headers().size() + 1);
-  for (const unsaved_file& uf : env_.get_headers())
-  {
-    _unsaved_files.push_back(uf.get());
-  }
-  _unsaved_files.push_back(_src.get());
+  set_unsaved_files(env_);
 
   const vector<const char*> argv(
     c_str_it(env_.clang_arguments().begin(), c_str),
@@ -139,7 +151,7 @@ cxtranslationunit::cxtranslationunit(
       argv.size(),
       &_unsaved_files[0],
       _unsaved_files.size(),
-      CXTranslationUnit_None
+      options_
     );
   if (_tu)
   {
@@ -161,7 +173,57 @@ cxtranslationunit::~cxtranslationunit()
   clang_disposeTranslationUnit(_tu);
 }
 
-void cxtranslationunit::visit_nodes(const visitor& f_)
+void cxtranslationunit::set_unsaved_files(const environment& env_)
+{
+  _unsaved_files.clear();
+  _unsaved_files.reserve(env_.get_headers().size() + 1);
+  for (const unsaved_file& uf : env_.get_headers())
+  {
+    _unsaved_files.push_back(uf.get());
+  }
+  _unsaved_files.push_back(_src.get());
+}
+
+void cxtranslationunit::reparse(
+  const environment& env_,
+  const unsaved_file& src_
+)
+{
+  _src = src_;
+  set_unsaved_files(env_);
+
+  METASHELL_LOG(
+    _logger,
+    log_libclang_invocation(
+      src_.filename(),
+      _unsaved_files,
+      env_.clang_arguments()
+    )
+  );
+
+  if (
+    clang_reparseTranslationUnit(
+      _tu,
+      _unsaved_files.size(),
+      &_unsaved_files[0],
+      clang_defaultReparseOptions(_tu)
+    ) == 0
+  )
+  {
+    METASHELL_LOG(_logger, "Reparsing the syntax tree succeeded.");
+  }
+  else
+  {
+    METASHELL_LOG(_logger, "Reparsing the syntax tree failed.");
+    throw
+      exception(
+        "Error reparsing source code (" + src_.filename() + ": "
+        + src_.content() + ")"
+      );
+  }
+}
+
+void cxtranslationunit::visit_main_file_nodes(const visitor& f_)
 {
   clang_visitChildren(
     clang_getTranslationUnitCursor(_tu),
@@ -193,6 +255,40 @@ bool cxtranslationunit::has_errors() const
   return clang_getNumDiagnostics(_tu) > 0;
 }
 
+std::vector<std::set<unsigned>> cxtranslationunit::error_lines() const
+{
+  std::vector<std::set<unsigned>> result;
+  for (unsigned i = 0, e = clang_getNumDiagnostics(_tu); i != e; ++i)
+  {
+    const cxdiagnostic d(clang_getDiagnostic(_tu, i));
+    result.push_back(d.main_file_lines());
+  }
+  return result;
+}
+
+std::vector<std::string> cxtranslationunit::included_files() const
+{
+  std::vector<std::string> result;
+  clang_getInclusions(_tu, collect_included_file, &result);
+  return result;
+}
+
+void cxtranslationunit::save(const std::string& filename_) const
+{
+  METASHELL_LOG(_logger, "Saving syntax tree to " + filename_);
+
+  if (
+    clang_saveTranslationUnit(
+      _tu,
+      filename_.c_str(),
+      clang_defaultSaveOptions(_tu)
+    ) != CXSaveError_None
+  )
+  {
+    throw exception("Error saving syntax tree to " + filename_);
+  }
+}
+
 void cxtranslationunit::code_complete(std::set<std::string>& out_) const
 {
   const text_position pos = text_position() + _src.content();
@@ -39,7 +39,7 @@ namespace metashell
   class cxtranslationunit : boost::noncopyable
   {
   public:
-    typedef std::function<void(cxcursor, cxcursor)> visitor;
+    typedef std::function<CXChildVisitResult(cxcursor, cxcursor)> visitor;
 
     typedef indexing_iterator<std::string> error_iterator;
 
@@ -48,23 +48,46 @@ namespace metashell
       const environment& env_,
       const unsaved_file& src_,
       CXIndex index_,
-      logger* logger_
+      logger* logger_,
+      unsigned options_ = CXTranslationUnit_None
     );
     ~cxtranslationunit();
 
-    void visit_nodes(const visitor& f_);
+    // Parses the translation unit again with a new content of the main file.
+    // The name of the main file, the headers and the arguments are expected
+    // to be the same as the ones used to build the translation unit. It throws
+    // when libclang fails to reparse it. The object can not be used after that.
+    void reparse(const environment& env_, const unsaved_file& src_);
+
+    // Visits the nodes coming from the main file only. The nodes coming from
+    // the environment's headers (and their children) are skipped. The result
+    // of the visitor controls the visitation the same way as in
+    // clang_visitChildren.
+    void visit_main_file_nodes(const visitor& f_);
 
     error_iterator errors_begin() const;
     error_iterator errors_end() const;
 
     bool has_errors() const;
 
+    // The lines of the main file each error belongs to
+    std::vector<std::set<unsigned>> error_lines() const;
+
     void code_complete(std::set<std::string>& out_) const;
+
+    // The files included (directly or indirectly) by the main file
+    std::vector<std::string> included_files() const;
+
+    // Serialises the syntax tree. When the translation unit was parsed as
+    // an incomplete one, the result can be used as a precompiled header.
+    void save(const std::string& filename_) const;
   private:
     unsaved_file _src;
     std::vector<CXUnsavedFile> _unsaved_files;
     CXTranslationUnit _tu;
     logger* _logger;
+
+    void set_unsaved_files(const environment& env_);
   };
 }
 
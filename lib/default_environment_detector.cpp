@@ -255,3 +255,32 @@ bool default_environment_detector::clang_binary_works_with_libclang(
   }
 }
 
+std::string default_environment_detector::default_cache_dir()
+{
+#ifdef _WIN32
+  const std::string local_app_data = just::environment::get("LOCALAPPDATA");
+  return local_app_data.empty() ? "" : local_app_data + "\\metashell\\cache";
+#else
+  const std::string xdg_cache_home = just::environment::get("XDG_CACHE_HOME");
+  if (xdg_cache_home.empty())
+  {
+    const std::string home = just::environment::get("HOME");
+    if (home.empty())
+    {
+      return "";
+    }
+    else
+    {
+#  ifdef __APPLE__
+      return home + "/Library/Caches/metashell";
+#  else
+      return home + "/.cache/metashell";
+#  endif
+    }
+  }
+  else
+  {
+    return xdg_cache_home + "/metashell";
+  }
+#endif
+}
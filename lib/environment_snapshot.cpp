@@ -0,0 +1,225 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/environment_snapshot.hpp>
+#include <metashell/serialisation.hpp>
+#include <metashell/exception.hpp>
+
+#include <istream>
+#include <ostream>
+
+using namespace metashell;
+
+namespace
+{
+  const char format_id[] = "metashell environment 1";
+
+  bool read_size(std::istream& in_, std::size_t& size_)
+  {
+    return in_ >> size_ && in_.get() == '\n';
+  }
+}
+
+environment_snapshot::environment_snapshot() :
+  _dependencies_known(false),
+  _headers("", true)
+{}
+
+environment_snapshot::environment_snapshot(const environment& env_) :
+  _content(env_.get()),
+  // The environments put the same prefix in front of every appended code
+  _prefix(env_.get_appended("")),
+  _all(env_.get_all()),
+  _all_digest(env_.get_all_digest()),
+  _dependencies_digest(env_.get_dependencies_digest()),
+  _dependencies_known(env_.dependencies_known()),
+  _headers(env_.internal_dir(), true),
+  _clang_args(env_.clang_arguments())
+{
+  for (const unsaved_file& h : env_.get_headers())
+  {
+    _headers.add(h.filename(), h.content());
+  }
+}
+
+void environment_snapshot::append(const std::string&)
+{
+  throw exception("A snapshot of an environment can not be extended.");
+}
+
+std::string environment_snapshot::get() const
+{
+  return _content;
+}
+
+std::string environment_snapshot::get_appended(const std::string& s_) const
+{
+  return _prefix + s_;
+}
+
+std::string environment_snapshot::internal_dir() const
+{
+  return _headers.internal_dir();
+}
+
+std::vector<std::string>& environment_snapshot::clang_arguments()
+{
+  return _clang_args;
+}
+
+const std::vector<std::string>& environment_snapshot::clang_arguments() const
+{
+  return _clang_args;
+}
+
+const headers& environment_snapshot::get_headers() const
+{
+  return _headers;
+}
+
+const std::string& environment_snapshot::get_all() const
+{
+  return _all;
+}
+
+std::string environment_snapshot::get_all_digest() const
+{
+  return _all_digest;
+}
+
+std::string environment_snapshot::get_dependencies_digest() const
+{
+  return _dependencies_digest;
+}
+
+bool environment_snapshot::dependencies_known() const
+{
+  return _dependencies_known;
+}
+
+void environment_snapshot::update(bool)
+{
+  // Nothing is done in the background
+}
+
+bool environment_snapshot::reload()
+{
+  // The snapshot does not know if the headers have changed
+  return true;
+}
+
+std::unique_ptr<environment> environment_snapshot::create_successor(
+  const config&,
+  logger*
+) const
+{
+  return std::unique_ptr<environment>();
+}
+
+void environment_snapshot::precompile_in_background()
+{
+  // Nothing is precompiled
+}
+
+bool environment_snapshot::rebuilding_precompiled_header() const
+{
+  return false;
+}
+
+boost::optional<std::chrono::milliseconds>
+  environment_snapshot::last_rebuild_time() const
+{
+  return boost::none;
+}
+
+void metashell::write_environment(
+  std::ostream& out_,
+  const environment_snapshot& env_
+)
+{
+  out_ << format_id << '\n';
+  write_string(out_, env_._content);
+  write_string(out_, env_._prefix);
+  write_string(out_, env_._all);
+  write_string(out_, env_._all_digest);
+  write_string(out_, env_._dependencies_digest);
+  out_ << env_._dependencies_known << '\n';
+  write_string(out_, env_.internal_dir());
+
+  out_ << env_._headers.size() << '\n';
+  for (const unsaved_file& h : env_._headers)
+  {
+    write_string(out_, h.filename());
+    write_string(out_, h.content());
+  }
+
+  out_ << env_._clang_args.size() << '\n';
+  for (const std::string& arg : env_._clang_args)
+  {
+    write_string(out_, arg);
+  }
+}
+
+bool metashell::read_environment(std::istream& in_, environment_snapshot& env_)
+{
+  std::string id;
+  std::string internal_dir;
+  std::size_t header_count;
+  if (
+    !std::getline(in_, id) || id != format_id
+    || !read_string(in_, env_._content)
+    || !read_string(in_, env_._prefix)
+    || !read_string(in_, env_._all)
+    || !read_string(in_, env_._all_digest)
+    || !read_string(in_, env_._dependencies_digest)
+    || !(in_ >> env_._dependencies_known)
+    || in_.get() != '\n'
+    || !read_string(in_, internal_dir)
+    || !read_size(in_, header_count)
+  )
+  {
+    return false;
+  }
+
+  headers hs(internal_dir, true);
+  for (std::size_t i = 0; i != header_count; ++i)
+  {
+    std::string filename;
+    std::string content;
+    if (!read_string(in_, filename) || !read_string(in_, content))
+    {
+      return false;
+    }
+    hs.add(filename, content);
+  }
+  env_._headers = hs;
+
+  std::size_t arg_count;
+  if (!read_size(in_, arg_count))
+  {
+    return false;
+  }
+  env_._clang_args.resize(arg_count);
+  for (std::string& arg : env_._clang_args)
+  {
+    if (!read_string(in_, arg))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
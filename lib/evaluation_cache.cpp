@@ -0,0 +1,217 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/evaluation_cache.hpp>
+#include <metashell/content_hash.hpp>
+#include <metashell/headers.hpp>
+
+#include <boost/algorithm/string/replace.hpp>
+
+#include <vector>
+
+using namespace metashell;
+
+namespace
+{
+  std::size_t memory_used_by(const std::string& key_, const result& r_)
+  {
+    std::size_t m = sizeof(result) + key_.size() + r_.output.size()
+      + r_.info.size();
+    for (const std::string& e : r_.errors)
+    {
+      m += sizeof(std::string) + e.size();
+    }
+    return m;
+  }
+
+  // The internal directory is a different temporary directory in every
+  // Metashell process. It is left out of the keys to make the results
+  // stored on disc reusable by other processes.
+  std::string without_internal_dir(
+    const std::string& s_,
+    const environment& env_
+  )
+  {
+    return
+      boost::algorithm::replace_all_copy(
+        s_,
+        env_.internal_dir(),
+        "<internal_dir>"
+      );
+  }
+}
+
+evaluation_cache::evaluation_cache(std::size_t memory_limit_) :
+  _entries(),
+  _index(),
+  _memory_usage(0),
+  _memory_limit(memory_limit_),
+  _on_disc(),
+  _hits(0),
+  _disc_hits(0),
+  _misses(0)
+{}
+
+evaluation_cache::evaluation_cache(
+  std::size_t memory_limit_,
+  const std::string& directory_,
+  std::size_t disc_limit_,
+  logger* logger_
+) :
+  evaluation_cache(memory_limit_)
+{
+  if (!directory_.empty() && disc_limit_ > 0)
+  {
+    _on_disc = persistent_evaluation_cache(directory_, disc_limit_, logger_);
+  }
+}
+
+std::string evaluation_cache::key(
+  const environment& env_,
+  const std::string& tmp_exp_,
+  const std::string& input_filename_,
+  bool formatted_,
+  bool verbose_
+)
+{
+  std::vector<std::string> args;
+  for (const std::string& arg : env_.clang_arguments())
+  {
+    args.push_back(without_internal_dir(arg, env_));
+  }
+
+  return
+    content_hash()
+      .add(formatted_ ? "formatted" : "unformatted")
+      .add(verbose_ ? "verbose" : "")
+      .add(input_filename_)
+      .add(args)
+      .add(env_.get_headers().digest())
+      .add(env_.get_all_digest())
+      .add(env_.get_dependencies_digest())
+      .add(tmp_exp_)
+      .digest();
+}
+
+boost::optional<result> evaluation_cache::find(const std::string& key_)
+{
+  const auto i = _index.find(key_);
+  if (i != _index.end())
+  {
+    ++_hits;
+    _entries.splice(_entries.begin(), _entries, i->second);
+    return i->second->value;
+  }
+  else
+  {
+    const boost::optional<result> r =
+      _on_disc ? _on_disc->find(key_) : boost::none;
+    if (r)
+    {
+      ++_hits;
+      ++_disc_hits;
+      store_in_memory(key_, *r);
+    }
+    else
+    {
+      ++_misses;
+    }
+    return r;
+  }
+}
+
+void evaluation_cache::store(const std::string& key_, const result& result_)
+{
+  store_in_memory(key_, result_);
+  if (_on_disc)
+  {
+    _on_disc->store(key_, result_);
+  }
+}
+
+void evaluation_cache::store_in_memory(
+  const std::string& key_,
+  const result& result_
+)
+{
+  const std::size_t m = memory_used_by(key_, result_);
+  if (m <= _memory_limit && _index.find(key_) == _index.end())
+  {
+    while (_memory_usage + m > _memory_limit)
+    {
+      drop_least_recently_used();
+    }
+    _entries.push_front(entry{key_, result_, m});
+    _index[key_] = _entries.begin();
+    _memory_usage += m;
+  }
+}
+
+void evaluation_cache::clear()
+{
+  _entries.clear();
+  _index.clear();
+  _memory_usage = 0;
+}
+
+bool evaluation_cache::enabled() const
+{
+  return _memory_limit > 0 || _on_disc;
+}
+
+unsigned evaluation_cache::hits() const
+{
+  return _hits;
+}
+
+unsigned evaluation_cache::disc_hits() const
+{
+  return _disc_hits;
+}
+
+unsigned evaluation_cache::misses() const
+{
+  return _misses;
+}
+
+std::size_t evaluation_cache::size() const
+{
+  return _entries.size();
+}
+
+std::size_t evaluation_cache::memory_usage() const
+{
+  return _memory_usage;
+}
+
+std::size_t evaluation_cache::memory_limit() const
+{
+  return _memory_limit;
+}
+
+const persistent_evaluation_cache* evaluation_cache::on_disc() const
+{
+  return _on_disc ? &*_on_disc : nullptr;
+}
+
+void evaluation_cache::drop_least_recently_used()
+{
+  const entry& last = _entries.back();
+  _memory_usage -= last.memory;
+  _index.erase(last.key);
+  _entries.pop_back();
+}
+
@@ -0,0 +1,114 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/evaluation_pool.hpp>
+#include <metashell/metashell.hpp>
+
+#include <algorithm>
+#include <exception>
+#include <thread>
+
+using namespace metashell;
+
+evaluation_pool::evaluation_pool(unsigned size_, logger* logger_)
+{
+  for (unsigned i = 0; i < std::max(size_, 1u); ++i)
+  {
+    _workers.push_back(
+      std::unique_ptr<evaluation_session>(new evaluation_session(logger_))
+    );
+  }
+}
+
+unsigned evaluation_pool::size() const
+{
+  return _workers.size();
+}
+
+std::vector<result> evaluation_pool::eval_tmp_batch(
+  const environment& env_,
+  const std::vector<std::string>& tmp_exps_,
+  const config& config_,
+  const std::string& input_filename_
+)
+{
+  typedef std::vector<std::string>::const_iterator iterator;
+
+  const std::size_t worker_count =
+    std::min<std::size_t>(_workers.size(), tmp_exps_.size());
+
+  std::vector<std::vector<result>> results(worker_count);
+  std::vector<std::exception_ptr> errors(worker_count);
+
+  const auto evaluate =
+    [&](std::size_t worker_, iterator begin_, iterator end_)
+    {
+      try
+      {
+        results[worker_] =
+          metashell::eval_tmp_batch(
+            env_,
+            std::vector<std::string>(begin_, end_),
+            config_,
+            input_filename_,
+            *_workers[worker_]
+          );
+      }
+      catch (...)
+      {
+        errors[worker_] = std::current_exception();
+      }
+    };
+
+  // Every worker gets a continuous range of the metaprograms. The first one
+  // is evaluated on the calling thread.
+  std::vector<std::thread> threads;
+  for (std::size_t i = 1; i < worker_count; ++i)
+  {
+    threads.push_back(
+      std::thread(
+        evaluate,
+        i,
+        tmp_exps_.begin() + i * tmp_exps_.size() / worker_count,
+        tmp_exps_.begin() + (i + 1) * tmp_exps_.size() / worker_count
+      )
+    );
+  }
+  if (worker_count > 0)
+  {
+    evaluate(
+      0,
+      tmp_exps_.begin(),
+      tmp_exps_.begin() + tmp_exps_.size() / worker_count
+    );
+  }
+  for (std::thread& t : threads)
+  {
+    t.join();
+  }
+
+  std::vector<result> all;
+  all.reserve(tmp_exps_.size());
+  for (std::size_t i = 0; i != worker_count; ++i)
+  {
+    if (errors[i])
+    {
+      std::rethrow_exception(errors[i]);
+    }
+    all.insert(all.end(), results[i].begin(), results[i].end());
+  }
+  return all;
+}
@@ -0,0 +1,152 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/evaluation_session.hpp>
+#include <metashell/headers.hpp>
+
+#include "cxindex.hpp"
+#include "cxtranslationunit.hpp"
+
+#include <clang-c/Index.h>
+
+#include <algorithm>
+
+using namespace metashell;
+
+namespace
+{
+  bool same_file(const unsaved_file& a_, const unsaved_file& b_)
+  {
+    return a_.filename() == b_.filename() && a_.content() == b_.content();
+  }
+
+  bool same_headers(
+    const std::vector<unsaved_file>& a_,
+    const headers& b_
+  )
+  {
+    return
+      a_.size() == b_.size()
+      && std::equal(a_.begin(), a_.end(), b_.begin(), same_file);
+  }
+}
+
+evaluation_session::evaluation_session(logger* logger_) :
+  _index(new cxindex(logger_)),
+  _tu(),
+  _filename(),
+  _clang_args(),
+  _headers(),
+  _env_digest(),
+  _dependencies_digest(),
+  _logger(logger_)
+{}
+
+evaluation_session::~evaluation_session()
+{
+  // The translation unit has to be disposed before the index
+  _tu.reset();
+}
+
+cxtranslationunit& evaluation_session::parse_code(
+  const unsaved_file& src_,
+  const environment& env_
+)
+{
+  if (can_reparse(src_, env_))
+  {
+    METASHELL_LOG(_logger, "Reusing the translation unit of the session.");
+    try
+    {
+      _tu->reparse(env_, src_);
+      return *_tu;
+    }
+    catch (...)
+    {
+      // libclang has disposed the translation unit. Fall back to building a
+      // new one.
+      reset();
+    }
+  }
+  else if (_tu)
+  {
+    METASHELL_LOG(
+      _logger,
+      "The environment has changed since the last parse. Dropping the"
+      " translation unit of the session."
+    );
+    reset();
+  }
+
+  _tu =
+    _index->parse_code(
+      src_,
+      env_,
+      clang_defaultEditingTranslationUnitOptions()
+    );
+  remember_input(src_, env_);
+  return *_tu;
+}
+
+void evaluation_session::reset()
+{
+  _tu.reset();
+  _filename.clear();
+  _clang_args.clear();
+  _headers.clear();
+  _env_digest.clear();
+  _dependencies_digest.clear();
+}
+
+bool evaluation_session::has_translation_unit() const
+{
+  return bool(_tu);
+}
+
+logger* evaluation_session::get_logger() const
+{
+  return _logger;
+}
+
+bool evaluation_session::can_reparse(
+  const unsaved_file& src_,
+  const environment& env_
+) const
+{
+  // The parts of the environment that are not in the main file (eg. the
+  // content of the precompiled header) are not checked by libclang during
+  // reparsing, thus the translation unit is rebuilt when they change.
+  return
+    _tu
+    && _filename == src_.filename()
+    && _clang_args == env_.clang_arguments()
+    && same_headers(_headers, env_.get_headers())
+    && _env_digest == env_.get_all_digest()
+    && _dependencies_digest == env_.get_dependencies_digest();
+}
+
+void evaluation_session::remember_input(
+  const unsaved_file& src_,
+  const environment& env_
+)
+{
+  _filename = src_.filename();
+  _clang_args = env_.clang_arguments();
+  _headers.assign(env_.get_headers().begin(), env_.get_headers().end());
+  _env_digest = env_.get_all_digest();
+  _dependencies_digest = env_.get_dependencies_digest();
+}
+
@@ -0,0 +1,173 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/file_lock.hpp>
+#include <metashell/exception.hpp>
+
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <sys/file.h>
+#  include <sys/stat.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#  include <cerrno>
+#  include <cstring>
+#endif
+
+#include <memory>
+
+using namespace metashell;
+
+namespace
+{
+#ifdef _WIN32
+  // The locks are mandatory on Windows, thus a region after the end of the
+  // file is locked to let others read the file.
+  const DWORD lock_offset_high = 0xffffffff;
+#endif
+}
+
+file_lock::file_lock(const std::string& path_, mode mode_) :
+  file_lock(path_, mode_, true, nullptr)
+{}
+
+file_lock::file_lock(
+  const std::string& path_,
+  mode mode_,
+  bool wait_,
+  bool* locked_
+) :
+  _path(path_)
+{
+#ifdef _WIN32
+  _handle =
+    CreateFileA(
+      path_.c_str(),
+      GENERIC_READ | GENERIC_WRITE,
+      FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+      nullptr,
+      OPEN_ALWAYS,
+      FILE_ATTRIBUTE_NORMAL,
+      nullptr
+    );
+  if (_handle == INVALID_HANDLE_VALUE)
+  {
+    throw exception("Failed to open " + path_);
+  }
+
+  OVERLAPPED o = {};
+  o.OffsetHigh = lock_offset_high;
+  if (
+    LockFileEx(
+      _handle,
+      (mode_ == mode::exclusive ? LOCKFILE_EXCLUSIVE_LOCK : 0)
+      | (wait_ ? 0 : LOCKFILE_FAIL_IMMEDIATELY),
+      0,
+      1,
+      0,
+      &o
+    )
+  )
+  {
+    if (locked_)
+    {
+      *locked_ = true;
+    }
+  }
+  else
+  {
+    CloseHandle(_handle);
+    _handle = INVALID_HANDLE_VALUE;
+    if (wait_)
+    {
+      throw exception("Failed to lock " + path_);
+    }
+  }
+#else
+  const int op =
+    (mode_ == mode::exclusive ? LOCK_EX : LOCK_SH) | (wait_ ? 0 : LOCK_NB);
+
+  for (;;)
+  {
+    _fd = open(path_.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (_fd == -1)
+    {
+      throw exception("Failed to open " + path_ + ": " + std::strerror(errno));
+    }
+
+    int r;
+    while ((r = flock(_fd, op)) == -1 && errno == EINTR) {}
+    if (r == -1)
+    {
+      const int err = errno;
+      close(_fd);
+      _fd = -1;
+      if (wait_ || err != EWOULDBLOCK)
+      {
+        throw exception("Failed to lock " + path_ + ": " + std::strerror(err));
+      }
+      return;
+    }
+
+    // The file may have been deleted by the previous owner of the lock.
+    // Locking that file would not exclude the ones locking the new file.
+    struct stat st;
+    if (fstat(_fd, &st) == 0 && st.st_nlink == 0)
+    {
+      close(_fd);
+      _fd = -1;
+    }
+    else
+    {
+      if (locked_)
+      {
+        *locked_ = true;
+      }
+      return;
+    }
+  }
+#endif
+}
+
+file_lock::~file_lock()
+{
+#ifdef _WIN32
+  if (_handle != INVALID_HANDLE_VALUE)
+  {
+    CloseHandle(_handle);
+  }
+#else
+  if (_fd != -1)
+  {
+    // Closing the file releases the lock
+    close(_fd);
+  }
+#endif
+}
+
+file_lock* file_lock::try_lock(const std::string& path_, mode mode_)
+{
+  bool locked = false;
+  std::unique_ptr<file_lock> l(new file_lock(path_, mode_, false, &locked));
+  return locked ? l.release() : nullptr;
+}
+
+const std::string& file_lock::path() const
+{
+  return _path;
+}
+
@@ -0,0 +1,211 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/file_watcher.hpp>
+
+#include <boost/filesystem.hpp>
+
+#ifdef __linux__
+#  include <sys/inotify.h>
+#  include <fcntl.h>
+#  include <poll.h>
+#  include <unistd.h>
+#  include <cerrno>
+#  include <cstring>
+#endif
+
+#include <set>
+
+using namespace metashell;
+
+file_watcher::file_watcher(
+  logger* logger_,
+  const std::function<void ()>& changed_
+) :
+  _logger(logger_),
+  _fd(-1),
+  _watches(),
+  _changed_callback(changed_),
+  _stop_fds{-1, -1},
+  _thread(),
+  _changed(false)
+{
+#ifdef __linux__
+  _fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (_fd == -1)
+  {
+    METASHELL_LOG(
+      _logger,
+      std::string("Failed to initialise inotify: ") + std::strerror(errno)
+    );
+  }
+  else if (_changed_callback)
+  {
+    if (pipe2(_stop_fds, O_CLOEXEC) == 0)
+    {
+      _thread = std::thread([this] { wait_for_events(); });
+    }
+    else
+    {
+      // The changes are noticed only by calling changed
+      METASHELL_LOG(
+        _logger,
+        std::string("Failed to create pipe: ") + std::strerror(errno)
+      );
+      _stop_fds[0] = _stop_fds[1] = -1;
+    }
+  }
+#endif
+}
+
+file_watcher::~file_watcher()
+{
+#ifdef __linux__
+  if (_thread.joinable())
+  {
+    const char stop = 0;
+    while (write(_stop_fds[1], &stop, 1) == -1 && errno == EINTR) {}
+    _thread.join();
+  }
+  for (int fd : _stop_fds)
+  {
+    if (fd != -1)
+    {
+      close(fd);
+    }
+  }
+  if (_fd != -1)
+  {
+    close(_fd);
+  }
+#endif
+}
+
+void file_watcher::watch(const std::vector<std::string>& files_)
+{
+  remove_watches();
+
+#ifdef __linux__
+  if (_fd != -1)
+  {
+    std::set<std::string> dirs;
+    for (const std::string& f : files_)
+    {
+      dirs.insert(boost::filesystem::path(f).parent_path().string());
+    }
+
+    for (const std::string& d : dirs)
+    {
+      const int w =
+        inotify_add_watch(
+          _fd,
+          d.c_str(),
+          IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE
+        );
+      if (w == -1)
+      {
+        // The changes of the files in this directory are not noticed
+        // automatically. They are noticed by reloading the environment.
+        METASHELL_LOG(
+          _logger,
+          "Failed to watch " + d + ": " + std::strerror(errno)
+        );
+      }
+      else
+      {
+        _watches.push_back(w);
+      }
+    }
+  }
+#endif
+}
+
+bool file_watcher::changed()
+{
+  // The background thread reads the events when it is running
+  return _thread.joinable() ? _changed.exchange(false) : read_events();
+}
+
+bool file_watcher::read_events()
+{
+  bool result = false;
+#ifdef __linux__
+  if (_fd != -1)
+  {
+    // The files are compared to their recorded state by the caller, thus
+    // only the removal of the old watches is filtered out.
+    alignas(inotify_event) char buff[4096];
+    ssize_t len;
+    while ((len = read(_fd, buff, sizeof(buff))) > 0)
+    {
+      for (ssize_t i = 0; i < len; )
+      {
+        const inotify_event* e =
+          reinterpret_cast<const inotify_event*>(buff + i);
+        if ((e->mask & IN_IGNORED) == 0)
+        {
+          result = true;
+        }
+        i += sizeof(inotify_event) + e->len;
+      }
+    }
+  }
+#endif
+  return result;
+}
+
+void file_watcher::wait_for_events()
+{
+#ifdef __linux__
+  for (;;)
+  {
+    pollfd fds[] = {{_fd, POLLIN, 0}, {_stop_fds[0], POLLIN, 0}};
+    if (poll(fds, 2, -1) == -1)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      METASHELL_LOG(
+        _logger,
+        std::string("Failed to wait for file changes: ") + std::strerror(errno)
+      );
+      return;
+    }
+    else if (fds[1].revents != 0 || (fds[0].revents & ~POLLIN) != 0)
+    {
+      return;
+    }
+    else if (read_events())
+    {
+      _changed = true;
+      _changed_callback();
+    }
+  }
+#endif
+}
+
+void file_watcher::remove_watches()
+{
+#ifdef __linux__
+  for (int w : _watches)
+  {
+    inotify_rm_watch(_fd, w);
+  }
+#endif
+  _watches.clear();
+}
+
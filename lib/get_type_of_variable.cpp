@@ -19,6 +19,9 @@
 #include <metashell/exception.hpp>
 
 #include <boost/algorithm/string/trim.hpp>
+#include <boost/algorithm/string/predicate.hpp>
+
+#include <sstream>
 
 using namespace metashell;
 
@@ -50,6 +53,14 @@ namespace
         std::string(s_.begin() + prefix_.size(), s_.end() - suffix_.size());
     }
   }
+
+  std::string wrapped_type(cxcursor cursor_)
+  {
+    std::string result =
+      unwrap("wrap<", cursor_.type().canonical_type().spelling(), ">");
+    boost::algorithm::trim(result);
+    return result;
+  }
 }
 
 get_type_of_variable::get_type_of_variable(const std::string& name_) :
@@ -62,15 +73,13 @@ CXChildVisitResult get_type_of_variable::operator()(cxcursor cursor_)
   {
     try
     {
-      _result =
-        unwrap("wrap<", cursor_.type().canonical_type().spelling(), ">");
+      _result = wrapped_type(cursor_);
     }
     catch (const exception&)
     {
       return CXChildVisit_Continue;
     }
-    boost::algorithm::trim(_result);
-    // continue to get the last one
+    return CXChildVisit_Break;
   }
   return CXChildVisit_Continue;
 }
@@ -80,3 +89,45 @@ const std::string& get_type_of_variable::result() const
   return _result;
 }
 
+get_types_of_variables::get_types_of_variables(
+  const std::string& prefix_,
+  int count_
+) :
+  _prefix(prefix_),
+  _result(count_),
+  _not_found(count_)
+{}
+
+CXChildVisitResult get_types_of_variables::operator()(cxcursor cursor_)
+{
+  if (cursor_.kind() == CXCursor_VarDecl)
+  {
+    const std::string name = cursor_.spelling();
+    if (boost::algorithm::starts_with(name, _prefix))
+    {
+      std::istringstream s(name.substr(_prefix.size()));
+      int n;
+      if (
+        s >> n && s.eof() && n >= 0 && n < int(_result.size())
+        && _result[n].empty()
+      )
+      {
+        try
+        {
+          _result[n] = wrapped_type(cursor_);
+          --_not_found;
+        }
+        catch (const exception&)
+        {
+          // ignore it
+        }
+      }
+    }
+  }
+  return _not_found > 0 ? CXChildVisit_Continue : CXChildVisit_Break;
+}
+
+const std::vector<std::string>& get_types_of_variables::result() const
+{
+  return _result;
+}
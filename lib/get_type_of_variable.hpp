@@ -22,6 +22,7 @@
 #include <clang-c/Index.h>
 
 #include <string>
+#include <vector>
 #include <functional>
 
 namespace metashell
@@ -39,6 +40,22 @@ namespace metashell
     std::string _name;
     std::string _result;
   };
+
+  // Reads the types of the variables called <prefix>0 ... <prefix><count-1>
+  // in one visitation.
+  class get_types_of_variables
+  {
+  public:
+    get_types_of_variables(const std::string& prefix_, int count_);
+
+    CXChildVisitResult operator()(cxcursor cursor_);
+
+    const std::vector<std::string>& result() const;
+  private:
+    std::string _prefix;
+    std::vector<std::string> _result;
+    int _not_found;
+  };
 }
 
 #endif
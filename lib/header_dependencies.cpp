@@ -0,0 +1,200 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/header_dependencies.hpp>
+#include <metashell/serialisation.hpp>
+
+#include <boost/filesystem.hpp>
+
+#include <fstream>
+#include <istream>
+#include <iterator>
+#include <ostream>
+
+using namespace metashell;
+
+namespace
+{
+  // The modification times have a resolution of one second (or worse), thus
+  // a file modified in the same second as it was recorded might be
+  // different from the recorded one even when its time and size are the
+  // same.
+  const std::time_t racy_period = 2;
+
+  const char format_id[] = "metashell header dependencies 1";
+
+  bool read_file(const std::string& path_, std::string& content_)
+  {
+    std::ifstream f(path_.c_str(), std::ios::in | std::ios::binary);
+    if (f)
+    {
+      content_.assign(
+        std::istreambuf_iterator<char>(f),
+        std::istreambuf_iterator<char>()
+      );
+      return !f.bad();
+    }
+    else
+    {
+      return false;
+    }
+  }
+}
+
+header_dependencies::header_dependencies() : _headers(), _hash() {}
+
+header_dependencies::header header_dependencies::current_state(
+  const std::string& path_
+)
+{
+  header h{path_, false, 0, 0, std::string(), std::time(nullptr)};
+
+  boost::system::error_code ec;
+  const std::time_t modified = boost::filesystem::last_write_time(path_, ec);
+  if (!ec)
+  {
+    const std::uintmax_t size = boost::filesystem::file_size(path_, ec);
+    std::string content;
+    if (!ec && read_file(path_, content))
+    {
+      h.exists = true;
+      h.modified = modified;
+      h.size = size;
+      h.content_digest = content_hash().add_raw(content).digest();
+    }
+  }
+  return h;
+}
+
+void header_dependencies::add(const std::string& path_)
+{
+  const header h = current_state(path_);
+  _headers.push_back(h);
+  _hash.add(h.path).add(h.exists ? h.content_digest : std::string());
+}
+
+bool header_dependencies::changed() const
+{
+  for (const header& h : _headers)
+  {
+    boost::system::error_code ec;
+    const std::time_t modified =
+      boost::filesystem::last_write_time(h.path, ec);
+    const bool exists = !ec;
+    const std::uintmax_t size =
+      exists ? boost::filesystem::file_size(h.path, ec) : 0;
+
+    if (exists != h.exists)
+    {
+      return true;
+    }
+    else if (
+      exists
+      && (
+        ec
+        || modified != h.modified
+        || size != h.size
+        || modified + racy_period >= h.recorded
+      )
+    )
+    {
+      const header current = current_state(h.path);
+      if (
+        current.exists != h.exists
+        || current.content_digest != h.content_digest
+      )
+      {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+std::string header_dependencies::digest() const
+{
+  return _hash.digest();
+}
+
+std::vector<std::string> header_dependencies::paths() const
+{
+  std::vector<std::string> result;
+  result.reserve(_headers.size());
+  for (const header& h : _headers)
+  {
+    result.push_back(h.path);
+  }
+  return result;
+}
+
+bool header_dependencies::empty() const
+{
+  return _headers.empty();
+}
+
+void metashell::write_header_dependencies(
+  std::ostream& out_,
+  const header_dependencies& deps_
+)
+{
+  out_ << format_id << '\n' << deps_._headers.size() << '\n';
+  for (const header_dependencies::header& h : deps_._headers)
+  {
+    write_string(out_, h.path);
+    write_string(out_, h.content_digest);
+    out_
+      << h.exists << ' ' << h.modified << ' ' << h.size << ' ' << h.recorded
+      << '\n';
+  }
+}
+
+bool metashell::read_header_dependencies(
+  std::istream& in_,
+  header_dependencies& deps_
+)
+{
+  std::string id;
+  std::size_t count;
+  if (std::getline(in_, id) && id == format_id && in_ >> count)
+  {
+    header_dependencies result;
+    for (std::size_t i = 0; i != count; ++i)
+    {
+      header_dependencies::header h;
+      if (
+        in_.get() == '\n'
+        && read_string(in_, h.path)
+        && read_string(in_, h.content_digest)
+        && in_ >> h.exists >> h.modified >> h.size >> h.recorded
+      )
+      {
+        result._headers.push_back(h);
+        result._hash.add(h.path).add(h.exists ? h.content_digest : "");
+      }
+      else
+      {
+        return false;
+      }
+    }
+    deps_ = result;
+    return true;
+  }
+  else
+  {
+    return false;
+  }
+}
+
@@ -17,15 +17,20 @@
 #include <metashell/header_file_environment.hpp>
 #include <metashell/headers.hpp>
 #include <metashell/config.hpp>
-#include <metashell/clang_binary.hpp>
 #include <metashell/exception.hpp>
+#include <metashell/content_hash.hpp>
 
-#include <just/process.hpp>
+#include "cxindex.hpp"
+#include "cxtranslationunit.hpp"
 
-#include <boost/algorithm/string/trim.hpp>
+#include <boost/algorithm/string/join.hpp>
+#include <boost/filesystem.hpp>
 
+#include <algorithm>
+#include <cassert>
 #include <iostream>
 #include <fstream>
+#include <memory>
 #include <vector>
 
 using namespace metashell;
@@ -33,6 +38,32 @@ using namespace metashell;
 namespace
 {
   const char env_fn[] = "metashell_environment.hpp";
+  const char tail_fn[] = "metashell_environment_tail.hpp";
+
+  // The number of appended chunks after which the precompiled header is
+  // rebuilt
+  const int max_tail_layers = 16;
+
+  // Parsing the included headers is what makes the environment expensive
+  // to process, thus they should end up in the precompiled header. False
+  // positives only cause an unnecessary rebuild.
+  bool may_include_headers(const std::string& s_)
+  {
+    return s_.find("include") != std::string::npos;
+  }
+
+  void write_file(const std::string& fn_, const std::string& content_)
+  {
+    std::ofstream f(fn_.c_str());
+    if (f)
+    {
+      f << content_;
+    }
+    else
+    {
+      throw exception("Error saving environment to " + fn_);
+    }
+  }
 
   void extend_to_find_headers_in_local_dir(std::vector<std::string>& v_)
   {
@@ -40,36 +71,282 @@ namespace
     v_.push_back(".");
   }
 
-  void precompile(
-    const std::string& clang_path_,
+  // The environment the precompiled header is built in
+  class precompiling_environment : public environment
+  {
+  public:
+    precompiling_environment(
+      const headers& headers_,
+      const std::vector<std::string>& clang_args_
+    ) :
+      _clang_args(clang_args_),
+      _headers(headers_),
+      _empty()
+    {
+      extend_to_find_headers_in_local_dir(_clang_args);
+      _clang_args.push_back("-w");
+    }
+
+    virtual void append(const std::string&) override {}
+    virtual std::string get() const override { return std::string(); }
+
+    virtual std::string get_appended(const std::string& s_) const override
+    {
+      return s_;
+    }
+
+    virtual std::string internal_dir() const override
+    {
+      return _headers.internal_dir();
+    }
+
+    virtual std::vector<std::string>& clang_arguments() override
+    {
+      return _clang_args;
+    }
+
+    virtual const std::vector<std::string>& clang_arguments() const override
+    {
+      return _clang_args;
+    }
+
+    virtual const headers& get_headers() const override { return _headers; }
+
+    virtual const std::string& get_all() const override { return _empty; }
+
+    virtual std::string get_all_digest() const override
+    {
+      return content_hash().digest();
+    }
+
+    virtual std::string get_dependencies_digest() const override
+    {
+      return std::string();
+    }
+
+    virtual bool dependencies_known() const override { return false; }
+
+    virtual void update(bool) override {}
+
+    virtual bool reload() override { return false; }
+
+    virtual std::unique_ptr<environment> create_successor(
+      const config&,
+      logger*
+    ) const override
+    {
+      return std::unique_ptr<environment>();
+    }
+
+    virtual void precompile_in_background() override {}
+
+    virtual bool rebuilding_precompiled_header() const override
+    {
+      return false;
+    }
+
+    virtual boost::optional<std::chrono::milliseconds> last_rebuild_time()
+      const override
+    {
+      return boost::none;
+    }
+  private:
+    std::vector<std::string> _clang_args;
+    headers _headers;
+    std::string _empty;
+  };
+
+  // The internal headers are served from memory, they are not files to
+  // check.
+  bool is_internal_header(const std::string& path_, const headers& headers_)
+  {
+    const std::string& dir = headers_.internal_dir();
+    return
+      path_.size() > dir.size()
+      && path_.compare(0, dir.size(), dir) == 0
+      && (path_[dir.size()] == '/' || path_[dir.size()] == '\\');
+  }
+
+  header_dependencies precompile(
+    const headers& headers_,
     const std::vector<std::string>& clang_args_,
     const std::string& fn_,
+    const std::string& content_,
     logger* logger_
   )
   {
-    using boost::algorithm::trim_copy;
-
     METASHELL_LOG(logger_, "Generating percompiled header for " + fn_);
 
-    std::vector<std::string> args(clang_args_);
-    extend_to_find_headers_in_local_dir(args);
-    args.push_back("-w");
-    args.push_back("-o");
-    args.push_back(fn_ + ".pch");
-    args.push_back(fn_);
+    const precompiling_environment env(headers_, clang_args_);
+    const std::unique_ptr<cxtranslationunit>
+      tu =
+        cxindex(logger_).parse_code(
+          unsaved_file(fn_, content_),
+          env,
+          CXTranslationUnit_Incomplete | CXTranslationUnit_ForSerialization
+        );
 
-    const just::process::output
-      o = clang_binary(clang_path_, logger_).run(args);
-    const std::string err = o.standard_output() + o.standard_error();
-    if (
-      !err.empty()
-      // clang displays this even when "-w" is used. This can be ignored
-      && trim_copy(err) !=
-        "warning: precompiled header used __DATE__ or __TIME__."
-    )
+    if (tu->has_errors())
+    {
+      throw
+        exception(
+          "Error precompiling header " + fn_ + ": "
+          + boost::algorithm::join(
+              std::vector<std::string>(tu->errors_begin(), tu->errors_end()),
+              "\n"
+            )
+        );
+    }
+
+    tu->save(fn_ + ".pch");
+
+    header_dependencies deps;
+    for (const std::string& f : tu->included_files())
     {
-      throw exception("Error precompiling header " + fn_ + ": " + err);
+      if (!is_internal_header(f, headers_))
+      {
+        deps.add(f);
+      }
     }
+    return deps;
+  }
+
+  header_file_environment::precompiled_header build_precompiled_header(
+    const headers& headers_,
+    const std::vector<std::string>& clang_args_,
+    const std::string& fn_,
+    const std::string& content_,
+    logger* logger_
+  )
+  {
+    const auto start = std::chrono::steady_clock::now();
+
+    // The header is kept next to the precompiled header, thus the
+    // diagnostics pointing into it can be displayed.
+    write_file(fn_, content_);
+    header_dependencies deps =
+      precompile(headers_, clang_args_, fn_, content_, logger_);
+
+    return
+      header_file_environment::precompiled_header{
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now() - start
+        ),
+        std::move(deps),
+        fn_,
+        std::shared_ptr<file_lock>()
+      };
+  }
+
+  header_file_environment::precompiled_header get_cached_precompiled_header(
+    precompiled_header_cache prebuilt_,
+    precompiled_header_cache cache_,
+    const headers& headers_,
+    const std::vector<std::string>& clang_args_,
+    const std::string& fn_,
+    const std::string& content_,
+    logger* logger_
+  )
+  {
+    const auto start = std::chrono::steady_clock::now();
+
+    precompiled_header_cache::entry e;
+    try
+    {
+      // The precompiled headers installed with Metashell are tried first
+      if (
+        const boost::optional<precompiled_header_cache::entry> p =
+          prebuilt_.find(content_, clang_args_, headers_.internal_dir())
+      )
+      {
+        return
+          header_file_environment::precompiled_header{
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+              std::chrono::steady_clock::now() - start
+            ),
+            p->dependencies,
+            p->header,
+            std::shared_ptr<file_lock>()
+          };
+      }
+      else if (!cache_.enabled())
+      {
+        return
+          build_precompiled_header(
+            headers_,
+            clang_args_,
+            fn_,
+            content_,
+            logger_
+          );
+      }
+
+      e =
+        cache_.get(
+          content_,
+          clang_args_,
+          headers_.internal_dir(),
+          [&content_, logger_](
+            const std::string& header_,
+            const std::string& internal_dir_,
+            const std::vector<std::string>& args_
+          )
+          {
+            // The internal headers are on disc in the cache
+            return
+              precompile(
+                headers(internal_dir_, true),
+                args_,
+                header_,
+                content_,
+                logger_
+              );
+          }
+        );
+    }
+    catch (const boost::filesystem::filesystem_error& e_)
+    {
+      METASHELL_LOG(
+        logger_,
+        std::string("Failed to use the precompiled header cache: ")
+        + e_.what()
+      );
+      return
+        build_precompiled_header(headers_, clang_args_, fn_, content_, logger_);
+    }
+
+    return
+      header_file_environment::precompiled_header{
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now() - start
+        ),
+        std::move(e.dependencies),
+        e.header,
+        e.lock
+      };
+  }
+
+  std::string precompiled_header_cache_dir(const config& config_)
+  {
+    return
+      config_.cache_dir.empty() || !config_.use_precompiled_headers ?
+        "" :
+        config_.cache_dir + "/precompiled_headers";
+  }
+
+  std::string prebuilt_precompiled_header_dir(const config& config_)
+  {
+    return
+      config_.use_precompiled_headers ?
+        config_.prebuilt_precompiled_header_dir :
+        "";
+  }
+
+  void remove_precompiled_header(const std::string& fn_)
+  {
+    boost::system::error_code ec;
+    boost::filesystem::remove(fn_, ec);
+    boost::filesystem::remove(fn_ + ".pch", ec);
   }
 }
 
@@ -77,38 +354,132 @@ header_file_environment::header_file_environment(
   const config& config_,
   logger* logger_
 ) :
-  _dir(),
-  _buffer(_dir.path(), config_, "-I" + _dir.path(), logger_),
+  _dir(std::make_shared<just::temp::directory>()),
+  _buffer(_dir->path(), config_, "-I" + _dir->path(), logger_),
   _clang_args(),
-  _empty_headers(_buffer.internal_dir(), true),
+  _headers(_buffer.get_headers()),
   _use_precompiled_headers(config_.use_precompiled_headers),
-  _clang_path(config_.clang_path)
+  _tail(),
+  _tail_layers(0),
+  _precompiled(),
+  _precompiled_dir(),
+  _precompiled_lock(),
+  _cache(
+    precompiled_header_cache_dir(config_),
+    config_.precompiled_header_cache_limit,
+    logger_
+  ),
+  _prebuilt(prebuilt_precompiled_header_dir(config_), 0, logger_),
+  _last_rebuild_time(),
+  _dependencies(),
+  _watcher(
+    config_.watch_headers && config_.use_precompiled_headers ?
+      new file_watcher(logger_, [this] { dependencies_changed(); }) :
+      nullptr
+  ),
+  _dependencies_modified(false),
+  _reloads(0),
+  _rebuild(),
+  _rebuilt(),
+  _tail_since_rebuild(),
+  _layers_since_rebuild(0),
+  _rebuild_requested(false),
+  _rebuild_failed(false)
 {
   _clang_args = _buffer.clang_arguments();
+  extend_to_find_headers_in_local_dir(_clang_args);
+
+  update_headers();
+}
+
+header_file_environment::header_file_environment(
+  const header_file_environment& base_,
+  const config& config_,
+  logger* logger_
+) :
+  header_file_environment(config_, logger_)
+{
+  _buffer.append(base_.get_all());
   if (_use_precompiled_headers)
   {
-    _clang_args.push_back("-include");
-    _clang_args.push_back(env_filename());
+    // The tail of base_ contains everything its precompiled header does not
+    _tail = base_._tail;
+    _tail_layers = base_._tail_layers;
+
+    if (!base_._precompiled.empty())
+    {
+      use_precompiled_header(
+        base_._precompiled,
+        base_._precompiled_dir,
+        base_._precompiled_lock
+      );
+      _dependencies = base_._dependencies;
+      if (_watcher)
+      {
+        _watcher->watch(_dependencies.paths());
+      }
+    }
   }
+  update_headers();
+}
 
-  extend_to_find_headers_in_local_dir(_clang_args);
+header_file_environment::~header_file_environment()
+{
+  // The watcher does not start rebuilds after this
+  _watcher.reset();
 
-  save();
-  _buffer.get_headers().generate();
+  if (_rebuild.valid())
+  {
+    // The temporary directory can not be deleted while it is being used
+    _rebuild.wait();
+  }
 }
 
 void header_file_environment::append(const std::string& s_)
 {
+  const std::lock_guard<std::mutex> lock(_mutex);
+
   _buffer.append(s_);
-  save();
+  if (_use_precompiled_headers)
+  {
+    _tail = _tail.empty() ? s_ : (_tail + '\n' + s_);
+    ++_tail_layers;
+    if (_rebuild.valid())
+    {
+      _tail_since_rebuild =
+        _tail_since_rebuild.empty() ? s_ : (_tail_since_rebuild + '\n' + s_);
+      ++_layers_since_rebuild;
+    }
+    update_headers();
+
+    if (
+      (may_include_headers(s_) && !_rebuild_failed)
+      || _tail_layers >= max_tail_layers
+    )
+    {
+      request_rebuild();
+    }
+  }
+  else
+  {
+    update_headers();
+  }
 }
 
 std::string header_file_environment::get() const
 {
-  return
-    _use_precompiled_headers ?
-      std::string() : // The -include directive includes the header
-      "#include <" + std::string(env_fn) + ">\n";
+  if (_use_precompiled_headers)
+  {
+    // The -include directive includes the precompiled part
+    return
+      _tail.empty() ?
+        std::string() :
+        "#include <" + std::string(tail_fn) + ">\n";
+  }
+  else
+  {
+    return "#include <" + std::string(env_fn) + ">\n";
+  }
 }
 
 std::string header_file_environment::get_appended(const std::string& s_) const
@@ -127,49 +498,311 @@ const std::vector<std::string>&
   return _clang_args;
 }
 
-std::string header_file_environment::env_filename() const
+void header_file_environment::update(bool wait_)
 {
-  return internal_dir() + "/" + env_fn;
+  const std::lock_guard<std::mutex> lock(_mutex);
+  finish_rebuilds(wait_);
 }
 
-void header_file_environment::save()
+void header_file_environment::finish_rebuilds(bool wait_)
 {
-  const std::string fn = env_filename();
+  while (
+    _rebuild.valid()
+    && (
+      wait_
+      || _rebuild.wait_for(std::chrono::seconds(0))
+        == std::future_status::ready
+    )
+  )
   {
-    std::ofstream f(fn.c_str());
-    if (f)
+    finish_rebuild();
+
+    // The environment has been extended since the finished rebuild started
+    if (_rebuild_requested)
     {
-      f << _buffer.get();
+      _rebuild_requested = false;
+      start_rebuild();
     }
-    else
+  }
+
+  if (_watcher)
+  {
+    check_dependencies();
+  }
+}
+
+void header_file_environment::finish_rebuild()
+{
+  const std::string tail_since_rebuild = _tail_since_rebuild;
+  const int layers_since_rebuild = _layers_since_rebuild;
+  _tail_since_rebuild.clear();
+  _layers_since_rebuild = 0;
+
+  precompiled_header p;
+  try
+  {
+    p = _rebuild.get();
+  }
+  catch (const std::exception& e)
+  {
+    // The tail still contains everything the precompiled header would
+    // have contained, thus the environment can be used without it. The
+    // next attempt is made after max_tail_layers appends, otherwise every
+    // append would repeat the failing build.
+    remove_precompiled_header(_rebuilt);
+    _tail_layers = layers_since_rebuild;
+    _rebuild_failed = true;
+    _rebuild_requested = false;
+    METASHELL_LOG(
+      _buffer.get_logger(),
+      std::string("Rebuilding the precompiled header failed: ") + e.what()
+    );
+    return;
+  }
+  _rebuild_failed = false;
+  _last_rebuild_time = p.build_time;
+  _dependencies = std::move(p.dependencies);
+
+  if (p.header != _rebuilt)
+  {
+    // The header written for the rebuild was not used
+    remove_precompiled_header(_rebuilt);
+    use_precompiled_header(p.header, nullptr, p.lock);
+  }
+  else
+  {
+    use_precompiled_header(p.header, _dir, nullptr);
+  }
+  _tail = tail_since_rebuild;
+  _tail_layers = layers_since_rebuild;
+  update_headers();
+
+  if (_watcher)
+  {
+    _watcher->watch(_dependencies.paths());
+  }
+}
+
+bool header_file_environment::reload()
+{
+  const std::lock_guard<std::mutex> lock(_mutex);
+
+  finish_rebuilds(true);
+  if (_use_precompiled_headers && _dependencies.changed())
+  {
+    ++_reloads;
+    request_rebuild();
+    // The old precompiled header should not be used after the reload
+    finish_rebuilds(true);
+    return true;
+  }
+  else
+  {
+    return false;
+  }
+}
+
+std::unique_ptr<environment> header_file_environment::create_successor(
+  const config& config_,
+  logger* logger_
+) const
+{
+  return
+    std::unique_ptr<environment>(
+      new header_file_environment(*this, config_, logger_)
+    );
+}
+
+void header_file_environment::precompile_in_background()
+{
+  const std::lock_guard<std::mutex> lock(_mutex);
+
+  if (_use_precompiled_headers && !_rebuild.valid() && !_tail.empty())
+  {
+    start_rebuild();
+  }
+}
+
+void header_file_environment::dependencies_changed()
+{
+  // Called by the thread of the watcher. The rebuild is started while the
+  // shell is idle, thus the next evaluation does not have to wait for it.
+  const std::lock_guard<std::mutex> lock(_mutex);
+  check_dependencies();
+}
+
+void header_file_environment::check_dependencies()
+{
+  _dependencies_modified = _watcher->changed() || _dependencies_modified;
+
+  // The changes made during a rebuild are checked after it
+  if (_dependencies_modified && !_rebuild.valid())
+  {
+    _dependencies_modified = false;
+    if (_dependencies.changed())
+    {
+      METASHELL_LOG(
+        _buffer.get_logger(),
+        "A header included by the environment has changed"
+      );
+      ++_reloads;
+      start_rebuild();
+    }
+  }
+}
+
+bool header_file_environment::rebuilding_precompiled_header() const
+{
+  const std::lock_guard<std::mutex> lock(_mutex);
+  return _rebuild.valid();
+}
+
+boost::optional<std::chrono::milliseconds>
+  header_file_environment::last_rebuild_time() const
+{
+  return _last_rebuild_time;
+}
+
+std::string header_file_environment::env_filename() const
+{
+  return internal_dir() + "/" + env_fn;
+}
+
+std::string header_file_environment::tail_filename() const
+{
+  return internal_dir() + "/" + tail_fn;
+}
+
+void header_file_environment::update_headers()
+{
+  _headers = _buffer.get_headers();
+
+  if (_precompiled_dir && _precompiled_dir != _dir)
+  {
+    // The precompiled header of an other environment refers to the internal
+    // headers of that environment
+    for (const unsaved_file& h : headers(_precompiled_dir->path()))
     {
-      throw exception("Error saving environment to " + fn);
+      _headers.add(h.filename(), h.content());
     }
   }
 
   if (_use_precompiled_headers)
   {
-    precompile(
-      _clang_path,
+    _headers.add(tail_filename(), _tail);
+  }
+  else
+  {
+    _headers.add(env_filename(), _buffer.get_all());
+  }
+}
+
+void header_file_environment::request_rebuild()
+{
+  // Only one precompiled header is built at a time. The next one is started
+  // by update when the current one has finished, thus the caller does not
+  // have to wait for it.
+  if (_rebuild.valid())
+  {
+    _rebuild_requested = true;
+  }
+  else
+  {
+    start_rebuild();
+  }
+}
+
+void header_file_environment::start_rebuild()
+{
+  assert(!_rebuild.valid());
+
+  // Every version of the environment gets its own header, thus the one
+  // being used by the evaluations is not changed by the rebuild.
+  _rebuilt =
+    internal_dir() + "/metashell_environment_" + _buffer.get_all_digest()
+    + (_reloads > 0 ? "_" + std::to_string(_reloads) : std::string())
+    + ".hpp";
+
+  METASHELL_LOG(
+    _buffer.get_logger(),
+    "Rebuilding the precompiled header in the background"
+  );
+
+  _rebuild =
+    std::async(
+      std::launch::async,
+      get_cached_precompiled_header,
+      _prebuilt,
+      _cache,
+      _buffer.get_headers(),
       _buffer.clang_arguments(),
-      fn,
+      _rebuilt,
+      _buffer.get_all(),
       _buffer.get_logger()
     );
+}
+
+void header_file_environment::use_precompiled_header(
+  const std::string& fn_,
+  const std::shared_ptr<just::temp::directory>& dir_,
+  const std::shared_ptr<file_lock>& lock_
+)
+{
+  // Derived classes may refer to the arguments by their index, thus the
+  // arguments already there are not moved.
+  const auto i =
+    std::find(_clang_args.begin(), _clang_args.end(), _precompiled);
+  if (_precompiled.empty() || i == _clang_args.end())
+  {
+    _clang_args.push_back("-include");
+    _clang_args.push_back(fn_);
+  }
+  else
+  {
+    *i = fn_;
+    // The precompiled headers of other environments are left there
+    if (_precompiled_dir == _dir)
+    {
+      remove_precompiled_header(_precompiled);
+    }
   }
+  _precompiled = fn_;
+  _precompiled_dir = dir_;
+  _precompiled_lock = lock_;
 }
 
 std::string header_file_environment::internal_dir() const
 {
-  return _dir.path();
+  return _dir->path();
 }
 
 const headers& header_file_environment::get_headers() const
 {
-  return _empty_headers;
+  return _headers;
 }
 
-std::string header_file_environment::get_all() const
+const std::string& header_file_environment::get_all() const
 {
   return _buffer.get_all();
 }
 
+std::string header_file_environment::get_all_digest() const
+{
+  return _buffer.get_all_digest();
+}
+
+std::string header_file_environment::get_dependencies_digest() const
+{
+  // Without precompiled headers the included headers are re-read by every
+  // evaluation
+  return
+    _use_precompiled_headers ? _dependencies.digest() : std::string();
+}
+
+bool header_file_environment::dependencies_known() const
+{
+  // The headers included by the tail are added to the dependencies by the
+  // rebuild of the precompiled header. Until it succeeds, they are not
+  // known.
+  return _use_precompiled_headers && !may_include_headers(_tail);
+}
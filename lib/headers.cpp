@@ -19,6 +19,7 @@
 #include <metashell/path_builder.hpp>
 
 #include <boost/algorithm/string/join.hpp>
+#include <boost/algorithm/string/replace.hpp>
 #include <boost/range/adaptors.hpp>
 
 using namespace metashell;
@@ -94,7 +95,8 @@ namespace
 
 headers::headers(const std::string& internal_dir_, bool empty_) :
   _headers(),
-  _internal_dir(internal_dir_)
+  _internal_dir(internal_dir_),
+  _hash()
 {
   if (!empty_)
   {
@@ -145,12 +147,31 @@ headers::headers(const std::string& internal_dir_, bool empty_) :
           "(__VA_ARGS__)"
         ">\n"
     );
+
+    // The formatters extend the definitions of the environment, thus they
+    // can not be compiled as modules.
+    add(
+      internal_dir / "metashell" / "module.modulemap",
+      "module metashell_scalar {\n"
+      "  header \"scalar.hpp\"\n"
+      "  export *\n"
+      "}\n"
+    );
   }
 }
 
 void headers::add(const std::string& filename_, const std::string& content_)
 {
   _headers.push_back(unsaved_file(filename_, content_));
+  _hash
+    .add(
+      boost::algorithm::replace_all_copy(
+        filename_,
+        _internal_dir,
+        "<internal_dir>"
+      )
+    )
+    .add(content_);
 }
 
 headers::iterator headers::begin() const
@@ -163,17 +184,14 @@ headers::iterator headers::end() const
   return _headers.end();
 }
 
-void headers::generate() const
+headers::size_type headers::size() const
 {
-  for (const unsaved_file& h : _headers)
-  {
-    h.generate();
-  }
+  return _headers.size();
 }
 
-headers::size_type headers::size() const
+std::string headers::digest() const
 {
-  return _headers.size();
+  return _hash.digest();
 }
 
 const std::string& headers::internal_dir() const
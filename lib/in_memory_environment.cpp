@@ -70,6 +70,7 @@ in_memory_environment::in_memory_environment(
   logger* logger_
 ) :
   _buffer(),
+  _buffer_hash(),
   _headers(internal_dir_),
   _clang_args(),
   _logger(logger_)
@@ -89,6 +90,18 @@ in_memory_environment::in_memory_environment(
   add_with_prefix("-I", config_.include_path, _clang_args);
   add_with_prefix("-D", config_.macros, _clang_args);
 
+  if (config_.use_modules)
+  {
+    _clang_args.push_back("-fmodules");
+    if (!config_.cache_dir.empty())
+    {
+      // The compiled modules are shared by the environments and processes
+      _clang_args.push_back(
+        "-fmodules-cache-path=" + config_.cache_dir + "/modules"
+      );
+    }
+  }
+
   if (!config_.warnings_enabled)
   {
     _clang_args.push_back("-w");
@@ -108,7 +121,14 @@ in_memory_environment::in_memory_environment(
 
 void in_memory_environment::append(const std::string& s_)
 {
-  _buffer = get_appended(s_);
+  // Extending the buffer in place avoids copying the entire environment
+  if (!_buffer.empty())
+  {
+    _buffer += '\n';
+    _buffer_hash.add_raw("\n");
+  }
+  _buffer += s_;
+  _buffer_hash.add_raw(s_);
 }
 
 std::string in_memory_environment::get() const
@@ -147,11 +167,64 @@ void in_memory_environment::add_clang_arg(const std::string& arg_)
   _clang_args.push_back(arg_);
 }
 
-std::string in_memory_environment::get_all() const
+const std::string& in_memory_environment::get_all() const
 {
   return _buffer;
 }
 
+std::string in_memory_environment::get_all_digest() const
+{
+  return _buffer_hash.digest();
+}
+
+std::string in_memory_environment::get_dependencies_digest() const
+{
+  // Nothing is precompiled
+  return std::string();
+}
+
+bool in_memory_environment::dependencies_known() const
+{
+  // The included headers are re-read by every evaluation
+  return false;
+}
+
+void in_memory_environment::update(bool)
+{
+  // Nothing is done in the background
+}
+
+bool in_memory_environment::reload()
+{
+  // The included headers are re-read by every evaluation, thus they
+  // may have changed
+  return true;
+}
+
+std::unique_ptr<environment> in_memory_environment::create_successor(
+  const config&,
+  logger*
+) const
+{
+  return std::unique_ptr<environment>();
+}
+
+void in_memory_environment::precompile_in_background()
+{
+  // Nothing is precompiled
+}
+
+bool in_memory_environment::rebuilding_precompiled_header() const
+{
+  return false;
+}
+
+boost::optional<std::chrono::milliseconds>
+  in_memory_environment::last_rebuild_time() const
+{
+  return boost::none;
+}
+
 logger* in_memory_environment::get_logger()
 {
   return _logger;
@@ -107,6 +107,19 @@ namespace
               );
             }
           }
+          else if (*type == "cmd_batch")
+          {
+            if (const auto cmds = handler.array_field("cmds"))
+            {
+              command_processor_queue_.lines_available(*cmds, displayer_);
+            }
+            else
+            {
+              displayer_.show_error(
+                "The cmds field of the cmd_batch command is missing"
+              );
+            }
+          }
           else if (*type == "code_completion")
           {
             if (const auto code = handler.field("code"))
@@ -62,6 +62,8 @@ void logger::stop_logging()
 
 void logger::log(const std::string& msg_)
 {
+  std::lock_guard<std::mutex> lock(_mutex);
+
   switch (_mode)
   {
   case logging_mode::none:
@@ -18,7 +18,6 @@
 #include <metashell/mdb_shell.hpp>
 #include <metashell/highlight_syntax.hpp>
 #include <metashell/metashell.hpp>
-#include <metashell/temporary_file.hpp>
 #include <metashell/is_template_type.hpp>
 #include <metashell/forward_trace_iterator.hpp>
 #include <metashell/null_history.hpp>
@@ -40,31 +39,6 @@ namespace
 
   const std::string wrap_prefix = "metashell::impl::wrap<";
   const std::string wrap_suffix = ">";
-
-  typedef
-    std::tuple<
-      metashell::file_location,
-      metashell::instantiation_kind,
-      metashell::metaprogram::vertex_descriptor
-    >
-    set_element_t;
-
-  bool less_than(const set_element_t& lhs, const set_element_t& rhs)
-  {
-    return lhs < rhs;
-  }
-
-  bool less_than_ignore_instantiation_kind(
-    const set_element_t& lhs,
-    const set_element_t& rhs
-  )
-  {
-    using std::get;
-
-    return
-      std::tie(get<0>(lhs), get<2>(lhs)) <
-      std::tie(get<0>(rhs), get<2>(rhs));
-  }
 }
 
 namespace metashell {
@@ -98,7 +72,8 @@ const mdb_command_handler_map mdb_shell::command_handler =
       {{"rbreak"}, non_repeatable, &mdb_shell::command_rbreak,
         "<regex>",
         "Add breakpoint for all types matching `<regex>`.",
-        ""},
+        "While the metaprogram is being loaded, the number of locations the\n"
+        "breakpoint stops at is a lower bound."},
       {{"continue"}, repeatable, &mdb_shell::command_continue,
         "[n]",
         "Continue program being debugged.",
@@ -204,12 +179,20 @@ void mdb_shell::line_available(
   } catch (...) {
     displayer_.show_error("Unknown error\n");
   }
+  display_loading_error(displayer_);
 }
 bool mdb_shell::breakpoint_match(
     metaprogram::vertex_descriptor vertex, const breakpoint_t& breakpoint)
 {
-  return boost::regex_search(
-      mp->get_vertex_property(vertex).name, std::get<1>(breakpoint));
+  const boost::string_ref name = mp->get_vertex_name(vertex);
+  return boost::regex_search(name.begin(), name.end(), std::get<1>(breakpoint));
+}
+
+std::unique_lock<templight_trace_reader> mdb_shell::lock_metaprogram() {
+  return
+    trace ?
+      std::unique_lock<templight_trace_reader>(*trace) :
+      std::unique_lock<templight_trace_reader>();
 }
 
 bool mdb_shell::require_empty_args(
@@ -254,6 +237,8 @@ void mdb_shell::command_continue(
     return;
   }
 
+  const auto lock = lock_metaprogram();
+
   using boost::spirit::qi::int_;
   using boost::spirit::ascii::space;
   using boost::phoenix::ref;
@@ -316,6 +301,8 @@ void mdb_shell::command_step(
     return;
   }
 
+  const auto lock = lock_metaprogram();
+
   using boost::spirit::qi::lit;
   using boost::spirit::qi::int_;
   using boost::spirit::ascii::space;
@@ -418,124 +405,152 @@ std::string mdb_shell::trim_wrap_type(const std::string& type) {
          type.size() - wrap_prefix.size() - wrap_suffix.size()));
 }
 
-void mdb_shell::filter_disable_everything() {
-  for (metaprogram::edge_descriptor edge : mp->get_edges()) {
-    mp->get_edge_property(edge).enabled = false;
+bool mdb_shell::similar_edge_less::operator()(
+  metaprogram::edge_descriptor lhs,
+  metaprogram::edge_descriptor rhs
+) const
+{
+  const metaprogram::edge_property& lhs_property = mp->get_edge_property(lhs);
+  const metaprogram::edge_property& rhs_property = mp->get_edge_property(rhs);
+  const metaprogram::vertex_descriptor lhs_target = mp->get_target(lhs);
+  const metaprogram::vertex_descriptor rhs_target = mp->get_target(rhs);
+
+  if (mp->is_in_full_mode()) {
+    return
+      std::tie(lhs_property.point_of_instantiation, lhs_target) <
+      std::tie(rhs_property.point_of_instantiation, rhs_target);
+  } else {
+    return
+      std::tie(
+        lhs_property.point_of_instantiation,
+        lhs_property.kind,
+        lhs_target
+      ) <
+      std::tie(
+        rhs_property.point_of_instantiation,
+        rhs_property.kind,
+        rhs_target
+      );
   }
 }
 
-
-void mdb_shell::filter_enable_reachable_from_current_line() {
-  using vertex_descriptor = metaprogram::vertex_descriptor;
-  using edge_descriptor = metaprogram::edge_descriptor;
-  using edge_property = metaprogram::edge_property;
-  using discovered_t = metaprogram::discovered_t;
+void mdb_shell::filter_reset() {
+  assert(mp);
 
   std::string env_buffer = env.get();
-  int line_number = std::count(env_buffer.begin(), env_buffer.end(), '\n');
-
-  // We will traverse the interesting edges later
-  std::stack<edge_descriptor> edge_stack;
-
-  // Enable the interesting root edges
-  for (edge_descriptor edge : mp->get_out_edges(mp->get_root_vertex())) {
-    edge_property& property = mp->get_edge_property(edge);
-    const std::string& target_name =
-      mp->get_vertex_property(mp->get_target(edge)).name;
-    // Filter out edges, that is not instantiated by the entered type
-    if (property.point_of_instantiation.name == internal_file_name &&
-        property.point_of_instantiation.row == line_number + 1 &&
-        (property.kind == instantiation_kind::template_instantiation ||
-        property.kind == instantiation_kind::memoization) &&
-        (!is_wrap_type(target_name) ||
-         property.kind != instantiation_kind::memoization))
-    {
-      property.enabled = true;
-      edge_stack.push(edge);
-    }
+  filter_line = std::count(env_buffer.begin(), env_buffer.end(), '\n');
+
+  filter_wrapped_vertices.clear();
+  filter_non_template_vertices.clear();
+  filter_reachable_vertices.clear();
+  filter_similar_edges.clear();
+  filter_non_template_edges.clear();
+
+  for (metaprogram::vertex_descriptor vertex : mp->get_vertices()) {
+    filter_vertex(vertex);
   }
+}
 
-  discovered_t discovered(mp->get_num_vertices());
-  // Traverse the graph to enable all edges which are reachable from the
-  // edges enabled above
-  while (!edge_stack.empty()) {
-    edge_descriptor edge = edge_stack.top();
-    edge_stack.pop();
+void mdb_shell::filter_vertex(metaprogram::vertex_descriptor vertex) {
+  assert(filter_reachable_vertices.size() == vertex);
 
-    assert(mp->get_edge_property(edge).enabled);
+  std::string name = mp->get_vertex_name(vertex).to_string();
+  const bool wrapped = is_wrap_type(name);
+  if (wrapped) {
+    name = trim_wrap_type(name);
+    mp->set_vertex_name(vertex, name);
+  }
 
-    vertex_descriptor vertex = mp->get_target(edge);
+  filter_wrapped_vertices.push_back(wrapped);
+  filter_non_template_vertices.push_back(wrapped && !is_template_type(name));
+  filter_reachable_vertices.push_back(false);
+  filter_similar_edges.push_back(similar_edges_t(similar_edge_less{&*mp}));
+}
 
-    if (discovered[vertex]) {
-      continue;
-    }
+// Called for every edge when it is added to the metaprogram. It enables
+// the edges which are reachable from the edges instantiated by the
+// evaluated type, except for the ones similar to an earlier out edge of the
+// same vertex (Clang sometimes produces equivalent instantiation events
+// from the same point). It also unwraps the names of the vertices.
+void mdb_shell::filter_edge(metaprogram::edge_descriptor edge) {
+  using vertex_descriptor = metaprogram::vertex_descriptor;
+  using edge_property = metaprogram::edge_property;
 
-    for (edge_descriptor out_edge : mp->get_out_edges(vertex)) {
-      edge_property& property = mp->get_edge_property(out_edge);
-      if (property.kind == instantiation_kind::template_instantiation ||
-         property.kind == instantiation_kind::memoization)
-      {
-        property.enabled = true;
-        edge_stack.push(out_edge);
-      }
+  const vertex_descriptor source = mp->get_source(edge);
+  const vertex_descriptor target = mp->get_target(edge);
+
+  while (filter_reachable_vertices.size() <= target) {
+    filter_vertex(filter_reachable_vertices.size());
+  }
+
+  edge_property& property = mp->get_edge_property(edge);
+
+  const bool followed = is_followed_by_filter(edge);
+  const bool reachable =
+    source == mp->get_root_vertex() ?
+      // Filter out edges, that is not instantiated by the entered type
+      property.point_of_instantiation.name == internal_file_name &&
+        property.point_of_instantiation.row == filter_line + 1 &&
+        followed &&
+        (!filter_wrapped_vertices[target] ||
+         property.kind != instantiation_kind::memoization) :
+      followed && filter_reachable_vertices[source];
+
+  if (filter_non_template_vertices[target]) {
+    if (followed) {
+      filter_non_template_edges.insert(edge);
     }
+    property.kind = instantiation_kind::non_template_type;
   }
-}
 
-void mdb_shell::filter_unwrap_vertices() {
-  for (metaprogram::vertex_descriptor vertex : mp->get_vertices()) {
-    std::string& name = mp->get_vertex_property(vertex).name;
-    if (is_wrap_type(name)) {
-      name = trim_wrap_type(name);
-      if (!is_template_type(name)) {
-        for (metaprogram::edge_descriptor in_edge : mp->get_in_edges(vertex)) {
-          mp->get_edge_property(in_edge).kind =
-            instantiation_kind::non_template_type;
-        }
-      }
+  property.enabled = false;
+  if (
+    source == mp->get_root_vertex() || filter_reachable_vertices[source]
+  ) {
+    const bool similar = !filter_similar_edges[source].insert(edge).second;
+    if (reachable) {
+      property.enabled = !similar;
+      filter_enable_reachable_from(target);
     }
   }
 }
 
-void mdb_shell::filter_similar_edges() {
-
+void mdb_shell::filter_enable_reachable_from(
+  metaprogram::vertex_descriptor vertex)
+{
   using vertex_descriptor = metaprogram::vertex_descriptor;
   using edge_descriptor = metaprogram::edge_descriptor;
-  using edge_property = metaprogram::edge_property;
-
-  auto comparator =
-    mp->is_in_full_mode() ? less_than_ignore_instantiation_kind : less_than;
-
-  // Clang sometimes produces equivalent instantiations events from the same
-  // point. Filter out all but one of each
-  for (vertex_descriptor vertex : mp->get_vertices()) {
 
-    std::set<set_element_t, decltype(comparator)> similar_edges(comparator);
+  // The edges loaded before the vertex became reachable are enabled now
+  std::stack<vertex_descriptor> vertex_stack;
+  vertex_stack.push(vertex);
 
-    for (edge_descriptor edge : mp->get_out_edges(vertex)) {
-      edge_property& edge_property = mp->get_edge_property(edge);
+  while (!vertex_stack.empty()) {
+    vertex_descriptor current = vertex_stack.top();
+    vertex_stack.pop();
 
-      set_element_t set_element = std::make_tuple(
-            edge_property.point_of_instantiation,
-            edge_property.kind,
-            mp->get_target(edge));
+    if (filter_reachable_vertices[current]) {
+      continue;
+    }
+    filter_reachable_vertices[current] = true;
 
-      if (similar_edges.count(set_element) > 0) {
-        edge_property.enabled = false;
-      } else {
-        similar_edges.insert(set_element);
+    for (edge_descriptor edge : mp->get_out_edges(current)) {
+      const bool similar = !filter_similar_edges[current].insert(edge).second;
+      if (is_followed_by_filter(edge)) {
+        mp->get_edge_property(edge).enabled = !similar;
+        vertex_stack.push(mp->get_target(edge));
       }
     }
   }
 }
 
-void mdb_shell::filter_metaprogram() {
-  assert(mp);
-
-  filter_disable_everything();
-  filter_enable_reachable_from_current_line();
-  filter_unwrap_vertices();
-  filter_similar_edges();
+bool mdb_shell::is_followed_by_filter(metaprogram::edge_descriptor edge) const
+{
+  const instantiation_kind kind = mp->get_edge_property(edge).kind;
+  return
+    kind == instantiation_kind::template_instantiation ||
+    kind == instantiation_kind::memoization ||
+    filter_non_template_edges.count(edge) > 0;
 }
 
 void mdb_shell::command_evaluate(
@@ -560,7 +575,8 @@ void mdb_shell::command_evaluate(
       displayer_.show_error("Nothing has been evaluated yet.");
       return;
     }
-    type = mp->get_vertex_property(mp->get_root_vertex()).name;
+    const auto lock = lock_metaprogram();
+    type = mp->get_vertex_name(mp->get_root_vertex()).to_string();
   }
 
   breakpoints.clear();
@@ -568,15 +584,16 @@ void mdb_shell::command_evaluate(
   if (!run_metaprogram_with_templight(type, has_full, displayer_)) {
     return;
   }
+  // The rest of the trace is loaded while the metaprogram is being debugged
   displayer_.show_raw_text("Metaprogram started");
-
-  filter_metaprogram();
 }
 
 void mdb_shell::command_forwardtrace(
     const std::string& arg,
     iface::displayer& displayer_)
 {
+  const auto lock = lock_metaprogram();
+
   if (!require_running_metaprogram(displayer_)) {
     return;
   }
@@ -607,6 +624,7 @@ void mdb_shell::command_forwardtrace(
     return;
   }
 
+  mp->wait_until_loaded(mp->get_current_vertex());
   display_current_forwardtrace(max_depth, displayer_);
 }
 
@@ -614,6 +632,8 @@ void mdb_shell::command_backtrace(
     const std::string& arg,
     iface::displayer& displayer_)
 {
+  const auto lock = lock_metaprogram();
+
   if (
     require_empty_args(arg, displayer_)
     && require_running_metaprogram(displayer_)
@@ -633,6 +653,7 @@ void mdb_shell::command_rbreak(
   if (!require_evaluated_metaprogram(displayer_)) {
     return;
   }
+  const auto lock = lock_metaprogram();
   try {
     breakpoint_t breakpoint = std::make_tuple(arg, boost::regex(arg));
 
@@ -642,7 +663,16 @@ void mdb_shell::command_rbreak(
         match_count += mp->get_traversal_count(vertex);
       }
     }
-    if (match_count == 0) {
+    if (!trace->is_loaded()) {
+      // The rest of the trace may have more matching locations
+      displayer_.show_raw_text(
+          match_count == 0 ?
+            "Breakpoint \"" + arg + "\" has not matched any location yet" :
+            "Breakpoint \"" + arg + "\" will stop the execution on at least " +
+              std::to_string(match_count) +
+              (match_count > 1 ? " locations" : " location"));
+      breakpoints.push_back(breakpoint);
+    } else if (match_count == 0) {
       displayer_.show_raw_text(
           "Breakpoint \"" + arg + "\" will never stop the execution");
     } else {
@@ -717,20 +747,41 @@ void mdb_shell::command_quit(
 bool mdb_shell::run_metaprogram_with_templight(
     const std::string& str, bool full_mode, iface::displayer& displayer_)
 {
-  temporary_file templight_xml_file("templight.xml");
-  std::string xml_path = templight_xml_file.get_path();
+  // Loading the previous metaprogram is stopped before it is replaced
+  trace.reset();
+  mp = metaprogram(full_mode, str, type());
+  filter_reset();
+
+  trace.reset(
+    new templight_trace_reader(
+      binary_trace,
+      *mp,
+      [this](metaprogram::edge_descriptor edge) { filter_edge(edge); }
+    )
+  );
 
-  env.set_xml_location(xml_path);
+  env.set_trace_location(trace->get_path());
 
   boost::optional<type> evaluation_result = run_metaprogram(str, displayer_);
 
   if (!evaluation_result) {
+    trace.reset();
     mp = boost::none;
     return false;
   }
 
-  mp = metaprogram::create_from_xml_file(
-      xml_path, full_mode, str, *evaluation_result);
+  if (!trace->evaluation_finished()) {
+    // Templight ignored the binary format, the metaprogram is evaluated
+    // again with the XML one.
+    METASHELL_LOG(_logger, "Binary templight trace is not supported");
+    binary_trace = false;
+    env.set_trace_format("xml");
+    return run_metaprogram_with_templight(str, full_mode, displayer_);
+  }
+
+  const auto lock = lock_metaprogram();
+  mp->set_evaluation_result(*evaluation_result);
+  mp->set_loader(trace.get());
   return true;
 }
 
@@ -815,6 +866,15 @@ void mdb_shell::display_metaprogram_finished(
   displayer_.show_type(mp->get_evaluation_result());
 }
 
+void mdb_shell::display_loading_error(iface::displayer& displayer_) {
+  if (trace) {
+    const auto lock = lock_metaprogram();
+    if (const boost::optional<std::string> error = trace->take_error()) {
+      displayer_.show_error("Error: " + *error + "\n");
+    }
+  }
+}
+
 void mdb_shell::cancel_operation() {
   // TODO
 }
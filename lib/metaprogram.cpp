@@ -20,8 +20,8 @@
 #include <tuple>
 #include <cassert>
 #include <algorithm>
+#include <iterator>
 
-#include <boost/range/adaptor/reversed.hpp>
 
 namespace metashell {
 
@@ -36,8 +36,18 @@ metaprogram::metaprogram(
   reset_state();
 }
 
+string_table::id metaprogram::intern_name(boost::string_ref name) {
+  return names.intern(name);
+}
+
+metaprogram::vertex_descriptor metaprogram::add_vertex(
+  boost::string_ref element)
+{
+  return add_vertex(intern_name(element));
+}
+
 metaprogram::vertex_descriptor metaprogram::add_vertex(
-  const std::string& element)
+  string_table::id element)
 {
   vertex_descriptor vertex = boost::add_vertex(graph);
 
@@ -74,6 +84,18 @@ const type& metaprogram::get_evaluation_result() const {
   return evaluation_result;
 }
 
+void metaprogram::set_evaluation_result(const type& result) {
+  evaluation_result = result;
+}
+
+void metaprogram::set_loader(loader* loader_) {
+  trace_loader = loader_;
+}
+
+void metaprogram::wait_until_loaded(vertex_descriptor vertex) {
+  while (is_open(vertex) && wait_for_more_events()) {}
+}
+
 void metaprogram::reset_state() {
   unsigned vertex_count = get_num_vertices();
   assert(vertex_count > 0);
@@ -82,6 +104,7 @@ void metaprogram::reset_state() {
   state.parent_edge = parent_edge_t(vertex_count, boost::none);
   state.edge_stack = edge_stack_t();
   state.edge_stack.push(boost::none);
+  state.continuations = continuation_stack_t();
 
   state_history = state_history_t();
 }
@@ -126,6 +149,7 @@ void metaprogram::step(direction_t direction) {
 void metaprogram::step() {
   assert(!is_finished());
   step_rollback_t rollback;
+  rollback.continuations_kept = state.continuations.size();
 
   vertex_descriptor current_vertex = get_current_vertex();
   rollback.popped_edge = state.edge_stack.top();
@@ -137,18 +161,23 @@ void metaprogram::step() {
       rollback.discovered_vertex = current_vertex;
     }
 
-    auto reverse_edge_range =
-      get_out_edges(current_vertex) |boost::adaptors::reversed;
+    const std::size_t edge_stack_size = state.edge_stack.size();
+    const degree_size_type out_degree =
+      boost::out_degree(current_vertex, graph);
 
-    rollback.edge_stack_push_count = 0;
-    for (edge_descriptor edge : reverse_edge_range) {
-      if (get_edge_property(edge).enabled) {
-        state.edge_stack.push(edge);
-        ++rollback.edge_stack_push_count;
-      }
+    rollback.edge_stack_push_count =
+      push_out_edges(current_vertex, 0, out_degree);
+
+    if (is_open(current_vertex)) {
+      state.continuations.push(
+        continuation_t{current_vertex, out_degree, edge_stack_size});
     }
   }
 
+  // The loaded instantiations of the open vertices are visited when the
+  // traversal gets to them. It has to wait for the rest.
+  rollback.edge_stack_push_count += continue_open_vertices(rollback);
+
   if (!state.edge_stack.empty()) {
     assert(state.edge_stack.top());
     rollback.set_parent_edge = state.parent_edge[get_current_vertex()];
@@ -171,6 +200,18 @@ void metaprogram::step_back() {
     state.edge_stack.pop();
   }
 
+  while (state.continuations.size() > rollback.continuations_kept) {
+    state.continuations.pop();
+  }
+  for (
+    auto i = rollback.removed_continuations.rbegin(),
+      e = rollback.removed_continuations.rend();
+    i != e;
+    ++i
+  ) {
+    state.continuations.push(*i);
+  }
+
   if (rollback.discovered_vertex) {
     state.discovered[*rollback.discovered_vertex] = false;
   }
@@ -180,6 +221,73 @@ void metaprogram::step_back() {
   state_history.pop();
 }
 
+bool metaprogram::is_open(vertex_descriptor vertex) const {
+  return trace_loader && trace_loader->is_open(vertex);
+}
+
+bool metaprogram::wait_for_more_events() {
+  assert(trace_loader);
+
+  if (!trace_loader->wait_for_more_events()) {
+    trace_loader = nullptr;
+    return false;
+  }
+  return true;
+}
+
+unsigned metaprogram::push_out_edges(
+    vertex_descriptor vertex,
+    degree_size_type begin,
+    degree_size_type end)
+{
+  const out_edge_iterator first = boost::out_edges(vertex, graph).first;
+
+  unsigned push_count = 0;
+  for (degree_size_type i = end; i != begin; --i) {
+    const edge_descriptor edge = *std::next(first, i - 1);
+    if (get_edge_property(edge).enabled) {
+      state.edge_stack.push(edge);
+      ++push_count;
+    }
+  }
+  return push_count;
+}
+
+unsigned metaprogram::continue_open_vertices(step_rollback_t& rollback) {
+  unsigned push_count = 0;
+  while (
+    !state.continuations.empty() &&
+    state.continuations.top().edge_stack_size == state.edge_stack.size()
+  ) {
+    const continuation_t continuation = state.continuations.top();
+    const degree_size_type out_degree =
+      boost::out_degree(continuation.vertex, graph);
+
+    if (continuation.next_edge == out_degree && is_open(continuation.vertex)) {
+      wait_for_more_events();
+    } else {
+      save_top_continuation(rollback);
+      if (is_open(continuation.vertex)) {
+        state.continuations.top().next_edge = out_degree;
+      } else {
+        state.continuations.pop();
+      }
+      push_count +=
+        push_out_edges(continuation.vertex, continuation.next_edge, out_degree);
+    }
+  }
+  return push_count;
+}
+
+void metaprogram::save_top_continuation(step_rollback_t& rollback) {
+  assert(!state.continuations.empty());
+
+  if (state.continuations.size() == rollback.continuations_kept) {
+    rollback.removed_continuations.push_back(state.continuations.top());
+    --rollback.continuations_kept;
+  }
+}
+
 const metaprogram::graph_t& metaprogram::get_graph() const {
   return graph;
 }
@@ -276,6 +384,18 @@ metaprogram::edge_property& metaprogram::get_edge_property(
   return boost::get(edge_property_tag(), graph, edge);
 }
 
+boost::string_ref metaprogram::get_vertex_name(vertex_descriptor vertex) const
+{
+  return names.get(get_vertex_property(vertex).name);
+}
+
+void metaprogram::set_vertex_name(
+    vertex_descriptor vertex,
+    boost::string_ref name)
+{
+  get_vertex_property(vertex).name = intern_name(name);
+}
+
 metaprogram::vertex_descriptor metaprogram::get_current_vertex() const {
   assert(!is_finished());
 
@@ -294,7 +414,7 @@ metaprogram::optional_edge_descriptor metaprogram::get_current_edge() const {
 
 frame metaprogram::to_frame(const edge_descriptor& e_) const
 {
-  const type t(get_vertex_property(get_target(e_)).name);
+  const type t(get_vertex_name(get_target(e_)).to_string());
   return is_in_full_mode() ? frame(t) : frame(t, get_edge_property(e_).kind);
 }
 
@@ -305,7 +425,7 @@ frame metaprogram::get_current_frame() const {
 }
 
 frame metaprogram::get_root_frame() const {
-  return frame(type(get_vertex_property(get_root_vertex()).name));
+  return frame(type(get_vertex_name(get_root_vertex()).to_string()));
 }
 
 backtrace metaprogram::get_backtrace() const {
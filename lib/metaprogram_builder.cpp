@@ -0,0 +1,102 @@
+
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2014, Andras Kucsma (andras.kucsma@gmail.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/metaprogram_builder.hpp>
+#include <metashell/exception.hpp>
+
+#include <limits>
+
+namespace metashell {
+
+namespace {
+
+const metaprogram::vertex_descriptor no_vertex =
+  std::numeric_limits<metaprogram::vertex_descriptor>::max();
+
+}
+
+metaprogram_builder::metaprogram_builder(
+    metaprogram& mp,
+    const edge_added_callback& edge_added) :
+  mp(mp),
+  edge_added(edge_added),
+  open_count(mp.get_num_vertices())
+{}
+
+void metaprogram_builder::handle_template_begin(
+  instantiation_kind kind,
+  const std::string& context,
+  const file_location& point_of_instantiation,
+  double /* timestamp */,
+  unsigned long long /* memory_usage */)
+{
+  vertex_descriptor vertex = add_vertex(context);
+  vertex_descriptor top_vertex =
+    vertex_stack.empty() ? mp.get_root_vertex() : vertex_stack.top();
+
+  const metaprogram::edge_descriptor edge =
+    mp.add_edge(top_vertex, vertex, kind, point_of_instantiation);
+  vertex_stack.push(vertex);
+  ++open_count[vertex];
+
+  if (edge_added) {
+    edge_added(edge);
+  }
+}
+
+void metaprogram_builder::handle_template_end(
+  instantiation_kind /* kind */,
+  double /* timestamp */,
+  unsigned long long /* memory_usage */)
+{
+  if (vertex_stack.empty()) {
+    throw exception(
+        "Mismatched Templight TemplateBegin and TemplateEnd events");
+  }
+  --open_count[vertex_stack.top()];
+  vertex_stack.pop();
+}
+
+void metaprogram_builder::finish() const {
+  if (!vertex_stack.empty()) {
+    throw exception(
+        "Some Templight TemplateEnd events are missing");
+  }
+}
+
+bool metaprogram_builder::is_open(vertex_descriptor vertex) const {
+  return vertex < open_count.size() && open_count[vertex] > 0;
+}
+
+metaprogram_builder::vertex_descriptor metaprogram_builder::add_vertex(
+    const std::string& context)
+{
+  const string_table::id name = mp.intern_name(context);
+  if (name >= element_vertex_map.size()) {
+    element_vertex_map.resize(name + 1, no_vertex);
+  }
+
+  vertex_descriptor& vertex = element_vertex_map[name];
+  if (vertex == no_vertex) {
+    vertex = mp.add_vertex(name);
+    open_count.push_back(0);
+  }
+  return vertex;
+}
+
+}
+
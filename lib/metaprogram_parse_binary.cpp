@@ -0,0 +1,286 @@
+
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <metashell/metaprogram.hpp>
+#include <metashell/metaprogram_builder.hpp>
+#include <metashell/type.hpp>
+
+#include <metashell/exception.hpp>
+
+namespace metashell {
+
+namespace {
+
+// The layout of the trace is described at Sema::BinaryPrinter in
+// templight/patch
+const char magic[] = "TMPLBIN";
+const std::size_t header_size = 12;
+const std::size_t event_size = 40;
+const std::uint32_t no_string = 0xffffffff;
+
+enum record_type {
+  template_end_record = 0,
+  template_begin_record = 1,
+  string_record = 2,
+  finished_record = 3
+};
+
+const instantiation_kind kinds[] = {
+  instantiation_kind::template_instantiation,
+  instantiation_kind::default_template_argument_instantiation,
+  instantiation_kind::default_function_argument_instantiation,
+  instantiation_kind::explicit_template_argument_substitution,
+  instantiation_kind::deduced_template_argument_substitution,
+  instantiation_kind::prior_template_argument_substitution,
+  instantiation_kind::default_template_argument_checking,
+  instantiation_kind::exception_spec_instantiation,
+  instantiation_kind::memoization
+};
+
+[[noreturn]] void throw_parse_error(const std::string& reason) {
+  throw exception("templight binary trace parse failed (" + reason + ")");
+}
+
+std::uint64_t read_little_endian(const char* data, int bytes) {
+  std::uint64_t result = 0;
+  for (int i = bytes - 1; i >= 0; --i) {
+    result = (result << 8) | static_cast<unsigned char>(data[i]);
+  }
+  return result;
+}
+
+const std::string& string_at(
+    const std::vector<std::string>& strings,
+    std::uint32_t id)
+{
+  if (id >= strings.size()) {
+    throw_parse_error("invalid string index");
+  }
+  return strings[id];
+}
+
+// Reads the trace from memory (a mapped file or a string)
+class memory_source {
+public:
+  memory_source(const char* begin, const char* end) : p(begin), end(end) {}
+
+  // Returns nullptr when the trace is shorter than n bytes. The result is
+  // valid until the source is destroyed.
+  const char* take(std::size_t n) {
+    if (std::size_t(end - p) < n) {
+      return nullptr;
+    }
+    const char* result = p;
+    p += n;
+    return result;
+  }
+
+private:
+  const char* p;
+  const char* end;
+};
+
+// Reads the trace from a stream, possibly while it is being written
+class stream_source {
+public:
+  explicit stream_source(std::streambuf& in) : in(in) {}
+
+  // Returns nullptr when the trace is shorter than n bytes. The result is
+  // valid until the next call.
+  const char* take(std::size_t n) {
+    if (buffer.size() < n) {
+      buffer.resize(n);
+    }
+    return
+      std::size_t(in.sgetn(buffer.data(), n)) == n ? buffer.data() : nullptr;
+  }
+
+private:
+  std::streambuf& in;
+  std::vector<char> buffer;
+};
+
+template <class Source>
+const char* take(Source& source, std::size_t n) {
+  if (const char* result = source.take(n)) {
+    return result;
+  }
+  throw_parse_error("unexpected end of trace");
+}
+
+template <class Source>
+void read_binary_trace_from(Source& source, metaprogram_builder& builder) {
+  const char* header = source.take(header_size);
+  if (!header || std::memcmp(header, magic, sizeof(magic)) != 0) {
+    throw_parse_error("not a binary trace");
+  }
+  if (read_little_endian(header + 8, 4) != 2) {
+    throw_parse_error("unsupported version");
+  }
+
+  // Every string is converted once, the events refer to them by index
+  std::vector<std::string> strings;
+  std::uint64_t event_count = 0;
+
+  for (;;) {
+    const char* record = take(source, 4);
+    const std::uint64_t type = read_little_endian(record, 1);
+    const std::uint64_t kind_value = read_little_endian(record + 1, 1);
+
+    if (type == string_record) {
+      const std::uint64_t length = read_little_endian(take(source, 4), 4);
+      strings.emplace_back(take(source, length), length);
+    } else if (type == finished_record) {
+      if (read_little_endian(take(source, 4), 4) != event_count) {
+        throw_parse_error("invalid number of events");
+      }
+      return;
+    } else if (type == template_begin_record || type == template_end_record) {
+      if (kind_value >= sizeof(kinds) / sizeof(kinds[0])) {
+        throw_parse_error("invalid instantiation kind");
+      }
+      const instantiation_kind kind = kinds[kind_value];
+
+      // The offsets are relative to the end of the first 4 bytes
+      const char* event = take(source, event_size - 4);
+
+      double timestamp;
+      const std::uint64_t timestamp_bits = read_little_endian(event + 20, 8);
+      std::memcpy(&timestamp, &timestamp_bits, sizeof(timestamp));
+      const unsigned long long memory_usage =
+        read_little_endian(event + 28, 8);
+
+      if (type == template_begin_record) {
+        const std::uint32_t file_id = read_little_endian(event + 4, 4);
+        builder.handle_template_begin(
+            kind,
+            string_at(strings, read_little_endian(event, 4)),
+            file_location(
+              file_id == no_string ?
+                std::string() : string_at(strings, file_id),
+              read_little_endian(event + 8, 4),
+              read_little_endian(event + 12, 4)),
+            timestamp,
+            memory_usage);
+      } else {
+        builder.handle_template_end(kind, timestamp, memory_usage);
+      }
+      ++event_count;
+    } else {
+      throw_parse_error("invalid record");
+    }
+  }
+}
+
+metaprogram create_from_binary_trace(
+    const char* data,
+    std::size_t size,
+    bool full_mode,
+    const std::string& root_name,
+    const type& evaluation_result)
+{
+  metaprogram mp(full_mode, root_name, evaluation_result);
+  metaprogram_builder builder(mp);
+  memory_source source(data, data + size);
+  read_binary_trace_from(source, builder);
+  builder.finish();
+  return mp;
+}
+
+}
+
+void read_binary_trace(std::istream& stream, metaprogram_builder& builder) {
+  stream_source source(*stream.rdbuf());
+  read_binary_trace_from(source, builder);
+}
+
+metaprogram metaprogram::create_from_binary_stream(
+    std::istream& stream,
+    bool full_mode,
+    const std::string& root_name,
+    const type& evaluation_result)
+{
+  metaprogram mp(full_mode, root_name, evaluation_result);
+  metaprogram_builder builder(mp);
+  read_binary_trace(stream, builder);
+  builder.finish();
+  return mp;
+}
+
+metaprogram metaprogram::create_from_binary_file(
+    const std::string& file,
+    bool full_mode,
+    const std::string& root_name,
+    const type& evaluation_result)
+{
+  using boost::interprocess::file_mapping;
+  using boost::interprocess::mapped_region;
+  using boost::interprocess::read_only;
+
+  file_mapping mapping;
+  mapped_region region;
+  try {
+    mapping = file_mapping(file.c_str(), read_only);
+    region = mapped_region(mapping, read_only);
+  } catch (const boost::interprocess::interprocess_exception&) {
+    throw exception("Can't open templight file");
+  }
+
+  return create_from_binary_trace(
+      static_cast<const char*>(region.get_address()),
+      region.get_size(),
+      full_mode,
+      root_name,
+      evaluation_result);
+}
+
+metaprogram metaprogram::create_from_binary_string(
+    const std::string& string,
+    bool full_mode,
+    const std::string& root_name,
+    const type& evaluation_result)
+{
+  return create_from_binary_trace(
+      string.data(), string.size(), full_mode, root_name, evaluation_result);
+}
+
+bool metaprogram::is_binary_trace(const std::string& beginning) {
+  return
+    beginning.size() >= sizeof(magic) &&
+    std::memcmp(beginning.data(), magic, sizeof(magic)) == 0;
+}
+
+bool metaprogram::is_binary_trace_file(const std::string& file) {
+  std::ifstream in(file.c_str(), std::ios::binary);
+  char buffer[sizeof(magic)];
+  return
+    in.read(buffer, sizeof(buffer)) &&
+    is_binary_trace(std::string(buffer, sizeof(buffer)));
+}
+
+}
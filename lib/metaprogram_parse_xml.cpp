@@ -15,6 +15,7 @@
 // You should have received a copy of the GNU General Public License
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
+#include <fstream>
 #include <map>
 #include <string>
 #include <sstream>
@@ -22,106 +23,16 @@
 #include <boost/lexical_cast.hpp>
 #include <boost/algorithm/string/split.hpp>
 #include <boost/algorithm/string/classification.hpp>
-#include <boost/property_tree/xml_parser.hpp>
 
 #include <metashell/metaprogram.hpp>
+#include <metashell/metaprogram_builder.hpp>
 #include <metashell/type.hpp>
+#include <metashell/xml_pull_parser.hpp>
 
 #include <metashell/exception.hpp>
 
 namespace metashell {
 
-struct metaprogram_builder {
-
-  metaprogram_builder(
-      bool full_mode,
-      const std::string& root_name,
-      const type& evaluation_result);
-
-  void handle_template_begin(
-    instantiation_kind kind,
-    const std::string& context,
-    const file_location& location,
-    double timestamp,
-    unsigned long long memory_usage);
-
-  void handle_template_end(
-    instantiation_kind kind,
-    double timestamp,
-    unsigned long long memory_usage);
-
-  const metaprogram& get_metaprogram() const;
-
-private:
-  typedef metaprogram::vertex_descriptor vertex_descriptor;
-  typedef std::map<std::string, vertex_descriptor> element_vertex_map_t;
-
-  vertex_descriptor add_vertex(const std::string& context);
-
-  metaprogram mp;
-
-  std::stack<vertex_descriptor> vertex_stack;
-
-  element_vertex_map_t element_vertex_map;
-};
-
-metaprogram_builder::metaprogram_builder(
-    bool full_mode,
-    const std::string& root_name,
-    const type& evaluation_result) :
-  mp(full_mode, root_name, evaluation_result)
-{}
-
-void metaprogram_builder::handle_template_begin(
-  instantiation_kind kind,
-  const std::string& context,
-  const file_location& point_of_instantiation,
-  double /* timestamp */,
-  unsigned long long /* memory_usage */)
-{
-  vertex_descriptor vertex = add_vertex(context);
-  vertex_descriptor top_vertex =
-    vertex_stack.empty() ? mp.get_root_vertex() : vertex_stack.top();
-
-  mp.add_edge(top_vertex, vertex, kind, point_of_instantiation);
-  vertex_stack.push(vertex);
-}
-
-void metaprogram_builder::handle_template_end(
-  instantiation_kind /* kind */,
-  double /* timestamp */,
-  unsigned long long /* memory_usage */)
-{
-  if (vertex_stack.empty()) {
-    throw exception(
-        "Mismatched Templight TemplateBegin and TemplateEnd events");
-  }
-  vertex_stack.pop();
-}
-
-const metaprogram& metaprogram_builder::get_metaprogram() const {
-  if (!vertex_stack.empty()) {
-    throw exception(
-        "Some Templight TemplateEnd events are missing");
-  }
-  return mp;
-}
-
-metaprogram_builder::vertex_descriptor metaprogram_builder::add_vertex(
-    const std::string& context)
-{
-  element_vertex_map_t::iterator pos;
-  bool inserted;
-
-  std::tie(pos, inserted) = element_vertex_map.insert(
-      std::make_pair(context, vertex_descriptor()));
-
-  if (inserted) {
-    pos->second = mp.add_vertex(context);
-  }
-  return pos->second;
-}
-
 file_location file_location_from_string(const std::string& str) {
   std::vector<std::string> parts;
   boost::algorithm::split(parts, str, boost::algorithm::is_any_of("|"));
@@ -178,42 +89,196 @@ instantiation_kind instantiation_kind_from_string(const std::string& str) {
   }
 }
 
-metaprogram metaprogram::create_from_xml_stream(
-    std::istream& stream,
-    bool full_mode,
-    const std::string& root_name,
-    const type& evaluation_result)
+namespace {
+
+// The fields of a TemplateBegin or TemplateEnd event. The same object is
+// used for every event, thus the strings are not reallocated.
+struct templight_event {
+  enum field {
+    kind_field = 1,
+    context_field = 2,
+    point_of_instantiation_field = 4,
+    timestamp_field = 8,
+    memory_usage_field = 16
+  };
+
+  int fields_read;
+  std::string kind;
+  std::string context;
+  std::string point_of_instantiation;
+  std::string timestamp;
+  std::string memory_usage;
+};
+
+[[noreturn]] void throw_parse_error(const std::string& reason) {
+  throw exception("templight xml parse failed (" + reason + ")");
+}
+
+// Reads the text in the element whose start tag was the last token
+void read_element_text(xml_pull_parser& parser, std::string& out) {
+  out.clear();
+  int depth = 0;
+  for (;;) {
+    switch (parser.next()) {
+      case xml_pull_parser::token::text:
+        if (depth == 0) {
+          out += parser.text();
+        }
+        break;
+      case xml_pull_parser::token::start_element:
+        ++depth;
+        break;
+      case xml_pull_parser::token::end_element:
+        if (depth == 0) {
+          return;
+        }
+        --depth;
+        break;
+      case xml_pull_parser::token::end_of_document:
+        throw_parse_error("unexpected end of document");
+    }
+  }
+}
+
+void read_attribute(
+    xml_pull_parser& parser,
+    const std::string& name,
+    std::string& out)
 {
-  typedef boost::property_tree::ptree ptree;
+  const std::string* value = parser.attribute(name);
+  if (!value) {
+    throw_parse_error("missing " + parser.name() + " " + name);
+  }
+  out = *value;
+
+  std::string ignored;
+  read_element_text(parser, ignored);
+}
+
+// Reads the children of a TemplateBegin or TemplateEnd node. Unknown
+// children are ignored.
+void read_event(xml_pull_parser& parser, templight_event& event) {
+  event.fields_read = 0;
+  std::string ignored;
+  for (;;) {
+    switch (parser.next()) {
+      case xml_pull_parser::token::text:
+        break;
+      case xml_pull_parser::token::end_element:
+        return;
+      case xml_pull_parser::token::end_of_document:
+        throw_parse_error("unexpected end of document");
+      case xml_pull_parser::token::start_element:
+        if (parser.name() == "Kind") {
+          read_element_text(parser, event.kind);
+          event.fields_read |= templight_event::kind_field;
+        } else if (parser.name() == "Context") {
+          read_attribute(parser, "context", event.context);
+          event.fields_read |= templight_event::context_field;
+        } else if (parser.name() == "PointOfInstantiation") {
+          read_element_text(parser, event.point_of_instantiation);
+          event.fields_read |= templight_event::point_of_instantiation_field;
+        } else if (parser.name() == "TimeStamp") {
+          read_attribute(parser, "time", event.timestamp);
+          event.fields_read |= templight_event::timestamp_field;
+        } else if (parser.name() == "MemoryUsage") {
+          read_attribute(parser, "bytes", event.memory_usage);
+          event.fields_read |= templight_event::memory_usage_field;
+        } else {
+          read_element_text(parser, ignored);
+        }
+        break;
+    }
+  }
+}
+
+void check_fields(const templight_event& event, int required) {
+  if ((event.fields_read & required) != required) {
+    throw_parse_error("missing field of event");
+  }
+}
 
-  ptree pt;
-  read_xml(stream, pt);
+template <class T>
+T field_value(const std::string& str, const std::string& field) {
+  try {
+    return boost::lexical_cast<T>(str);
+  } catch (const boost::bad_lexical_cast&) {
+    throw_parse_error("invalid " + field);
+  }
+}
 
-  metaprogram_builder builder(full_mode, root_name, evaluation_result);
+}
 
-  for (const ptree::value_type& pt_event :
-      boost::make_iterator_range(pt.get_child("Trace")))
+void read_xml_trace(std::istream& stream, metaprogram_builder& builder) {
+  // The events are processed while they are read, thus only the resulting
+  // graph is kept in memory, not the document.
+  xml_pull_parser parser(stream);
+
+  xml_pull_parser::token token = parser.next();
+  while (token == xml_pull_parser::token::text) {
+    token = parser.next();
+  }
+  if (
+      token != xml_pull_parser::token::start_element ||
+      parser.name() != "Trace")
   {
-    if (pt_event.first == "TemplateBegin") {
+    throw_parse_error("missing Trace node");
+  }
+
+  templight_event event;
+  for (;;) {
+    token = parser.next();
+    if (token == xml_pull_parser::token::text) {
+      continue;
+    } else if (token == xml_pull_parser::token::end_element) {
+      break;
+    } else if (token == xml_pull_parser::token::end_of_document) {
+      throw_parse_error("unexpected end of document");
+    }
+
+    if (parser.name() == "TemplateBegin") {
+      read_event(parser, event);
+      check_fields(
+          event,
+          templight_event::kind_field |
+          templight_event::context_field |
+          templight_event::point_of_instantiation_field |
+          templight_event::timestamp_field |
+          templight_event::memory_usage_field);
       builder.handle_template_begin(
-          instantiation_kind_from_string(
-            pt_event.second.get<std::string>("Kind")),
-          pt_event.second.get<std::string>("Context.<xmlattr>.context"),
-          file_location_from_string(
-            pt_event.second.get<std::string>("PointOfInstantiation")),
-          pt_event.second.get<double>("TimeStamp.<xmlattr>.time"),
-          pt_event.second.get<unsigned long long>("MemoryUsage.<xmlattr>.bytes"));
-    } else if (pt_event.first == "TemplateEnd") {
+          instantiation_kind_from_string(event.kind),
+          event.context,
+          file_location_from_string(event.point_of_instantiation),
+          field_value<double>(event.timestamp, "TimeStamp"),
+          field_value<unsigned long long>(event.memory_usage, "MemoryUsage"));
+    } else if (parser.name() == "TemplateEnd") {
+      read_event(parser, event);
+      check_fields(
+          event,
+          templight_event::kind_field |
+          templight_event::timestamp_field |
+          templight_event::memory_usage_field);
       builder.handle_template_end(
-          instantiation_kind_from_string(
-            pt_event.second.get<std::string>("Kind")),
-          pt_event.second.get<double>("TimeStamp.<xmlattr>.time"),
-          pt_event.second.get<unsigned long long>("MemoryUsage.<xmlattr>.bytes"));
+          instantiation_kind_from_string(event.kind),
+          field_value<double>(event.timestamp, "TimeStamp"),
+          field_value<unsigned long long>(event.memory_usage, "MemoryUsage"));
     } else {
-      throw exception("Unknown templight xml node \"" + pt_event.first + "\"");
+      throw exception("Unknown templight xml node \"" + parser.name() + "\"");
     }
   }
-  return builder.get_metaprogram();
+}
+
+metaprogram metaprogram::create_from_xml_stream(
+    std::istream& stream,
+    bool full_mode,
+    const std::string& root_name,
+    const type& evaluation_result)
+{
+  metaprogram mp(full_mode, root_name, evaluation_result);
+  metaprogram_builder builder(mp);
+  read_xml_trace(stream, builder);
+  builder.finish();
+  return mp;
 }
 
 metaprogram metaprogram::create_from_xml_file(
@@ -16,12 +16,13 @@
 
 #include <metashell/metashell.hpp>
 #include "get_type_of_variable.hpp"
-#include "cxindex.hpp"
+#include "cxtranslationunit.hpp"
 
 #include <metashell/command.hpp>
 
 #include <boost/algorithm/string/predicate.hpp>
 
+#include <algorithm>
 #include <fstream>
 #include <memory>
 
@@ -30,24 +31,70 @@ using namespace metashell;
 namespace
 {
   const char* var = "__metashell_v";
+  const char* formatted_var = "__metashell_formatted_v";
 
-  std::pair<std::unique_ptr<cxtranslationunit>, std::string> parse_expr(
-    cxindex& index_,
+  std::string wrap_declaration(
+    const std::string& tmp_exp_,
+    const std::string& var_name_
+  )
+  {
+    return "::metashell::impl::wrap< " + tmp_exp_ + " > " + var_name_ + ";\n";
+  }
+
+  std::pair<cxtranslationunit*, std::string> parse_declarations(
+    evaluation_session& session_,
     const std::string& input_filename_,
     const environment& env_,
-    const std::string& tmp_exp_
+    const std::string& declarations_
   )
   {
     using std::make_pair;
 
-    const unsaved_file
-      code(
+    const unsaved_file code(input_filename_, env_.get_appended(declarations_));
+    return make_pair(&session_.parse_code(code, env_), code.content());
+  }
+
+  std::pair<cxtranslationunit*, std::string> parse_expr(
+    evaluation_session& session_,
+    const std::string& input_filename_,
+    const environment& env_,
+    const std::string& tmp_exp_
+  )
+  {
+    return
+      parse_declarations(
+        session_,
         input_filename_,
-        env_.get_appended(
-          "::metashell::impl::wrap< " + tmp_exp_ + " > " + var + ";\n"
-        )
+        env_,
+        wrap_declaration(tmp_exp_, var)
+      );
+  }
+
+  std::string type_of_variable(
+    cxtranslationunit& tu_,
+    const std::string& var_name_
+  )
+  {
+    get_type_of_variable v(var_name_);
+    tu_.visit_main_file_nodes(
+      [&v](cxcursor cursor_, cxcursor) { return v(cursor_); }
+    );
+    return v.result();
+  }
+
+  result to_result(
+    const std::pair<cxtranslationunit*, std::string>& tu_,
+    const std::string& var_name_,
+    const config& config_
+  )
+  {
+    return
+      result(
+        type_of_variable(*tu_.first, var_name_),
+        tu_.first->errors_begin(),
+        tu_.first->errors_end(),
+        config_.verbose ? tu_.second : ""
       );
-    return make_pair(index_.parse_code(code, env_), code.content());
   }
 
   bool has_typedef(
@@ -89,18 +136,29 @@ result metashell::validate_code(
   logger* logger_
 )
 {
-  METASHELL_LOG(logger_, "Validating code " + src_);
+  evaluation_session session(logger_);
+  return validate_code(src_, config_, env_, input_filename_, session);
+}
+
+result metashell::validate_code(
+  const std::string& src_,
+  const config& config_,
+  const environment& env_,
+  const std::string& input_filename_,
+  evaluation_session& session_
+)
+{
+  METASHELL_LOG(session_.get_logger(), "Validating code " + src_);
 
   try
   {
     const unsaved_file src(input_filename_, env_.get_appended(src_));
-    cxindex index(logger_);
-    std::unique_ptr<cxtranslationunit> tu = index.parse_code(src, env_);
+    const cxtranslationunit& tu = session_.parse_code(src, env_);
     return
       result(
         "",
-        tu->errors_begin(),
-        tu->errors_end(),
+        tu.errors_begin(),
+        tu.errors_end(),
         config_.verbose ? src.content() : ""
       );
   }
@@ -111,6 +169,62 @@ result metashell::validate_code(
   }
 }
 
+result metashell::cached_evaluation(
+  evaluation_cache& cache_,
+  const environment& env_,
+  const std::string& tmp_exp_,
+  const config& config_,
+  const std::string& input_filename_,
+  bool formatted_,
+  logger* logger_,
+  const std::function<result (bool&)>& evaluate_
+)
+{
+  // Without precompiled headers the included headers are re-read for every
+  // evaluation. Their changes would not be noticed by the cache.
+  if (!cache_.enabled() || !config_.use_precompiled_headers)
+  {
+    bool cacheable;
+    return evaluate_(cacheable);
+  }
+  else if (!env_.dependencies_known())
+  {
+    METASHELL_LOG(
+      logger_,
+      "Not caching the result of " + tmp_exp_ + ", the environment may"
+      " include headers that are not in the precompiled header"
+    );
+    bool cacheable;
+    return evaluate_(cacheable);
+  }
+  else
+  {
+    const std::string key =
+      evaluation_cache::key(
+        env_,
+        tmp_exp_,
+        input_filename_,
+        formatted_,
+        config_.verbose
+      );
+    if (const boost::optional<result> r = cache_.find(key))
+    {
+      METASHELL_LOG(logger_, "Using the cached result of " + tmp_exp_);
+      return *r;
+    }
+    else
+    {
+      bool cacheable = true;
+      const result evaluated = evaluate_(cacheable);
+      if (cacheable)
+      {
+        cache_.store(key, evaluated);
+      }
+      return evaluated;
+    }
+  }
+}
+
 result metashell::eval_tmp_formatted(
   const environment& env_,
   const std::string& tmp_exp_,
@@ -118,52 +232,168 @@ result metashell::eval_tmp_formatted(
   const std::string& input_filename_,
   logger* logger_
 )
+{
+  evaluation_session session(logger_);
+  return eval_tmp_formatted(env_, tmp_exp_, config_, input_filename_, session);
+}
+
+result metashell::eval_tmp_formatted(
+  const environment& env_,
+  const std::string& tmp_exp_,
+  const config& config_,
+  const std::string& input_filename_,
+  evaluation_session& session_
+)
 {
   using std::string;
   using std::pair;
+  using std::vector;
 
-  typedef std::unique_ptr<cxtranslationunit> tup;
+  logger* const logger = session_.get_logger();
 
   METASHELL_LOG(
-    logger_,
-    "Checking if metaprogram can be evaluated without metashell::format: "
-    + tmp_exp_
+    logger,
+    "Evaluating metaprogram with and without metashell::format in the same"
+    " translation unit: " + tmp_exp_
   );
 
-  cxindex index(logger_);
-
-  pair<tup, string> simple = parse_expr(index, input_filename_, env_, tmp_exp_);
+  const string formatted_decl =
+    wrap_declaration(
+      "::metashell::format<" + tmp_exp_ + ">::type",
+      formatted_var
+    );
+  const pair<cxtranslationunit*, string> both =
+    parse_declarations(
+      session_,
+      input_filename_,
+      env_,
+      wrap_declaration(tmp_exp_, var) + formatted_decl
+    );
 
-  METASHELL_LOG(
-    logger_,
-    simple.first->has_errors() ?
-      "Errors occured during metaprogram evaluation. Displaying errors coming"
-      " from the metaprogram without metashell::format" :
-      "No errors occured during metaprogram evaluation. Re-evaluating it with"
+  if (!both.first->has_errors())
+  {
+    METASHELL_LOG(
+      logger,
+      "No errors occured during metaprogram evaluation. Using the result of"
       " metashell::format"
-  );
+    );
+    return to_result(both, formatted_var, config_);
+  }
+  else
+  {
+    METASHELL_LOG(
+      logger,
+      "Errors occured during metaprogram evaluation. Checking if they come"
+      " from the metaprogram without metashell::format"
+    );
 
-  const pair<tup, string> final_pair =
-    simple.first->has_errors() ?
-      std::move(simple) :
-      parse_expr(
-        index,
-        input_filename_,
-        env_,
-        "::metashell::format<" + tmp_exp_ + ">::type"
+    // The declaration of var is at the same place as it would be in a
+    // translation unit without the metashell::format one, thus the line
+    // numbers of its errors are the same as well. Only the errors pointing
+    // to the metashell::format declaration alone come from it.
+    const string& src = both.second;
+    const string simple_src = src.substr(0, src.size() - formatted_decl.size());
+    const unsigned format_line =
+      std::count(simple_src.begin(), simple_src.end(), '\n') + 1;
+
+    const vector<string>
+      all_errors(both.first->errors_begin(), both.first->errors_end());
+    vector<string> simple_errors;
+    const vector<std::set<unsigned>> lines = both.first->error_lines();
+    for (vector<string>::size_type i = 0; i != all_errors.size(); ++i)
+    {
+      if (lines[i].empty() || *lines[i].begin() < format_line)
+      {
+        simple_errors.push_back(all_errors[i]);
+      }
+    }
+
+    if (!simple_errors.empty())
+    {
+      METASHELL_LOG(
+        logger,
+        "Displaying errors coming from the metaprogram without"
+        " metashell::format"
       );
+      return
+        result(
+          type_of_variable(*both.first, var),
+          simple_errors.begin(),
+          simple_errors.end(),
+          config_.verbose ? simple_src : ""
+        );
+    }
+    else
+    {
+      METASHELL_LOG(logger, "Displaying errors coming from metashell::format");
+      return to_result(both, formatted_var, config_);
+    }
+  }
+}
+
+result metashell::eval_tmp_unformatted(
+  const environment& env_,
+  const std::string& tmp_exp_,
+  const config& config_,
+  const std::string& input_filename_,
+  logger* logger_
+)
+{
+  evaluation_session session(logger_);
+  return
+    eval_tmp_unformatted(env_, tmp_exp_, config_, input_filename_, session);
+}
 
-  get_type_of_variable v(var);
-  final_pair.first->visit_nodes(
-    [&v](cxcursor cursor_, cxcursor) { v(cursor_); }
+result metashell::eval_tmp_unformatted(
+  const environment& env_,
+  const std::string& tmp_exp_,
+  const config& config_,
+  const std::string& input_filename_,
+  evaluation_session& session_
+)
+{
+  METASHELL_LOG(
+    session_.get_logger(),
+    "Evaluating template metaprogram without metashell:format: " + tmp_exp_
   );
 
   return
-    result(
-      v.result(),
-      final_pair.first->errors_begin(),
-      final_pair.first->errors_end(),
-      config_.verbose ? final_pair.second : ""
+    to_result(
+      parse_expr(session_, input_filename_, env_, tmp_exp_),
+      var,
+      config_
+    );
+}
+
+result metashell::eval_tmp_formatted(
+  const environment& env_,
+  const std::string& tmp_exp_,
+  const config& config_,
+  const std::string& input_filename_,
+  evaluation_session& session_,
+  evaluation_cache& cache_
+)
+{
+  return
+    cached_evaluation(
+      cache_,
+      env_,
+      tmp_exp_,
+      config_,
+      input_filename_,
+      true,
+      session_.get_logger(),
+      [&] (bool&)
+      {
+        return
+          eval_tmp_formatted(
+            env_,
+            tmp_exp_,
+            config_,
+            input_filename_,
+            session_
+          );
+      }
     );
 }
 
@@ -172,38 +402,148 @@ result metashell::eval_tmp_unformatted(
   const std::string& tmp_exp_,
   const config& config_,
   const std::string& input_filename_,
-  logger* logger_
+  evaluation_session& session_,
+  evaluation_cache& cache_
+)
+{
+  return
+    cached_evaluation(
+      cache_,
+      env_,
+      tmp_exp_,
+      config_,
+      input_filename_,
+      false,
+      session_.get_logger(),
+      [&] (bool&)
+      {
+        return
+          eval_tmp_unformatted(
+            env_,
+            tmp_exp_,
+            config_,
+            input_filename_,
+            session_
+          );
+      }
+    );
+}
+
+std::vector<result> metashell::eval_tmp_batch(
+  const environment& env_,
+  const std::vector<std::string>& tmp_exps_,
+  const config& config_,
+  const std::string& input_filename_,
+  evaluation_session& session_
 )
 {
   using std::string;
   using std::pair;
+  using std::vector;
 
-  typedef std::unique_ptr<cxtranslationunit> tup;
+  logger* const logger = session_.get_logger();
 
   METASHELL_LOG(
-    logger_,
-    "Evaluating template metaprogram without metashell:format: " + tmp_exp_
+    logger,
+    "Evaluating " + std::to_string(tmp_exps_.size())
+    + " metaprograms in one translation unit"
   );
 
-  cxindex index(logger_);
+  if (tmp_exps_.empty())
+  {
+    return vector<result>();
+  }
+
+  // The first line of the declaration of each variable. A declaration
+  // spans multiple lines when its metaprogram does, it ends where the next
+  // one starts.
+  vector<unsigned> first_lines;
+  string decls;
+  unsigned decl_lines = 0;
+  for (vector<string>::size_type i = 0; i != tmp_exps_.size(); ++i)
+  {
+    first_lines.push_back(decl_lines);
+    const string decl =
+      wrap_declaration(
+        "::metashell::format<" + tmp_exps_[i] + ">::type",
+        var + std::to_string(i)
+      );
+    decl_lines += std::count(decl.begin(), decl.end(), '\n');
+    decls += decl;
+  }
 
-  pair<tup, string> final_pair =
-    parse_expr(index, input_filename_, env_, tmp_exp_);
+  const pair<cxtranslationunit*, string> tu =
+    parse_declarations(session_, input_filename_, env_, decls);
+
+  const string& src = tu.second;
+  const unsigned first_decl_line =
+    std::count(src.begin(), src.end() - decls.size(), '\n') + 1;
+  const unsigned last_line = first_decl_line + decl_lines - 1;
+
+  // Errors that can not be attributed to one of the metaprograms may break
+  // any of them
+  vector<bool> failed(tmp_exps_.size());
+  bool all_failed = false;
+  for (const std::set<unsigned>& lines : tu.first->error_lines())
+  {
+    bool attributed = false;
+    for (unsigned line : lines)
+    {
+      if (line >= first_decl_line && line <= last_line)
+      {
+        const auto i =
+          std::upper_bound(
+            first_lines.begin(),
+            first_lines.end(),
+            line - first_decl_line
+          );
+        failed[i - first_lines.begin() - 1] = true;
+        attributed = true;
+      }
+    }
+    all_failed = all_failed || !attributed;
+  }
 
-  get_type_of_variable v(var);
-  final_pair.first->visit_nodes(
-    [&v](cxcursor cursor_, cxcursor) { v(cursor_); }
+  get_types_of_variables v(var, tmp_exps_.size());
+  tu.first->visit_main_file_nodes(
+    [&v](cxcursor cursor_, cxcursor) { return v(cursor_); }
   );
 
-  return
-    result(
-      v.result(),
-      final_pair.first->errors_begin(),
-      final_pair.first->errors_end(),
-      config_.verbose ? final_pair.second : ""
+  const vector<string> no_errors;
+  vector<result> results;
+  for (vector<string>::size_type i = 0; i != tmp_exps_.size(); ++i)
+  {
+    results.push_back(
+      result(
+        v.result()[i],
+        no_errors.begin(),
+        no_errors.end(),
+        config_.verbose ? src : ""
+      )
     );
-}
+  }
 
+  // The erroneous metaprograms are evaluated one by one to display their
+  // errors the same way as in the shell. The session reuses the translation
+  // unit, therefore tu can not be used after this.
+  for (vector<string>::size_type i = 0; i != tmp_exps_.size(); ++i)
+  {
+    if (all_failed || failed[i])
+    {
+      METASHELL_LOG(logger, "Evaluating " + tmp_exps_[i] + " separately");
+      results[i] =
+        eval_tmp_formatted(
+          env_,
+          tmp_exps_[i],
+          config_,
+          input_filename_,
+          session_
+        );
+    }
+  }
+
+  return results;
+}
 
 namespace
 {
@@ -260,6 +600,18 @@ void metashell::code_complete(
   std::set<std::string>& out_,
   logger* logger_
 )
+{
+  evaluation_session session(logger_);
+  code_complete(env_, src_, input_filename_, out_, session);
+}
+
+void metashell::code_complete(
+  const environment& env_,
+  const std::string& src_,
+  const std::string& input_filename_,
+  std::set<std::string>& out_,
+  evaluation_session& session_
+)
 {
   using boost::starts_with;
 
@@ -267,7 +619,7 @@ void metashell::code_complete(
   using std::string;
   using std::set;
 
-  METASHELL_LOG(logger_, "Code completion of " + src_);
+  METASHELL_LOG(session_.get_logger(), "Code completion of " + src_);
 
   const pair<string, string> completion_start = find_completion_start(src_);
 
@@ -278,7 +630,7 @@ void metashell::code_complete(
   );
 
   set<string> c;
-  cxindex(logger_).parse_code(src, env_)->code_complete(c);
+  session_.parse_code(src, env_).code_complete(c);
 
   out_.clear();
   const int prefix_len = completion_start.second.length();
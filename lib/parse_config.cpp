@@ -224,10 +224,90 @@ parse_config_result metashell::parse_config(
       "Console type. Possible values: plain, readline, json"
     )
     ("nosplash", "Disable the splash messages")
+    (
+      "cache_memory_limit",
+      value(&ucfg.cache_memory_limit)->
+      default_value(ucfg.cache_memory_limit),
+      "The maximum amount of memory (in bytes) used for caching the results"
+      " of evaluations. 0 disables the cache."
+    )
+    (
+      "cache_dir", value(&ucfg.cache_dir),
+      "The directory shared with other Metashell processes. It stores the"
+      " precompiled headers of environments, the detected Clang toolchain,"
+      " the compiled modules and (when --cache_disc_limit is set) the results"
+      " of evaluations. (Default: $XDG_CACHE_HOME/metashell)"
+    )
+    (
+      "cache_disc_limit",
+      value(&ucfg.cache_disc_limit)->default_value(ucfg.cache_disc_limit),
+      "The maximum size (in bytes) of the results of evaluations stored in"
+      " the cache directory. 0 (the default) disables storing them on disc."
+    )
+    (
+      "precompiled_header_cache_limit",
+      value(&ucfg.precompiled_header_cache_limit)->
+      default_value(ucfg.precompiled_header_cache_limit),
+      "The maximum size (in bytes) of the precompiled headers of environments"
+      " stored in the cache directory to make them available for other"
+      " Metashell processes. 0 disables storing them."
+    )
+    (
+      "no_cache",
+      "Disable caching the results of evaluations and the precompiled"
+      " headers"
+    )
     (
       "log", value(&ucfg.log_file),
       "Log into a file. When it is set to -, it logs into the console."
     )
+    (
+      "batch", value(&ucfg.batch_file),
+      "Evaluate the metaprograms in a file (one in each line) in one"
+      " translation unit and display the results in JSON format."
+    )
+    (
+      "jobs,j", value(&ucfg.jobs)->default_value(ucfg.jobs),
+      "The number of threads evaluating the metaprograms in batch mode."
+      " 0 means one thread for each CPU core."
+    )
+    (
+      "subprocess_evaluation",
+      "Evaluate the metaprograms in a child process. This makes it possible"
+      " to interrupt them using Ctrl-C."
+    )
+    (
+      "evaluation_timeout", value(&ucfg.evaluation_timeout),
+      "Interrupt the evaluation of a metaprogram after this many seconds."
+      " It enables --subprocess_evaluation."
+    )
+    (
+      "evaluation_memory_limit", value(&ucfg.evaluation_memory_limit),
+      "The maximum amount of memory (in bytes) the process evaluating the"
+      " metaprograms can use. It enables --subprocess_evaluation."
+    )
+    (
+      "watch_headers",
+      "Rebuild the precompiled header in the background when a header it"
+      " was built from changes."
+    )
+    (
+      "modules",
+      "Use Clang modules for the headers having a module map. The compiled"
+      " modules are stored in the cache directory and reused by other"
+      " environments and Metashell processes."
+    )
+    (
+      "startup_profile",
+      "Display how long the phases of the startup took."
+    )
+    (
+      "prebuild_precompiled_headers",
+      value(&ucfg.prebuild_precompiled_headers),
+      "Precompile the built-in definitions and formatters for every standard"
+      " into the precompiled_headers subdirectory of the argument and exit."
+      " It is done when Metashell is installed."
+    )
     ;
 
   try
@@ -240,11 +320,19 @@ parse_config_result metashell::parse_config(
     ucfg.syntax_highlight = !(vm.count("no_highlight") || vm.count("H"));
     ucfg.indent = vm.count("indent") != 0;
     ucfg.standard_to_use = metashell::parse_standard(cppstd);
-    ucfg.con_type = metashell::parse_console_type(con_type);
+    ucfg.con_type =
+      ucfg.batch_file.empty() ?
+        metashell::parse_console_type(con_type) :
+        console_type::json;
     ucfg.warnings_enabled = !(vm.count("no_warnings") || vm.count("w"));
     ucfg.use_precompiled_headers = !vm.count("no_precompiled_headers");
     ucfg.saving_enabled = vm.count("enable_saving");
     ucfg.splash_enabled = vm.count("nosplash") == 0;
+    ucfg.cache_enabled = vm.count("no_cache") == 0;
+    ucfg.subprocess_evaluation = vm.count("subprocess_evaluation") != 0;
+    ucfg.watch_headers = vm.count("watch_headers") != 0;
+    ucfg.use_modules = vm.count("modules") != 0;
+    ucfg.startup_profile = vm.count("startup_profile") != 0;
     if (vm.count("log") == 0)
     {
       ucfg.log_mode = logging_mode::none;
@@ -0,0 +1,262 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/persistent_evaluation_cache.hpp>
+#include <metashell/content_hash.hpp>
+#include <metashell/file_lock.hpp>
+#include <metashell/version.hpp>
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <ctime>
+#include <fstream>
+#include <limits>
+#include <utility>
+#include <vector>
+
+using namespace metashell;
+
+namespace
+{
+  // The files in the cache directory that are not entries
+  const char lock_fn[] = "lock";
+  const char size_fn[] = "size";
+
+  // Temporary files older than this are left there by crashed processes
+  const std::time_t stale_temporary_age = 60 * 60;
+
+  bool is_temporary(const boost::filesystem::path& p_)
+  {
+    return p_.extension() == ".tmp";
+  }
+
+  bool is_entry(const boost::filesystem::path& p_)
+  {
+    const boost::filesystem::path fn = p_.filename();
+    return !is_temporary(p_) && fn != lock_fn && fn != size_fn;
+  }
+
+  boost::optional<std::uintmax_t> read_size(const boost::filesystem::path& p_)
+  {
+    std::ifstream f(p_.string().c_str());
+    std::uintmax_t size;
+    if (f >> size)
+    {
+      return size;
+    }
+    else
+    {
+      return boost::none;
+    }
+  }
+
+  void write_size(const boost::filesystem::path& p_, std::uintmax_t size_)
+  {
+    std::ofstream f(p_.string().c_str());
+    f << size_;
+  }
+}
+
+persistent_evaluation_cache::persistent_evaluation_cache(
+  const std::string& directory_,
+  std::size_t size_limit_,
+  logger* logger_
+) :
+  _directory(directory_),
+  _size_limit(size_limit_),
+  _logger(logger_)
+{}
+
+boost::optional<result> persistent_evaluation_cache::find(
+  const std::string& key_
+)
+{
+  const std::string path = path_of(key_);
+  std::ifstream f(path.c_str(), std::ios::binary);
+  result r;
+  if (f && read_result(f, r))
+  {
+    METASHELL_LOG(_logger, "Found cached result in " + path);
+
+    // The modification time is used to find the least recently used entries
+    boost::system::error_code ec;
+    boost::filesystem::last_write_time(path, std::time(nullptr), ec);
+
+    return r;
+  }
+  else
+  {
+    return boost::none;
+  }
+}
+
+void persistent_evaluation_cache::store(
+  const std::string& key_,
+  const result& result_
+)
+{
+  using boost::filesystem::path;
+
+  try
+  {
+    create_directories(path(_directory));
+
+    // Other Metashell processes may be reading the same entry. Renaming a
+    // completely written file to its final name makes them see either the
+    // old or the new content but never a partially written one.
+    const path tmp =
+      path(_directory)
+        / boost::filesystem::unique_path("%%%%-%%%%-%%%%-%%%%.tmp");
+    {
+      std::ofstream f(tmp.string().c_str(), std::ios::binary);
+      write_result(f, result_);
+      if (!f)
+      {
+        METASHELL_LOG(_logger, "Failed to write " + tmp.string());
+        f.close();
+        boost::system::error_code ec;
+        remove(tmp, ec);
+        return;
+      }
+    }
+    const path p(path_of(key_));
+
+    // The total size of the entries is kept up to date in a file, thus the
+    // directory has to be scanned only when the limit is exceeded.
+    const file_lock lock(
+      (path(_directory) / lock_fn).string(),
+      file_lock::mode::exclusive
+    );
+    boost::system::error_code ec;
+    const std::uintmax_t replaced_size = file_size(p, ec);
+    const std::uintmax_t replaced = ec ? 0 : replaced_size;
+    rename(tmp, p);
+    METASHELL_LOG(_logger, "Result stored in " + p.string());
+
+    // When the total is not known, the directory is scanned
+    const boost::optional<std::uintmax_t> size =
+      read_size(path(_directory) / size_fn);
+    const std::uintmax_t stored = file_size(p, ec);
+    const std::uintmax_t total =
+      size && !ec ?
+        *size - std::min(replaced, *size) + stored :
+        std::numeric_limits<std::uintmax_t>::max();
+
+    write_size(
+      path(_directory) / size_fn,
+      total > _size_limit ? evict(p) : total
+    );
+  }
+  catch (const std::exception& e_)
+  {
+    METASHELL_LOG(
+      _logger,
+      std::string("Failed to store result in the cache: ") + e_.what()
+    );
+  }
+}
+
+const std::string& persistent_evaluation_cache::directory() const
+{
+  return _directory;
+}
+
+std::size_t persistent_evaluation_cache::size_limit() const
+{
+  return _size_limit;
+}
+
+std::string persistent_evaluation_cache::path_of(const std::string& key_) const
+{
+  // Results produced by other versions of Metashell or libclang are not
+  // reused
+  const std::string name =
+    content_hash()
+      .add(version())
+      .add(libclang_version())
+      .add(key_)
+      .digest();
+  return (boost::filesystem::path(_directory) / name).string();
+}
+
+std::uintmax_t persistent_evaluation_cache::evict(
+  const boost::filesystem::path& keep_
+)
+{
+  using boost::filesystem::directory_iterator;
+  using boost::filesystem::path;
+
+  const std::time_t now = std::time(nullptr);
+  std::vector<std::pair<std::time_t, path>> entries;
+  std::uintmax_t total = 0;
+  boost::system::error_code ec;
+  for (
+    directory_iterator i(path(_directory), ec), e;
+    !ec && i != e;
+    i.increment(ec)
+  )
+  {
+    const path p = i->path();
+    boost::system::error_code ec2;
+    const std::time_t t = last_write_time(p, ec2);
+    if (is_entry(p))
+    {
+      const std::uintmax_t size = file_size(p, ec2);
+      if (!ec2)
+      {
+        total += size;
+        // The timestamps have low resolution, the entry just stored may look
+        // as old as the others
+        if (p != keep_)
+        {
+          entries.push_back(std::make_pair(t, p));
+        }
+      }
+    }
+    else if (is_temporary(p) && !ec2 && now - t > stale_temporary_age)
+    {
+      METASHELL_LOG(_logger, "Removing stale temporary file " + p.string());
+      remove(p, ec2);
+    }
+  }
+
+  // Evicting more than needed leaves room for the next entries, thus the
+  // directory is not scanned again by every store.
+  const std::uintmax_t target = _size_limit / 4 * 3;
+  if (total > _size_limit)
+  {
+    METASHELL_LOG(_logger, "Evicting entries from " + _directory);
+
+    std::sort(entries.begin(), entries.end());
+    for (
+      auto i = entries.begin();
+      i != entries.end() && total > target;
+      ++i
+    )
+    {
+      const std::uintmax_t size = file_size(i->second, ec);
+      // Another process may have deleted it in the meantime
+      if (!ec && remove(i->second, ec))
+      {
+        total -= std::min(size, total);
+      }
+      ec.clear();
+    }
+  }
+  return total;
+}
@@ -0,0 +1,61 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/pragma_cache.hpp>
+#include <metashell/shell.hpp>
+
+#include <sstream>
+
+using namespace metashell;
+
+pragma_cache::pragma_cache(shell& shell_) :
+  pragma_without_arguments("cache"),
+  _shell(shell_)
+{}
+
+iface::pragma_handler* pragma_cache::clone() const
+{
+  return new pragma_cache(_shell);
+}
+
+std::string pragma_cache::description() const
+{
+  return "Displays the statistics of the evaluation cache.";
+}
+
+void pragma_cache::run(iface::displayer& displayer_) const
+{
+  const evaluation_cache& c = _shell.get_evaluation_cache();
+
+  std::ostringstream s;
+  if (c.enabled())
+  {
+    s
+      << "Evaluation cache: " << c.hits() << " hits (" << c.disc_hits()
+      << " from disc), " << c.misses() << " misses, " << c.size()
+      << " entries, " << c.memory_usage() << " of " << c.memory_limit()
+      << " bytes used";
+    if (const persistent_evaluation_cache* d = c.on_disc())
+    {
+      s << ", results are stored in " << d->directory();
+    }
+  }
+  else
+  {
+    s << "Evaluation cache is disabled";
+  }
+  displayer_.show_comment(text(s.str()));
+}
@@ -15,17 +15,18 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <metashell/pragma_environment.hpp>
+#include <metashell/shell.hpp>
 
 using namespace metashell;
 
-pragma_environment::pragma_environment(environment& env_) :
+pragma_environment::pragma_environment(shell& shell_) :
   pragma_without_arguments("environment"),
-  _env(env_)
+  _shell(shell_)
 {}
 
 iface::pragma_handler* pragma_environment::clone() const
 {
-  return new pragma_environment(_env);
+  return new pragma_environment(_shell);
 }
 
 std::string pragma_environment::description() const
@@ -35,6 +36,6 @@ std::string pragma_environment::description() const
 
 void pragma_environment::run(iface::displayer& displayer_) const
 {
-  displayer_.show_cpp_code(_env.get_all());
+  displayer_.show_cpp_code(_shell.env().get_all());
 }
 
@@ -31,11 +31,16 @@ iface::pragma_handler* pragma_environment_reload::clone() const
 
 std::string pragma_environment_reload::description() const
 {
-  return "Re-reads the included header files from disc.";
+  return
+    "Re-reads the included header files from disc. The precompiled header"
+    " is rebuilt only when one of them has changed.";
 }
 
-void pragma_environment_reload::run(iface::displayer&) const
+void pragma_environment_reload::run(iface::displayer& displayer_) const
 {
-  _shell.rebuild_environment();
+  if (!_shell.reload_environment())
+  {
+    displayer_.show_comment(text("None of the included headers has changed."));
+  }
 }
 
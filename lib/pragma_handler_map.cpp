@@ -32,6 +32,8 @@
 #include <metashell/pragma_environment_save.hpp>
 #include <metashell/pragma_mdb.hpp>
 #include <metashell/pragma_evaluate.hpp>
+#include <metashell/pragma_cache.hpp>
+#include <metashell/pragma_precompiled_headers_status.hpp>
 
 #include <cassert>
 #include <iostream>
@@ -166,20 +168,22 @@ pragma_handler_map pragma_handler_map::build_default(
           [&shell_] (bool v_) { shell_.using_precompiled_headers(v_); }
         )
       )
-      .add("environment", pragma_environment(shell_.env()))
+      .add(
+        "precompiled_headers",
+        "status",
+        pragma_precompiled_headers_status(shell_)
+      )
+      .add("environment", pragma_environment(shell_))
       .add("environment", "push", pragma_environment_push(shell_))
       .add("environment", "pop", pragma_environment_pop(shell_))
       .add("environment", "stack", pragma_environment_stack(shell_))
       .add("environment", "add", pragma_environment_add(shell_))
       .add("environment", "reset", pragma_environment_reset(shell_))
       .add("environment", "reload", pragma_environment_reload(shell_))
-      .add(
-        "environment",
-        "save",
-        pragma_environment_save(shell_.get_config(), shell_.env())
-      )
+      .add("environment", "save", pragma_environment_save(shell_))
       .add("mdb", pragma_mdb(shell_, cpq_, logger_))
       .add("evaluate", pragma_evaluate(shell_))
+      .add("cache", pragma_cache(shell_))
       .add("quit", pragma_quit(shell_))
     ;
 }
@@ -0,0 +1,70 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/pragma_precompiled_headers_status.hpp>
+#include <metashell/environment.hpp>
+#include <metashell/shell.hpp>
+
+#include <sstream>
+
+using namespace metashell;
+
+pragma_precompiled_headers_status::pragma_precompiled_headers_status(
+  shell& shell_
+) :
+  pragma_without_arguments("precompiled_headers status"),
+  _shell(shell_)
+{}
+
+iface::pragma_handler* pragma_precompiled_headers_status::clone() const
+{
+  return new pragma_precompiled_headers_status(_shell);
+}
+
+std::string pragma_precompiled_headers_status::description() const
+{
+  return
+    "Displays if the precompiled header is being rebuilt and how long the"
+    " last rebuild took.";
+}
+
+void pragma_precompiled_headers_status::run(iface::displayer& displayer_) const
+{
+  const environment& env = _shell.env();
+
+  std::ostringstream s;
+  if (_shell.using_precompiled_headers())
+  {
+    s
+      << "The precompiled header is "
+      << (env.rebuilding_precompiled_header() ? "" : "not ")
+      << "being rebuilt. ";
+    if (const auto t = env.last_rebuild_time())
+    {
+      s << "The last rebuild took " << t->count() << " ms.";
+    }
+    else
+    {
+      s << "It has not been rebuilt yet.";
+    }
+  }
+  else
+  {
+    s << "Precompiled headers are not used.";
+  }
+  displayer_.show_comment(text(s.str()));
+}
+
@@ -0,0 +1,97 @@
+
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/prebuilt_precompiled_headers.hpp>
+#include <metashell/config.hpp>
+#include <metashell/exception.hpp>
+#include <metashell/shell.hpp>
+
+#include <limits>
+
+using namespace metashell;
+
+namespace
+{
+  // The layers precompiled on top of the built-in definitions. Every layer
+  // is what the user would type into the shell.
+  const char* const layers[] = {"#include <metashell/formatter.hpp>"};
+
+  // The environment logs the failed precompilations and keeps working
+  // without the precompiled header. Its content is in the precompiled header
+  // when nothing is left outside of it.
+  void wait_for_precompiled_header(environment& env_, const std::string& what_)
+  {
+    env_.update(true);
+    if (!env_.get().empty())
+    {
+      throw exception("Failed to precompile " + what_);
+    }
+  }
+}
+
+void metashell::prebuild_precompiled_headers(
+  const user_config& ucfg_,
+  iface::environment_detector& env_detector_,
+  const std::string& directory_,
+  iface::displayer& displayer_,
+  std::ostream& stderr_,
+  logger* logger_
+)
+{
+  for (standard::type s : {standard::cpp11, standard::cpp14})
+  {
+    user_config ucfg = ucfg_;
+    ucfg.standard_to_use = s;
+    ucfg.use_precompiled_headers = true;
+
+    config cfg = detect_config(ucfg, env_detector_, stderr_, logger_);
+    if (!cfg.use_precompiled_headers)
+    {
+      throw exception("Precompiled headers are not supported by Clang.");
+    }
+
+    // Only the precompiled header cache of the shell is stored on disc
+    cfg.cache_dir = directory_;
+    cfg.cache_disc_limit = 0;
+    cfg.precompiled_header_cache_limit =
+      std::numeric_limits<std::size_t>::max();
+    cfg.prebuilt_precompiled_header_dir.clear();
+
+    METASHELL_LOG(
+      logger_,
+      "Precompiling the built-in definitions with " + clang_argument(s)
+    );
+
+    // The shell precompiles its built-in definitions at startup
+    shell sh(cfg, logger_);
+    wait_for_precompiled_header(
+      sh.env(),
+      "the built-in definitions with " + clang_argument(s)
+    );
+
+    for (const char* layer : layers)
+    {
+      METASHELL_LOG(logger_, std::string("Precompiling ") + layer);
+
+      if (sh.store_in_buffer(layer, displayer_))
+      {
+        wait_for_precompiled_header(sh.env(), layer);
+      }
+    }
+  }
+}
+
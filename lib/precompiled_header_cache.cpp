@@ -0,0 +1,447 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/precompiled_header_cache.hpp>
+#include <metashell/content_hash.hpp>
+#include <metashell/headers.hpp>
+#include <metashell/version.hpp>
+
+#include <boost/algorithm/string/replace.hpp>
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <ctime>
+#include <fstream>
+#include <utility>
+
+using namespace metashell;
+
+namespace
+{
+  const char lock_fn[] = "lock";
+  const char deps_ext[] = ".deps";
+
+  boost::filesystem::path header_of_version(
+    const boost::filesystem::path& entry_,
+    int version_
+  )
+  {
+    return entry_ / ("environment_" + std::to_string(version_) + ".hpp");
+  }
+
+  boost::filesystem::path pch_of(const boost::filesystem::path& header_)
+  {
+    return header_.string() + ".pch";
+  }
+
+  boost::filesystem::path deps_of(const boost::filesystem::path& header_)
+  {
+    boost::filesystem::path p = header_;
+    return p.replace_extension(deps_ext);
+  }
+
+  boost::filesystem::path header_of_deps(const boost::filesystem::path& deps_)
+  {
+    boost::filesystem::path p = deps_;
+    return p.replace_extension(".hpp");
+  }
+
+  void write_file(
+    const boost::filesystem::path& path_,
+    const std::string& content_
+  )
+  {
+    std::ofstream f(path_.string().c_str(), std::ios::binary);
+    f << content_;
+    if (!f)
+    {
+      throw
+        boost::filesystem::filesystem_error(
+          "Failed to write file",
+          path_,
+          boost::system::errc::make_error_code(boost::system::errc::io_error)
+        );
+    }
+  }
+
+  // The internal headers are written to disc only once, since their
+  // modification time is checked when the precompiled headers referring to
+  // them are loaded.
+  void write_internal_headers(const boost::filesystem::path& entry_)
+  {
+    for (const unsaved_file& h : headers(entry_.string()))
+    {
+      const boost::filesystem::path p(h.filename());
+      if (!exists(p))
+      {
+        create_directories(p.parent_path());
+        write_file(p, h.content());
+      }
+    }
+  }
+
+  std::vector<boost::filesystem::path> versions_in(
+    const boost::filesystem::path& entry_
+  )
+  {
+    std::vector<boost::filesystem::path> result;
+    boost::system::error_code ec;
+    for (
+      boost::filesystem::directory_iterator i(entry_, ec), e;
+      !ec && i != e;
+      i.increment(ec)
+    )
+    {
+      if (i->path().extension() == deps_ext)
+      {
+        result.push_back(header_of_deps(i->path()));
+      }
+    }
+    return result;
+  }
+
+  bool read_dependencies(
+    const boost::filesystem::path& header_,
+    header_dependencies& deps_
+  )
+  {
+    std::ifstream f(deps_of(header_).string().c_str(), std::ios::binary);
+    return f && read_header_dependencies(f, deps_);
+  }
+
+  void remove_version(const boost::filesystem::path& header_)
+  {
+    boost::system::error_code ec;
+    remove(deps_of(header_), ec);
+    remove(pch_of(header_), ec);
+    remove(header_, ec);
+  }
+
+  // The internal directory is different in every process
+  std::vector<std::string> normalise_args(
+    const std::vector<std::string>& clang_args_,
+    const std::string& internal_dir_
+  )
+  {
+    std::vector<std::string> result;
+    for (const std::string& arg : clang_args_)
+    {
+      result.push_back(
+        boost::algorithm::replace_all_copy(arg, internal_dir_, "<internal_dir>")
+      );
+    }
+    return result;
+  }
+
+  std::uintmax_t size_of_version(const boost::filesystem::path& header_)
+  {
+    std::uintmax_t result = 0;
+    for (
+      const boost::filesystem::path& p :
+        {header_, pch_of(header_), deps_of(header_)}
+    )
+    {
+      boost::system::error_code ec;
+      const std::uintmax_t s = file_size(p, ec);
+      if (!ec)
+      {
+        result += s;
+      }
+    }
+    return result;
+  }
+}
+
+precompiled_header_cache::precompiled_header_cache(
+  const std::string& directory_,
+  std::size_t size_limit_,
+  logger* logger_
+) :
+  _directory(directory_),
+  _size_limit(size_limit_),
+  _logger(logger_)
+{}
+
+bool precompiled_header_cache::enabled() const
+{
+  return !_directory.empty() && _size_limit > 0;
+}
+
+precompiled_header_cache::entry precompiled_header_cache::get(
+  const std::string& content_,
+  const std::vector<std::string>& clang_args_,
+  const std::string& internal_dir_,
+  const builder& build_
+)
+{
+  using boost::filesystem::path;
+  using boost::algorithm::replace_all_copy;
+
+  const std::vector<std::string>
+    args = normalise_args(clang_args_, internal_dir_);
+  const path dir = entry_directory(content_, args);
+  create_directories(dir);
+
+  entry result;
+  {
+    const file_lock
+      build_lock((dir / lock_fn).string(), file_lock::mode::exclusive);
+
+    for (const path& header : versions_in(dir))
+    {
+      header_dependencies deps;
+      if (
+        exists(pch_of(header))
+        && read_dependencies(header, deps)
+        && !deps.changed()
+      )
+      {
+        METASHELL_LOG(
+          _logger,
+          "Using cached precompiled header " + header.string()
+        );
+
+        result.lock =
+          std::make_shared<file_lock>(
+            pch_of(header).string(),
+            file_lock::mode::shared
+          );
+        result.header = header.string();
+        result.dependencies = deps;
+
+        // The modification time is used to find the least recently used
+        // entries
+        boost::system::error_code ec;
+        last_write_time(pch_of(header), std::time(nullptr), ec);
+
+        return result;
+      }
+    }
+
+    // A header without dependencies is left there by a process that was
+    // killed while building it. Its name is reused.
+    int v = 0;
+    while (
+      exists(header_of_version(dir, v))
+      && exists(deps_of(header_of_version(dir, v)))
+    )
+    {
+      ++v;
+    }
+    const path header = header_of_version(dir, v);
+    remove_version(header);
+
+    METASHELL_LOG(_logger, "Storing precompiled header in " + header.string());
+
+    std::vector<std::string> entry_args;
+    for (const std::string& arg : args)
+    {
+      entry_args.push_back(
+        replace_all_copy(arg, "<internal_dir>", dir.string())
+      );
+    }
+
+    try
+    {
+      write_internal_headers(dir);
+      write_file(header, content_);
+      result.dependencies = build_(header.string(), dir.string(), entry_args);
+
+      // Other processes consider the precompiled header complete once the
+      // dependencies are there
+      const path tmp = dir / boost::filesystem::unique_path("%%%%-%%%%.tmp");
+      {
+        std::ofstream f(tmp.string().c_str(), std::ios::binary);
+        write_header_dependencies(f, result.dependencies);
+        if (!f)
+        {
+          throw
+            boost::filesystem::filesystem_error(
+              "Failed to write file",
+              tmp,
+              boost::system::errc::make_error_code(
+                boost::system::errc::io_error
+              )
+            );
+        }
+      }
+      rename(tmp, deps_of(header));
+    }
+    catch (...)
+    {
+      remove_version(header);
+      throw;
+    }
+
+    result.lock =
+      std::make_shared<file_lock>(
+        pch_of(header).string(),
+        file_lock::mode::shared
+      );
+    result.header = header.string();
+  }
+
+  try
+  {
+    evict();
+  }
+  catch (const std::exception& e_)
+  {
+    METASHELL_LOG(
+      _logger,
+      std::string("Failed to evict precompiled headers: ") + e_.what()
+    );
+  }
+  return result;
+}
+
+boost::optional<precompiled_header_cache::entry>
+precompiled_header_cache::find(
+  const std::string& content_,
+  const std::vector<std::string>& clang_args_,
+  const std::string& internal_dir_
+) const
+{
+  if (!_directory.empty())
+  {
+    const boost::filesystem::path
+      dir =
+        entry_directory(content_, normalise_args(clang_args_, internal_dir_));
+
+    for (const boost::filesystem::path& header : versions_in(dir))
+    {
+      header_dependencies deps;
+      if (
+        exists(pch_of(header))
+        && read_dependencies(header, deps)
+        && !deps.changed()
+      )
+      {
+        METASHELL_LOG(
+          _logger,
+          "Using precompiled header " + header.string()
+        );
+
+        entry result;
+        result.header = header.string();
+        result.dependencies = deps;
+        return result;
+      }
+    }
+  }
+  return boost::none;
+}
+
+boost::filesystem::path precompiled_header_cache::entry_directory(
+  const std::string& content_,
+  const std::vector<std::string>& normalised_args_
+) const
+{
+  // Precompiled headers produced by other versions of Metashell or libclang
+  // are not reused
+  return
+    boost::filesystem::path(_directory)
+      / content_hash()
+          .add(version())
+          .add(libclang_version())
+          .add(normalised_args_)
+          .add(content_)
+          .digest();
+}
+
+const std::string& precompiled_header_cache::directory() const
+{
+  return _directory;
+}
+
+std::size_t precompiled_header_cache::size_limit() const
+{
+  return _size_limit;
+}
+
+void precompiled_header_cache::evict()
+{
+  using boost::filesystem::directory_iterator;
+  using boost::filesystem::path;
+
+  std::vector<std::pair<std::time_t, path>> versions;
+  std::uintmax_t total = 0;
+  boost::system::error_code ec;
+  for (
+    directory_iterator i(path(_directory), ec), e;
+    !ec && i != e;
+    i.increment(ec)
+  )
+  {
+    for (const path& header : versions_in(i->path()))
+    {
+      boost::system::error_code ec2;
+      const std::time_t t = last_write_time(pch_of(header), ec2);
+      total += size_of_version(header);
+      versions.push_back(std::make_pair(ec2 ? 0 : t, header));
+    }
+  }
+
+  if (total > _size_limit)
+  {
+    METASHELL_LOG(_logger, "Evicting precompiled headers from " + _directory);
+
+    std::sort(versions.begin(), versions.end());
+    for (
+      auto i = versions.begin();
+      i != versions.end() && total > _size_limit;
+      ++i
+    )
+    {
+      const path dir = i->second.parent_path();
+
+      // Entries being built or searched and precompiled headers being used
+      // are skipped
+      const std::unique_ptr<file_lock>
+        build_lock(
+          file_lock::try_lock(
+            (dir / lock_fn).string(),
+            file_lock::mode::exclusive
+          )
+        );
+      if (build_lock && exists(pch_of(i->second)))
+      {
+        const std::unique_ptr<file_lock>
+          pch_lock(
+            file_lock::try_lock(
+              pch_of(i->second).string(),
+              file_lock::mode::exclusive
+            )
+          );
+        if (pch_lock)
+        {
+          const std::uintmax_t size = size_of_version(i->second);
+          remove_version(i->second);
+          total -= std::min(size, total);
+
+          // The lock file is kept, because other processes may be waiting
+          // for it
+          if (versions_in(dir).empty())
+          {
+            boost::system::error_code ec2;
+            remove_all(dir / "metashell", ec2);
+          }
+        }
+      }
+    }
+  }
+}
+
@@ -38,7 +38,9 @@ namespace
 
   bool whitelisted(const std::string& field_)
   {
-    return field_ == "type" || field_ == "cmd" || field_ == "code";
+    return
+      field_ == "type" || field_ == "cmd" || field_ == "code"
+      || field_ == "cmds";
   }
 }
 
@@ -46,6 +48,7 @@ rapid_object_handler::rapid_object_handler(iface::displayer& displayer_) :
   _empty(true),
   _failed(false),
   _in_object(false),
+  _in_array(false),
   _displayer(displayer_)
 {}
 
@@ -105,7 +108,12 @@ bool rapid_object_handler::Double(double d_)
 bool rapid_object_handler::string(const std::string& str_)
 {
   _empty = false;
-  if (_in_object)
+  if (_in_array)
+  {
+    _array_fields[_next_key].push_back(str_);
+    return true;
+  }
+  else if (_in_object)
   {
     _fields.insert({_next_key, str_});
     return true;
@@ -156,15 +164,32 @@ bool rapid_object_handler::end_object()
 bool rapid_object_handler::StartArray()
 {
   _empty = false;
-  fail("Unexpected array");
-  return false;
+  if (_in_object && !_in_array)
+  {
+    _in_array = true;
+    _array_fields[_next_key];
+    return true;
+  }
+  else
+  {
+    fail("Unexpected array");
+    return false;
+  }
 }
 
 bool rapid_object_handler::end_array()
 {
   _empty = false;
-  fail("Unexpected array");
-  return false;
+  if (_in_array)
+  {
+    _in_array = false;
+    return true;
+  }
+  else
+  {
+    fail("Unexpected array");
+    return false;
+  }
 }
 
 bool rapid_object_handler::failed() const
@@ -187,6 +212,21 @@ boost::optional<std::string> rapid_object_handler::field(
   }
 }
 
+boost::optional<std::vector<std::string>> rapid_object_handler::array_field(
+  const std::string& name_
+) const
+{
+  const auto i = _array_fields.find(name_);
+  if (i == _array_fields.end())
+  {
+    return boost::none;
+  }
+  else
+  {
+    return i->second;
+  }
+}
+
 bool rapid_object_handler::empty() const
 {
   return _empty;
@@ -15,9 +15,18 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <metashell/result.hpp>
+#include <metashell/serialisation.hpp>
+
+#include <istream>
+#include <ostream>
 
 using namespace metashell;
 
+namespace
+{
+  const char format_id[] = "metashell evaluation result 1";
+}
+
 result::result() {}
 
 bool result::has_errors() const
@@ -25,3 +34,42 @@ bool result::has_errors() const
   return !errors.empty();
 }
 
+bool metashell::read_result(std::istream& in_, result& result_)
+{
+  std::string id;
+  std::size_t error_count;
+  if (
+    std::getline(in_, id) && id == format_id
+    && read_string(in_, result_.output)
+    && read_string(in_, result_.info)
+    && in_ >> error_count
+    && in_.get() == '\n'
+  )
+  {
+    result_.errors.resize(error_count);
+    for (std::string& e : result_.errors)
+    {
+      if (!read_string(in_, e))
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+  else
+  {
+    return false;
+  }
+}
+
+void metashell::write_result(std::ostream& out_, const result& result_)
+{
+  out_ << format_id << '\n';
+  write_string(out_, result_.output);
+  write_string(out_, result_.info);
+  out_ << result_.errors.size() << '\n';
+  for (const std::string& e : result_.errors)
+  {
+    write_string(out_, e);
+  }
+}
@@ -0,0 +1,40 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/serialisation.hpp>
+
+#include <istream>
+#include <ostream>
+
+void metashell::write_string(std::ostream& out_, const std::string& s_)
+{
+  out_ << s_.size() << '\n' << s_;
+}
+
+bool metashell::read_string(std::istream& in_, std::string& s_)
+{
+  std::size_t len;
+  if (in_ >> len && in_.get() == '\n')
+  {
+    s_.resize(len);
+    return len == 0 || in_.read(&s_[0], len);
+  }
+  else
+  {
+    return false;
+  }
+}
+
@@ -26,16 +26,60 @@
 #include <metashell/to_string.hpp>
 #include <metashell/exception.hpp>
 #include <metashell/null_history.hpp>
+#include <metashell/environment_snapshot.hpp>
 
 #include <cctype>
 #include <algorithm>
 #include <iostream>
+#include <memory>
 #include <sstream>
 
 using namespace metashell;
 
 namespace
 {
+  // What the evaluating process needs to evaluate in the environment
+  std::string evaluation_context(const environment& env_, bool verbose_)
+  {
+    std::ostringstream s;
+    s << verbose_ << '\n';
+    write_environment(s, environment_snapshot(env_));
+    return s.str();
+  }
+
+  // Called in the evaluating process. It does not log, since the file
+  // descriptor of the log file is closed in that process.
+  subprocess_evaluator::evaluator evaluator_in_context(
+    const std::string& context_,
+    config config_
+  )
+  {
+    std::istringstream s(context_);
+    const auto env = std::make_shared<environment_snapshot>();
+    if (
+      !(s >> config_.verbose) || s.get() != '\n' || !read_environment(s, *env)
+    )
+    {
+      throw exception("Invalid environment received by the evaluating process");
+    }
+
+    // The evaluating process keeps its libclang index and translation unit
+    // when the environment changes
+    static evaluation_session session;
+    return
+      [config_, env] (const std::string& tmp_exp_)
+      {
+        return
+          eval_tmp_formatted(
+            *env,
+            tmp_exp_,
+            config_,
+            shell::input_filename(),
+            session
+          );
+      };
+  }
+
   std::string max_template_depth_info(int depth_)
   {
     std::ostringstream s;
@@ -88,6 +132,29 @@ namespace
       ) == cmd_.end();
   }
 
+  // Lines that can be evaluated together with the other metaprograms
+  // around them, since they do not change the environment
+  bool is_metaprogram(const std::string& s_)
+  {
+    if (s_.empty() || s_.back() == '\\' || !has_non_whitespace(s_))
+    {
+      return false;
+    }
+    else
+    {
+      const command cmd(s_);
+      return
+        !is_empty_line(cmd)
+        && !parse_pragma(cmd)
+        && !is_environment_setup_command(cmd);
+    }
+  }
+
+  std::string results_dir(const config& config_)
+  {
+    return config_.cache_dir.empty() ? "" : config_.cache_dir + "/results";
+  }
+
   const char default_env[] =
     "#define __METASHELL\n"
     "#define __METASHELL_MAJOR " TO_STRING(METASHELL_MAJOR) "\n"
@@ -138,8 +205,16 @@ shell::shell(const config& config_, logger* logger_) :
   _env(),
   _config(config_),
   _stopped(false),
-  _logger(logger_)
+  _logger(logger_),
+  _session(logger_),
+  _cache(
+    config_.cache_memory_limit,
+    results_dir(config_),
+    config_.cache_disc_limit,
+    logger_
+  )
 {
+  start_subprocess_evaluator();
   rebuild_environment();
   init(nullptr);
 }
@@ -152,8 +227,16 @@ shell::shell(
   _env(),
   _config(config_),
   _stopped(false),
-  _logger(logger_)
+  _logger(logger_),
+  _session(logger_),
+  _cache(
+    config_.cache_memory_limit,
+    results_dir(config_),
+    config_.cache_disc_limit,
+    logger_
+  )
 {
+  start_subprocess_evaluator();
   rebuild_environment();
   init(&cpq_);
 }
@@ -167,12 +250,26 @@ shell::shell(
   _env(std::move(env_)),
   _config(config_),
   _stopped(false),
-  _logger(logger_)
+  _logger(logger_),
+  _session(logger_),
+  _cache(
+    config_.cache_memory_limit,
+    results_dir(config_),
+    config_.cache_disc_limit,
+    logger_
+  )
 {
+  start_subprocess_evaluator();
   init(&cpq_);
 }
 
-void shell::cancel_operation() {}
+void shell::cancel_operation()
+{
+  if (_subprocess)
+  {
+    _subprocess->cancel();
+  }
+}
 
 void shell::display_splash(iface::displayer& displayer_)
 {
@@ -255,6 +352,8 @@ void shell::line_available(
   iface::history& history_
 )
 {
+  update_environment(displayer_, false);
+
   try
   {
     if (s_.empty() || s_.back() != '\\')
@@ -304,6 +403,59 @@ void shell::line_available(
   }
 }
 
+void shell::lines_available(
+  const std::vector<std::string>& s_,
+  iface::displayer& displayer_,
+  iface::history& history_
+)
+{
+  // The evaluation pool evaluates the metaprograms in the Metashell
+  // process, thus they are evaluated one by one in the child process when
+  // it is used
+  if (_subprocess)
+  {
+    iface::command_processor::lines_available(s_, displayer_, history_);
+    return;
+  }
+
+  std::vector<std::string> metaprograms;
+  const auto run_collected =
+    [this, &metaprograms, &displayer_]
+    {
+      if (!metaprograms.empty())
+      {
+        try
+        {
+          run_metaprograms(metaprograms, displayer_);
+        }
+        catch (const std::exception& e)
+        {
+          displayer_.show_error(std::string("Error: ") + e.what());
+        }
+        metaprograms.clear();
+      }
+    };
+
+  for (const std::string& s : s_)
+  {
+    if (_line_prefix.empty() && is_metaprogram(s))
+    {
+      if (_prev_line != s)
+      {
+        history_.add(s);
+        _prev_line = s;
+      }
+      metaprograms.push_back(s);
+    }
+    else
+    {
+      run_collected();
+      line_available(s, displayer_, history_);
+    }
+  }
+  run_collected();
+}
+
 std::string shell::prompt() const
 {
   return _line_prefix.empty() ? ">" : "...>";
@@ -311,7 +463,8 @@ std::string shell::prompt() const
 
 bool shell::store_in_buffer(const std::string& s_, iface::displayer& displayer_)
 {
-  const result r = validate_code(s_, _config, *_env, input_filename(), _logger);
+  const result r =
+    validate_code(s_, _config, *_env, input_filename(), _session);
   const bool success = !r.has_errors();
   if (success)
   {
@@ -341,7 +494,7 @@ void shell::code_complete(
 {
   try
   {
-    metashell::code_complete(*_env, s_, input_filename(), out_, _logger);
+    metashell::code_complete(*_env, s_, input_filename(), out_, _session);
   }
   catch (...)
   {
@@ -351,12 +504,33 @@ void shell::code_complete(
 
 void shell::init(command_processor_queue* cpq_)
 {
-  _env->append(default_env);
+  add_default_environment();
 
   // TODO: move it to initialisation later
   _pragma_handlers = pragma_handler_map::build_default(*this, cpq_, _logger);
 }
 
+void shell::start_subprocess_evaluator()
+{
+  // The evaluator forks its launcher process, therefore it is started before
+  // the environment starts threads or takes file locks.
+  if (_config.subprocess_evaluation)
+  {
+    const config cfg = _config;
+    _subprocess.reset(
+      new subprocess_evaluator(
+        [cfg] (const std::string& context_)
+        {
+          return evaluator_in_context(context_, cfg);
+        },
+        _config.evaluation_timeout,
+        _config.evaluation_memory_limit,
+        _logger
+      )
+    );
+  }
+}
+
 const pragma_handler_map& shell::pragma_handlers() const
 {
   return _pragma_handlers;
@@ -415,11 +589,58 @@ void shell::rebuild_environment(const std::string& content_)
 void shell::rebuild_environment()
 {
   rebuild_environment(_env ? _env->get_all() : std::string());
+
+  // The pushed environments were built using the old configuration or
+  // the old content of the included headers.
+  for (auto& e : _environment_stack)
+  {
+    e.second.reset();
+  }
+}
+
+bool shell::reload_environment()
+{
+  if (_config.use_precompiled_headers)
+  {
+    if (_env->reload())
+    {
+      // The precompiled headers of the pushed environments were built
+      // from the old content of the headers as well
+      for (auto& e : _environment_stack)
+      {
+        e.second.reset();
+      }
+      return true;
+    }
+    else
+    {
+      return false;
+    }
+  }
+  else
+  {
+    rebuild_environment();
+    return true;
+  }
 }
 
 void shell::push_environment()
 {
-  _environment_stack.push(_env->get_all());
+  const std::string content = _env->get_all();
+  if (std::unique_ptr<environment> successor =
+    _env->create_successor(_config, _logger))
+  {
+    // The pushed environment object is kept unchanged and its precompiled
+    // header is shared with the new one, thus pop needs no compilation.
+    _environment_stack.push_back(std::make_pair(content, std::move(_env)));
+    _env = std::move(successor);
+  }
+  else
+  {
+    _environment_stack.push_back(
+      std::make_pair(content, std::unique_ptr<environment>())
+    );
+  }
 }
 
 void shell::pop_environment()
@@ -430,8 +651,15 @@ void shell::pop_environment()
   }
   else
   {
-    rebuild_environment(_environment_stack.top());
-    _environment_stack.pop();
+    if (_environment_stack.back().second)
+    {
+      _env = std::move(_environment_stack.back().second);
+    }
+    else
+    {
+      rebuild_environment(_environment_stack.back().first);
+    }
+    _environment_stack.pop_back();
   }
 }
 
@@ -455,25 +683,109 @@ void shell::display_environment_stack_size(iface::displayer& displayer_)
 
 void shell::run_metaprogram(const std::string& s_, iface::displayer& displayer_)
 {
-  display(
-    eval_tmp_formatted(*_env, s_, _config, input_filename(), _logger),
-    displayer_
-  );
+  if (_subprocess)
+  {
+    const std::string env_key =
+      evaluation_cache::key(*_env, "", input_filename(), true, _config.verbose);
+    const std::function<std::string ()> context =
+      [this] { return evaluation_context(*_env, _config.verbose); };
+
+    display(
+      cached_evaluation(
+        _cache,
+        *_env,
+        s_,
+        _config,
+        input_filename(),
+        true,
+        _logger,
+        [this, &s_, &env_key, &context] (bool& cacheable_)
+        {
+          const result r = _subprocess->evaluate(s_, env_key, context);
+          cacheable_ = _subprocess->evaluated();
+          return r;
+        }
+      ),
+      displayer_
+    );
+  }
+  else
+  {
+    display(
+      eval_tmp_formatted(
+        *_env,
+        s_,
+        _config,
+        input_filename(),
+        _session,
+        _cache
+      ),
+      displayer_
+    );
+  }
+}
+
+void shell::run_metaprograms(
+  const std::vector<std::string>& s_,
+  iface::displayer& displayer_
+)
+{
+  update_environment(displayer_, true);
+
+  if (!_pool)
+  {
+    _pool.reset(new evaluation_pool(_config.jobs, _logger));
+  }
+
+  const std::vector<result> results =
+    _pool->eval_tmp_batch(*_env, s_, _config, input_filename());
+
+  for (std::vector<std::string>::size_type i = 0; i != s_.size(); ++i)
+  {
+    displayer_.show_cpp_code(s_[i]);
+    display(results[i], displayer_);
+  }
 }
 
 void shell::reset_environment()
 {
   rebuild_environment("");
+  add_default_environment();
+}
+
+void shell::add_default_environment()
+{
   _env->append(default_env);
+
+  // The prompt is displayed while the built-in definitions are being
+  // precompiled. Until that finishes, the evaluations parse them.
+  _env->precompile_in_background();
 }
 
 const config& shell::get_config() const {
   return _config;
 }
 
+const evaluation_cache& shell::get_evaluation_cache() const
+{
+  return _cache;
+}
+
 void shell::line_available(const std::string& s_, iface::displayer& displayer_)
 {
   null_history h;
   line_available(s_, displayer_, h);
 }
 
+void shell::update_environment(iface::displayer& displayer_, bool wait_)
+{
+  try
+  {
+    _env->update(wait_);
+  }
+  catch (const std::exception& e)
+  {
+    displayer_.show_error(std::string("Error: ") + e.what());
+  }
+}
+
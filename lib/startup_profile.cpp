@@ -0,0 +1,69 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/startup_profile.hpp>
+
+#include <iomanip>
+#include <ostream>
+
+using namespace metashell;
+
+namespace
+{
+  void display_time(
+    std::ostream& out_,
+    const std::string& name_,
+    std::chrono::microseconds t_
+  )
+  {
+    out_
+      << "  " << name_ << ": " << std::fixed << std::setprecision(1)
+      << t_.count() / 1000.0 << " ms" << std::endl;
+  }
+}
+
+startup_profile::startup_profile() :
+  _start(std::chrono::steady_clock::now()),
+  _last(_start),
+  _phases()
+{}
+
+void startup_profile::phase_finished(const std::string& name_)
+{
+  const auto now = std::chrono::steady_clock::now();
+  _phases.push_back(
+    std::make_pair(
+      name_,
+      std::chrono::duration_cast<std::chrono::microseconds>(now - _last)
+    )
+  );
+  _last = now;
+}
+
+void startup_profile::display(std::ostream& out_) const
+{
+  out_ << "Startup profile:" << std::endl;
+  for (const auto& p : _phases)
+  {
+    display_time(out_, p.first, p.second);
+  }
+  display_time(
+    out_,
+    "Total",
+    std::chrono::duration_cast<std::chrono::microseconds>(_last - _start)
+  );
+}
+
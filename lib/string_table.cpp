@@ -0,0 +1,176 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/string_table.hpp>
+#include <metashell/exception.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+namespace metashell {
+
+namespace {
+
+const std::size_t block_size = 64 * 1024;
+
+// Longer strings get a block of their own, thus they don't waste the rest
+// of the current block
+const std::size_t max_shared_size = block_size / 4;
+
+const std::size_t min_slot_count = 16;
+
+}
+
+string_table::string_table() : slots(min_slot_count, 0) {}
+
+string_table::string_table(string_table&& other) : string_table() {
+  *this = std::move(other);
+}
+
+string_table& string_table::operator=(string_table&& other) {
+  if (this != &other) {
+    blocks = std::move(other.blocks);
+    block_free = other.block_free;
+    block_left = other.block_left;
+    entries = std::move(other.entries);
+    slots = std::move(other.slots);
+
+    other.blocks.clear();
+    other.block_free = nullptr;
+    other.block_left = 0;
+    other.entries.clear();
+    other.slots.assign(min_slot_count, 0);
+  }
+  return *this;
+}
+
+string_table::string_table(const string_table& other) : string_table() {
+  *this = other;
+}
+
+string_table& string_table::operator=(const string_table& other) {
+  if (this != &other) {
+    string_table copy;
+    copy.entries.reserve(other.entries.size());
+    copy.rehash(other.slots.size());
+    for (const entry& e : other.entries) {
+      copy.intern(boost::string_ref(e.data, e.size));
+    }
+    *this = std::move(copy);
+  }
+  return *this;
+}
+
+string_table::id string_table::intern(boost::string_ref s) {
+  const std::uint32_t h = hash(s);
+
+  const std::size_t mask = slots.size() - 1;
+  std::size_t slot = h & mask;
+  for (; slots[slot] != 0; slot = (slot + 1) & mask) {
+    const entry& e = entries[slots[slot] - 1];
+    if (
+      e.hash == h && e.size == s.size()
+      && std::equal(s.begin(), s.end(), e.data)
+    )
+    {
+      return slots[slot] - 1;
+    }
+  }
+
+  if (
+    s.size() > std::numeric_limits<std::uint32_t>::max()
+    || entries.size() >= std::numeric_limits<id>::max() - 1
+  )
+  {
+    throw exception("Too many or too long strings in the string table");
+  }
+
+  const id result = entries.size();
+  entries.push_back(entry{store(s), std::uint32_t(s.size()), h});
+  slots[slot] = result + 1;
+
+  // The load factor is kept at most 1/2 to keep the probe sequences short
+  if (entries.size() * 2 > slots.size()) {
+    rehash(slots.size() * 2);
+  }
+
+  return result;
+}
+
+boost::string_ref string_table::get(id id_) const {
+  assert(id_ < entries.size());
+
+  const entry& e = entries[id_];
+  return boost::string_ref(e.data, e.size);
+}
+
+std::size_t string_table::size() const {
+  return entries.size();
+}
+
+std::uint32_t string_table::hash(boost::string_ref s) {
+  // FNV-1a
+  std::uint32_t h = 2166136261u;
+  for (char c : s) {
+    h = (h ^ static_cast<unsigned char>(c)) * 16777619u;
+  }
+  return h;
+}
+
+const char* string_table::store(boost::string_ref s) {
+  if (s.empty()) {
+    return nullptr;
+  }
+
+  if (s.size() > max_shared_size) {
+    blocks.emplace_back(new char[s.size()]);
+    std::memcpy(blocks.back().get(), s.data(), s.size());
+    return blocks.back().get();
+  }
+
+  if (block_left < s.size()) {
+    blocks.emplace_back(new char[block_size]);
+    block_free = blocks.back().get();
+    block_left = block_size;
+  }
+
+  char* result = block_free;
+  std::memcpy(result, s.data(), s.size());
+  block_free += s.size();
+  block_left -= s.size();
+  return result;
+}
+
+void string_table::rehash(std::size_t slot_count) {
+  assert((slot_count & (slot_count - 1)) == 0);
+
+  slots.assign(std::max(slot_count, min_slot_count), 0);
+
+  const std::size_t mask = slots.size() - 1;
+  for (id i = 0; i != entries.size(); ++i) {
+    std::size_t slot = entries[i].hash & mask;
+    while (slots[slot] != 0) {
+      slot = (slot + 1) & mask;
+    }
+    slots[slot] = i + 1;
+  }
+}
+
+}
+
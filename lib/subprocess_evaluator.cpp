@@ -0,0 +1,728 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/subprocess_evaluator.hpp>
+#include <metashell/exception.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <new>
+#include <sstream>
+#include <vector>
+
+#ifndef _WIN32
+#  include <cerrno>
+#  include <cstdlib>
+#  include <cstring>
+#  include <dirent.h>
+#  include <fcntl.h>
+#  include <poll.h>
+#  include <signal.h>
+#  include <sys/resource.h>
+#  include <sys/socket.h>
+#  include <sys/wait.h>
+#  include <unistd.h>
+#endif
+
+using namespace metashell;
+
+namespace
+{
+  result error_result(const std::string& error_)
+  {
+    const std::string errors[] = { error_ };
+    return
+      result(
+        "",
+        errors,
+        errors + sizeof(errors) / sizeof(errors[0]),
+        ""
+      );
+  }
+
+#ifndef _WIN32
+  // Writing into the socket of a killed process should not terminate the
+  // writer with SIGPIPE
+#  ifdef MSG_NOSIGNAL
+  const int send_flags = MSG_NOSIGNAL;
+#  else
+  const int send_flags = 0;
+#  endif
+
+  void no_sigpipe(int fd_)
+  {
+#  ifdef SO_NOSIGPIPE
+    int one = 1;
+    setsockopt(fd_, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#  else
+    static_cast<void>(fd_);
+#  endif
+  }
+
+  bool create_socket_pair(int (&fds_)[2])
+  {
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds_) == 0)
+    {
+      no_sigpipe(fds_[0]);
+      no_sigpipe(fds_[1]);
+      return true;
+    }
+    else
+    {
+      return false;
+    }
+  }
+
+  bool write_all(int fd_, const char* buff_, std::size_t len_)
+  {
+    while (len_ > 0)
+    {
+      const ssize_t written = ::send(fd_, buff_, len_, send_flags);
+      if (written < 0)
+      {
+        if (errno != EINTR)
+        {
+          return false;
+        }
+      }
+      else
+      {
+        buff_ += written;
+        len_ -= written;
+      }
+    }
+    return true;
+  }
+
+  bool read_all(int fd_, char* buff_, std::size_t len_)
+  {
+    while (len_ > 0)
+    {
+      const ssize_t read = ::read(fd_, buff_, len_);
+      if (read == 0 || (read < 0 && errno != EINTR))
+      {
+        return false;
+      }
+      else if (read > 0)
+      {
+        buff_ += read;
+        len_ -= read;
+      }
+    }
+    return true;
+  }
+
+  bool write_message(int fd_, const std::string& msg_)
+  {
+    const std::uint64_t len = msg_.size();
+    return
+      write_all(fd_, reinterpret_cast<const char*>(&len), sizeof(len))
+      && write_all(fd_, msg_.data(), msg_.size());
+  }
+
+  bool read_message(int fd_, std::string& msg_)
+  {
+    std::uint64_t len;
+    if (read_all(fd_, reinterpret_cast<char*>(&len), sizeof(len)))
+    {
+      msg_.resize(len);
+      return len == 0 || read_all(fd_, &msg_[0], len);
+    }
+    else
+    {
+      return false;
+    }
+  }
+
+  // Passes an open file descriptor to the process at the other end of a
+  // Unix domain socket
+  bool send_fd(int socket_, int fd_)
+  {
+    char data = 0;
+    iovec iov;
+    iov.iov_base = &data;
+    iov.iov_len = 1;
+
+    char control[CMSG_SPACE(sizeof(int))];
+    std::memset(control, 0, sizeof(control));
+
+    msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    cmsghdr* c = CMSG_FIRSTHDR(&msg);
+    c->cmsg_level = SOL_SOCKET;
+    c->cmsg_type = SCM_RIGHTS;
+    c->cmsg_len = CMSG_LEN(sizeof(int));
+    std::memcpy(CMSG_DATA(c), &fd_, sizeof(int));
+
+    ssize_t sent;
+    do
+    {
+      sent = sendmsg(socket_, &msg, send_flags);
+    }
+    while (sent < 0 && errno == EINTR);
+    return sent == 1;
+  }
+
+  // Returns -1 on error
+  int receive_fd(int socket_)
+  {
+    char data;
+    iovec iov;
+    iov.iov_base = &data;
+    iov.iov_len = 1;
+
+    char control[CMSG_SPACE(sizeof(int))];
+
+    msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+#  ifdef MSG_CMSG_CLOEXEC
+    const int flags = MSG_CMSG_CLOEXEC;
+#  else
+    const int flags = 0;
+#  endif
+
+    ssize_t received;
+    do
+    {
+      received = recvmsg(socket_, &msg, flags);
+    }
+    while (received < 0 && errno == EINTR);
+
+    if (received == 1)
+    {
+      for (cmsghdr* c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c))
+      {
+        if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_RIGHTS)
+        {
+          int fd;
+          std::memcpy(&fd, CMSG_DATA(c), sizeof(int));
+          return fd;
+        }
+      }
+    }
+    return -1;
+  }
+
+  void close_on_exec(int fd_)
+  {
+    fcntl(fd_, F_SETFD, fcntl(fd_, F_GETFD) | FD_CLOEXEC);
+  }
+
+  // The file descriptors inherited from Metashell (eg. the ones holding
+  // file locks on the cached precompiled headers) would keep the locks
+  // alive while the launcher and the evaluating processes are running.
+  void close_inherited_fds(int keep_)
+  {
+#  ifdef __linux__
+    const char fd_dir[] = "/proc/self/fd";
+#  else
+    const char fd_dir[] = "/dev/fd";
+#  endif
+
+    if (DIR* d = opendir(fd_dir))
+    {
+      std::vector<int> fds;
+      while (const dirent* e = readdir(d))
+      {
+        if (e->d_name[0] != '.')
+        {
+          fds.push_back(std::atoi(e->d_name));
+        }
+      }
+      const int dir_fd = dirfd(d);
+      closedir(d);
+
+      for (int fd : fds)
+      {
+        if (fd > 2 && fd != keep_ && fd != dir_fd)
+        {
+          close(fd);
+        }
+      }
+    }
+    else
+    {
+      const long max_fd = sysconf(_SC_OPEN_MAX);
+      for (int fd = 3; fd < max_fd; ++fd)
+      {
+        if (fd != keep_)
+        {
+          close(fd);
+        }
+      }
+    }
+  }
+
+  std::string describe(int status_)
+  {
+    std::ostringstream s;
+    if (WIFSIGNALED(status_))
+    {
+      s << "was terminated by signal " << WTERMSIG(status_);
+    }
+    else if (WIFEXITED(status_))
+    {
+      s << "exited with code " << WEXITSTATUS(status_);
+    }
+    else
+    {
+      s << "stopped";
+    }
+    return s.str();
+  }
+
+  pid_t wait_for(pid_t pid_, int& status_)
+  {
+    pid_t waited;
+    do
+    {
+      waited = waitpid(pid_, &status_, 0);
+    }
+    while (waited < 0 && errno == EINTR);
+    return waited;
+  }
+#endif
+}
+
+subprocess_evaluator::subprocess_evaluator(
+  const evaluator_factory& factory_,
+  unsigned timeout_,
+  std::size_t memory_limit_,
+  logger* logger_
+) :
+  _factory(factory_),
+  _timeout(timeout_),
+  _memory_limit(memory_limit_),
+  _logger(logger_),
+  _evaluated(false)
+#ifndef _WIN32
+  ,
+  _launcher(-1),
+  _control(-1),
+  _pid(-1),
+  _channel(-1),
+  _running(0),
+  _cancelled(0)
+#endif
+{
+#ifndef _WIN32
+  int control[2];
+  if (!create_socket_pair(control))
+  {
+    METASHELL_LOG(_logger, "Failed to create socket for the launcher process");
+    return;
+  }
+
+  const pid_t pid = fork();
+  if (pid < 0)
+  {
+    close(control[0]);
+    close(control[1]);
+    METASHELL_LOG(_logger, "Failed to start the launcher process");
+  }
+  else if (pid == 0)
+  {
+    close(control[0]);
+    launch(control[1]);
+    _exit(0);
+  }
+  else
+  {
+    close(control[1]);
+    // The processes started by Metashell (eg. Clang) should not keep it
+    // open
+    close_on_exec(control[0]);
+
+    _launcher = pid;
+    _control = control[0];
+
+    std::ostringstream s;
+    s << "Launcher of the evaluating processes started: " << _launcher;
+    METASHELL_LOG(_logger, s.str());
+  }
+#endif
+}
+
+bool subprocess_evaluator::evaluated() const
+{
+  return _evaluated;
+}
+
+subprocess_evaluator::~subprocess_evaluator()
+{
+#ifndef _WIN32
+  if (_pid > 0)
+  {
+    stop();
+  }
+  if (_launcher > 0)
+  {
+    // The launcher exits when the control socket is closed
+    close(_control);
+    int status;
+    wait_for(_launcher, status);
+  }
+#endif
+}
+
+#ifdef _WIN32
+
+result subprocess_evaluator::evaluate(
+  const std::string& tmp_exp_,
+  const std::string&,
+  const std::function<std::string ()>& environment_
+)
+{
+  _evaluated = false;
+  try
+  {
+    const result r = _factory(environment_())(tmp_exp_);
+    _evaluated = true;
+    return r;
+  }
+  catch (const std::exception& e_)
+  {
+    return error_result(e_.what());
+  }
+}
+
+void subprocess_evaluator::cancel() {}
+
+#else
+
+result subprocess_evaluator::evaluate(
+  const std::string& tmp_exp_,
+  const std::string& environment_key_,
+  const std::function<std::string ()>& environment_
+)
+{
+  using std::chrono::steady_clock;
+  using std::chrono::milliseconds;
+  using std::chrono::duration_cast;
+
+  _evaluated = false;
+
+  if (_pid > 0 && environment_key_ != _environment_key)
+  {
+    METASHELL_LOG(_logger, "The environment has changed.");
+    if (write_message(_channel, 'n' + environment_()))
+    {
+      _environment_key = environment_key_;
+    }
+    else
+    {
+      stop();
+    }
+  }
+  if (_pid <= 0)
+  {
+    if (!start(environment_()))
+    {
+      return error_result("Failed to start the evaluating process");
+    }
+    _environment_key = environment_key_;
+  }
+
+  METASHELL_LOG(_logger, "Evaluating " + tmp_exp_ + " in a child process");
+
+  const steady_clock::time_point
+    deadline = steady_clock::now() + std::chrono::seconds(_timeout);
+
+  _cancelled = 0;
+  _running = 1;
+
+  bool timed_out = false;
+  bool ok = write_message(_channel, 'x' + tmp_exp_);
+  while (ok)
+  {
+    int wait_for = -1;
+    if (_timeout > 0)
+    {
+      const auto left =
+        duration_cast<milliseconds>(deadline - steady_clock::now()).count();
+      if (left <= 0)
+      {
+        timed_out = true;
+        break;
+      }
+      wait_for = left;
+    }
+
+    pollfd p;
+    p.fd = _channel;
+    p.events = POLLIN;
+    p.revents = 0;
+    const int ready = poll(&p, 1, wait_for);
+    if (ready > 0)
+    {
+      break;
+    }
+    // When Ctrl-C cancels the evaluation, the child process is killed and the
+    // next poll notices it.
+    ok = ready == 0 || errno == EINTR;
+  }
+
+  std::string response;
+  ok = ok && !timed_out && read_message(_channel, response);
+  _running = 0;
+
+  if (ok)
+  {
+    std::istringstream s(response);
+    result r;
+    switch (s.get())
+    {
+    case 'r':
+      if (read_result(s, r))
+      {
+        _evaluated = true;
+        return r;
+      }
+      break;
+    case 'e':
+      return error_result(response.substr(1));
+    }
+  }
+
+  const std::string status = stop();
+  if (_cancelled)
+  {
+    return error_result("Evaluation cancelled");
+  }
+  else if (timed_out)
+  {
+    std::ostringstream s;
+    s << "Evaluation timed out after " << _timeout << " seconds";
+    return error_result(s.str());
+  }
+  else
+  {
+    std::ostringstream s;
+    s << "The evaluating process " << status;
+    if (_memory_limit > 0)
+    {
+      s << ". It might have exceeded the memory limit (" << _memory_limit
+        << " bytes)";
+    }
+    return error_result(s.str());
+  }
+}
+
+void subprocess_evaluator::cancel()
+{
+  if (_running && _pid > 0)
+  {
+    _cancelled = 1;
+    kill(_pid, SIGKILL);
+  }
+}
+
+bool subprocess_evaluator::start(const std::string& environment_)
+{
+  std::string pid;
+  if (
+    _launcher <= 0
+    || !write_message(_control, 's' + environment_)
+    || !read_message(_control, pid)
+    || pid.empty()
+  )
+  {
+    METASHELL_LOG(_logger, "Failed to start the evaluating process");
+    return false;
+  }
+
+  const int channel = receive_fd(_control);
+  if (channel < 0)
+  {
+    kill(std::atoi(pid.c_str()), SIGKILL);
+    METASHELL_LOG(_logger, "Failed to receive the channel of " + pid);
+    return false;
+  }
+  // The processes started by Metashell (eg. Clang) should not keep it open
+  close_on_exec(channel);
+
+  _pid = std::atoi(pid.c_str());
+  _channel = channel;
+
+  METASHELL_LOG(_logger, "Evaluating process started: " + pid);
+  return true;
+}
+
+std::string subprocess_evaluator::stop()
+{
+  close(_channel);
+  kill(_pid, SIGKILL);
+
+  // The evaluating process is the child of the launcher, it can wait for it
+  std::ostringstream pid;
+  pid << _pid;
+  std::string status;
+  if (
+    !write_message(_control, 'w' + pid.str())
+    || !read_message(_control, status)
+  )
+  {
+    status = "was stopped";
+  }
+
+  METASHELL_LOG(_logger, "Evaluating process " + pid.str() + " stopped");
+
+  _pid = -1;
+  _channel = -1;
+
+  return status;
+}
+
+void subprocess_evaluator::launch(int control_)
+{
+  close_inherited_fds(control_);
+
+  // Ctrl-C is handled by Metashell, it kills the evaluating process
+  signal(SIGINT, SIG_IGN);
+
+  std::string request;
+  while (read_message(control_, request) && !request.empty())
+  {
+    if (request[0] == 's')
+    {
+      int channel[2];
+      pid_t pid = -1;
+      if (create_socket_pair(channel))
+      {
+        pid = fork();
+        if (pid < 0)
+        {
+          close(channel[0]);
+          close(channel[1]);
+        }
+      }
+
+      if (pid == 0)
+      {
+        close(control_);
+        close(channel[0]);
+        serve(request.substr(1), channel[1]);
+        _exit(0);
+      }
+      else if (pid < 0)
+      {
+        write_message(control_, "");
+      }
+      else
+      {
+        close(channel[1]);
+        std::ostringstream s;
+        s << pid;
+        write_message(control_, s.str());
+        send_fd(control_, channel[0]);
+        close(channel[0]);
+      }
+    }
+    else if (request[0] == 'w')
+    {
+      int status = 0;
+      write_message(
+        control_,
+        wait_for(std::atoi(request.c_str() + 1), status) < 0 ?
+          "was stopped" :
+          describe(status)
+      );
+    }
+  }
+}
+
+void subprocess_evaluator::serve(const std::string& environment_, int channel_)
+{
+  if (_memory_limit > 0)
+  {
+    rlimit limit;
+    limit.rlim_cur = _memory_limit;
+    limit.rlim_max = _memory_limit;
+    setrlimit(RLIMIT_AS, &limit);
+  }
+
+  evaluator evaluate;
+  std::string error;
+  const auto use_environment =
+    [this, &evaluate, &error] (const std::string& env_)
+    {
+      try
+      {
+        evaluate = _factory(env_);
+      }
+      catch (const std::exception& e_)
+      {
+        evaluate = evaluator();
+        error = e_.what();
+      }
+    };
+
+  use_environment(environment_);
+
+  std::string request;
+  while (read_message(channel_, request) && !request.empty())
+  {
+    if (request[0] == 'n')
+    {
+      use_environment(request.substr(1));
+      continue;
+    }
+
+    std::ostringstream s;
+    try
+    {
+      if (!evaluate)
+      {
+        throw exception(error);
+      }
+      const result r = evaluate(request.substr(1));
+      s << 'r';
+      write_result(s, r);
+    }
+    catch (const std::bad_alloc&)
+    {
+      s.str(std::string());
+      s << "eThe evaluation ran out of memory";
+    }
+    catch (const std::exception& e_)
+    {
+      s.str(std::string());
+      s << 'e' << e_.what();
+    }
+    catch (...)
+    {
+      s.str(std::string());
+      s << "eUnknown error";
+    }
+
+    if (!write_message(channel_, s.str()))
+    {
+      break;
+    }
+  }
+}
+
+#endif
@@ -26,14 +26,23 @@ templight_environment::templight_environment(
 {
   clang_arguments().push_back("-templight");
   clang_arguments().push_back("-templight-format");
-  clang_arguments().push_back("xml");
+  clang_arguments().push_back("binary");
+  trace_format_index = clang_arguments().size() - 1;
   clang_arguments().push_back("-templight-output");
-  clang_arguments().push_back("TEMPLIGHT_XML_LOCATION_IS_NOT_SET");
-  xml_path_index = clang_arguments().size() - 1;
+  clang_arguments().push_back("TEMPLIGHT_TRACE_LOCATION_IS_NOT_SET");
+  trace_path_index = clang_arguments().size() - 1;
 }
 
-void templight_environment::set_xml_location(const std::string& xml_location) {
-  clang_arguments()[xml_path_index] = xml_location;
+void templight_environment::set_trace_location(
+    const std::string& trace_location)
+{
+  clang_arguments()[trace_path_index] = trace_location;
+}
+
+void templight_environment::set_trace_format(
+    const std::string& trace_format)
+{
+  clang_arguments()[trace_format_index] = trace_format;
 }
 
 }
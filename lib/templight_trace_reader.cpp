@@ -0,0 +1,387 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/templight_trace_reader.hpp>
+#include <metashell/exception.hpp>
+
+#include <cassert>
+#include <exception>
+#include <fstream>
+#include <istream>
+
+#ifndef _WIN32
+#  include <algorithm>
+#  include <cerrno>
+#  include <functional>
+#  include <streambuf>
+#  include <vector>
+
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+namespace metashell {
+
+namespace {
+
+// Thrown by the builder to stop processing the trace
+struct loading_cancelled {};
+
+#ifndef _WIN32
+
+// The amount of trace read from the pipe but not processed yet is limited.
+// When the builder falls behind, templight blocks on the full pipe.
+const std::size_t max_queued_bytes = 4 * 1024 * 1024;
+
+// Reads the chunks of the trace from a queue
+class chunk_streambuf : public std::streambuf {
+public:
+  typedef std::function<bool (std::vector<char>&)> next_chunk_function;
+
+  explicit chunk_streambuf(const next_chunk_function& next_chunk) :
+    next_chunk(next_chunk)
+  {
+    setg(nullptr, nullptr, nullptr);
+  }
+
+  // Waits until n bytes are available (or the input ends) without
+  // consuming them
+  std::string peek(std::size_t n) {
+    std::vector<char> available(gptr(), egptr());
+    std::vector<char> chunk;
+    while (available.size() < n && next_chunk(chunk)) {
+      available.insert(available.end(), chunk.begin(), chunk.end());
+    }
+    buffer.swap(available);
+    setg(buffer.data(), buffer.data(), buffer.data() + buffer.size());
+    return std::string(buffer.data(), std::min(n, buffer.size()));
+  }
+
+protected:
+  virtual int_type underflow() override {
+    while (gptr() == egptr()) {
+      if (!next_chunk(buffer)) {
+        return traits_type::eof();
+      }
+      setg(buffer.data(), buffer.data(), buffer.data() + buffer.size());
+    }
+    return traits_type::to_int_type(*gptr());
+  }
+
+private:
+  next_chunk_function next_chunk;
+  std::vector<char> buffer;
+};
+
+#endif
+
+}
+
+// Adds the events to the metaprogram while the reader is not locked by
+// its users
+class templight_trace_reader::locking_builder : public metaprogram_builder {
+public:
+  locking_builder(
+      templight_trace_reader& reader,
+      metaprogram& mp,
+      const edge_added_callback& edge_added) :
+    metaprogram_builder(mp, edge_added),
+    reader(reader)
+  {}
+
+  virtual void handle_template_begin(
+    instantiation_kind kind,
+    const std::string& context,
+    const file_location& location,
+    double timestamp,
+    unsigned long long memory_usage) override
+  {
+    std::lock_guard<std::mutex> lock(reader.mutex);
+    check_cancelled();
+    metaprogram_builder::handle_template_begin(
+        kind, context, location, timestamp, memory_usage);
+    event_processed();
+  }
+
+  virtual void handle_template_end(
+    instantiation_kind kind,
+    double timestamp,
+    unsigned long long memory_usage) override
+  {
+    std::lock_guard<std::mutex> lock(reader.mutex);
+    check_cancelled();
+    metaprogram_builder::handle_template_end(kind, timestamp, memory_usage);
+    event_processed();
+  }
+
+private:
+  templight_trace_reader& reader;
+
+  void check_cancelled() const {
+#ifndef _WIN32
+    if (reader.cancelled) {
+      throw loading_cancelled();
+    }
+#endif
+  }
+
+  void event_processed() {
+    ++reader.processed_events;
+    reader.progress.notify_all();
+  }
+};
+
+#ifdef _WIN32
+
+templight_trace_reader::templight_trace_reader(
+    bool binary,
+    metaprogram& mp,
+    const metaprogram_builder::edge_added_callback& edge_added) :
+  binary(binary),
+  mp(mp),
+  user_lock(mutex, std::defer_lock),
+  builder(new locking_builder(*this, mp, edge_added)),
+  processed_events(0),
+  loaded(false),
+  trace_file("templight.trace")
+{
+  path = trace_file.get_path();
+}
+
+templight_trace_reader::~templight_trace_reader() {}
+
+bool templight_trace_reader::evaluation_finished() {
+  if (binary && !metaprogram::is_binary_trace_file(path)) {
+    return false;
+  }
+
+  std::ifstream trace(path.c_str(), std::ios::binary);
+  if (trace) {
+    load_trace(trace);
+  } else {
+    std::lock_guard<std::mutex> lock(mutex);
+    error = std::string("Can't open templight file");
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  loaded = true;
+  return true;
+}
+
+#else
+
+templight_trace_reader::templight_trace_reader(
+    bool binary,
+    metaprogram& mp,
+    const metaprogram_builder::edge_added_callback& edge_added) :
+  binary(binary),
+  mp(mp),
+  user_lock(mutex, std::defer_lock),
+  builder(new locking_builder(*this, mp, edge_added)),
+  processed_events(0),
+  loaded(false),
+  write_fd(-1),
+  format_checked(false),
+  expected_format(false),
+  cancelled(false),
+  queued_bytes(0),
+  pipe_closed(false)
+{
+  int fds[2];
+  if (pipe(fds) != 0) {
+    throw exception("Failed to create pipe for the templight trace");
+  }
+  // Templight opens the write end by its name. The processes started by
+  // Metashell should not keep them open.
+  fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+  fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+
+  write_fd = fds[1];
+  path = "/dev/fd/" + std::to_string(write_fd);
+
+  const int read_fd = fds[0];
+  pipe_reader = std::thread([this, read_fd] { read_pipe(read_fd); });
+  trace_builder = std::thread([this] { build(); });
+}
+
+templight_trace_reader::~templight_trace_reader() {
+  assert(!user_lock.owns_lock());
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    cancelled = true;
+  }
+  close_write_end();
+  if (pipe_reader.joinable()) {
+    pipe_reader.join();
+  }
+  if (trace_builder.joinable()) {
+    trace_builder.join();
+  }
+}
+
+bool templight_trace_reader::evaluation_finished() {
+  close_write_end();
+
+  std::unique_lock<std::mutex> lock(mutex);
+  progress.wait(lock, [this] { return format_checked; });
+  return expected_format;
+}
+
+void templight_trace_reader::read_pipe(int read_fd) {
+  // Templight blocks when the pipe is full, thus the trace is read as fast
+  // as possible and processed by another thread. Only a limited amount of
+  // it is queued up to keep the memory usage bounded.
+  char buffer[65536];
+  for (;;) {
+    ssize_t len;
+    do {
+      len = ::read(read_fd, buffer, sizeof(buffer));
+    } while (len < 0 && errno == EINTR);
+
+    if (len <= 0) {
+      break;
+    }
+
+    std::unique_lock<std::mutex> lock(chunks_mutex);
+    chunk_consumed.wait(
+        lock, [this] { return queued_bytes < max_queued_bytes; });
+    chunks.emplace_back(buffer, buffer + len);
+    queued_bytes += len;
+    chunk_available.notify_one();
+  }
+
+  close(read_fd);
+
+  std::lock_guard<std::mutex> lock(chunks_mutex);
+  pipe_closed = true;
+  chunk_available.notify_one();
+}
+
+bool templight_trace_reader::next_chunk(std::vector<char>& chunk) {
+  std::unique_lock<std::mutex> lock(chunks_mutex);
+  chunk_available.wait(lock, [this] { return pipe_closed || !chunks.empty(); });
+  if (chunks.empty()) {
+    return false;
+  }
+  chunk.swap(chunks.front());
+  chunks.pop_front();
+  queued_bytes -= chunk.size();
+  chunk_consumed.notify_one();
+  return true;
+}
+
+void templight_trace_reader::build() {
+  chunk_streambuf buffer(
+    [this](std::vector<char>& chunk) { return next_chunk(chunk); });
+
+  const bool is_binary = metaprogram::is_binary_trace(buffer.peek(8));
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    format_checked = true;
+    expected_format = !binary || is_binary;
+    progress.notify_all();
+  }
+
+  if (expected_format) {
+    std::istream trace(&buffer);
+    load_trace(trace);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    loaded = true;
+    progress.notify_all();
+  }
+
+  // The unused part of the trace is freed
+  std::vector<char> chunk;
+  while (next_chunk(chunk)) {}
+}
+
+void templight_trace_reader::close_write_end() {
+  // The end of the trace is reached when both templight and Metashell have
+  // closed the write end
+  if (write_fd >= 0) {
+    close(write_fd);
+    write_fd = -1;
+  }
+}
+
+#endif
+
+void templight_trace_reader::load_trace(std::istream& trace) {
+  try {
+    if (binary) {
+      read_binary_trace(trace, *builder);
+    } else {
+      read_xml_trace(trace, *builder);
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    builder->finish();
+  } catch (const loading_cancelled&) {
+    // The metaprogram is not used any more
+  } catch (const std::exception& e) {
+    std::lock_guard<std::mutex> lock(mutex);
+    error = std::string(e.what());
+  }
+}
+
+const std::string& templight_trace_reader::get_path() const {
+  return path;
+}
+
+void templight_trace_reader::lock() {
+  user_lock.lock();
+}
+
+void templight_trace_reader::unlock() {
+  user_lock.unlock();
+}
+
+bool templight_trace_reader::is_loaded() const {
+  assert(user_lock.owns_lock());
+  return loaded;
+}
+
+boost::optional<std::string> templight_trace_reader::take_error() {
+  assert(user_lock.owns_lock());
+
+  boost::optional<std::string> result;
+  result.swap(error);
+  return result;
+}
+
+bool templight_trace_reader::is_open(
+    metaprogram::vertex_descriptor vertex) const
+{
+  assert(user_lock.owns_lock());
+  return
+    !loaded && (vertex == mp.get_root_vertex() || builder->is_open(vertex));
+}
+
+bool templight_trace_reader::wait_for_more_events() {
+  assert(user_lock.owns_lock());
+
+  const std::size_t seen = processed_events;
+  progress.wait(
+      user_lock,
+      [this, seen] { return loaded || processed_events != seen; });
+  return processed_events != seen;
+}
+
+}
+
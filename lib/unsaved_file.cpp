@@ -15,13 +15,6 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <metashell/unsaved_file.hpp>
-#include <metashell/exception.hpp>
-
-#include <boost/filesystem/path.hpp>
-#include <boost/filesystem/operations.hpp>
-
-#include <iostream>
-#include <fstream>
 
 using namespace metashell;
 
@@ -52,19 +45,3 @@ const std::string& unsaved_file::content() const
   return _content;
 }
 
-void unsaved_file::generate() const
-{
-  boost::filesystem::path p(_filename);
-  p.remove_filename();
-  create_directories(p); // Throws when fails to create the directory
-  std::ofstream f(_filename.c_str());
-  if (f)
-  {
-    f << _content;
-  }
-  else
-  {
-    throw exception("Error creating file " + _filename);
-  }
-}
-
@@ -0,0 +1,373 @@
+
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/xml_pull_parser.hpp>
+#include <metashell/exception.hpp>
+
+#include <cstdlib>
+#include <istream>
+
+using namespace metashell;
+
+namespace
+{
+  const int eof = std::char_traits<char>::eof();
+
+  bool is_whitespace(int c_)
+  {
+    return c_ == ' ' || c_ == '\t' || c_ == '\n' || c_ == '\r';
+  }
+
+  bool is_name_char(int c_)
+  {
+    return
+      c_ != eof
+      && !is_whitespace(c_)
+      && c_ != '/' && c_ != '>' && c_ != '=' && c_ != '<'
+      && c_ != '"' && c_ != '\'';
+  }
+
+  void append_utf8(unsigned long c_, std::string& out_)
+  {
+    if (c_ < 0x80)
+    {
+      out_ += char(c_);
+    }
+    else if (c_ < 0x800)
+    {
+      out_ += char(0xc0 | (c_ >> 6));
+      out_ += char(0x80 | (c_ & 0x3f));
+    }
+    else if (c_ < 0x10000)
+    {
+      out_ += char(0xe0 | (c_ >> 12));
+      out_ += char(0x80 | ((c_ >> 6) & 0x3f));
+      out_ += char(0x80 | (c_ & 0x3f));
+    }
+    else
+    {
+      out_ += char(0xf0 | (c_ >> 18));
+      out_ += char(0x80 | ((c_ >> 12) & 0x3f));
+      out_ += char(0x80 | ((c_ >> 6) & 0x3f));
+      out_ += char(0x80 | (c_ & 0x3f));
+    }
+  }
+
+  [[noreturn]] void parse_error(const std::string& msg_)
+  {
+    throw exception("XML parse failed (" + msg_ + ")");
+  }
+}
+
+xml_pull_parser::xml_pull_parser(std::istream& in_) :
+  _in(in_.rdbuf()),
+  _name(),
+  _text(),
+  _attributes(),
+  _attribute_count(0),
+  _pending_end(false)
+{}
+
+xml_pull_parser::token xml_pull_parser::next()
+{
+  if (_pending_end)
+  {
+    _pending_end = false;
+    _attribute_count = 0;
+    return token::end_element;
+  }
+
+  for (;;)
+  {
+    const int c = peek();
+    if (c == eof)
+    {
+      return token::end_of_document;
+    }
+    else if (c != '<')
+    {
+      read_text();
+      return token::text;
+    }
+
+    get();
+    switch (peek())
+    {
+    case '?':
+      skip_until("?>");
+      break;
+    case '!':
+      get();
+      if (peek() == '-')
+      {
+        expect('-');
+        expect('-');
+        skip_until("-->");
+      }
+      else if (peek() == '[')
+      {
+        read_cdata();
+        return token::text;
+      }
+      else
+      {
+        skip_until(">");
+      }
+      break;
+    case '/':
+      get();
+      read_end_element();
+      return token::end_element;
+    default:
+      read_start_element();
+      return token::start_element;
+    }
+  }
+}
+
+const std::string& xml_pull_parser::name() const
+{
+  return _name;
+}
+
+const std::string& xml_pull_parser::text() const
+{
+  return _text;
+}
+
+const std::string* xml_pull_parser::attribute(const std::string& name_) const
+{
+  for (int i = 0; i != _attribute_count; ++i)
+  {
+    if (_attributes[i].first == name_)
+    {
+      return &_attributes[i].second;
+    }
+  }
+  return nullptr;
+}
+
+int xml_pull_parser::peek()
+{
+  return _in ? _in->sgetc() : eof;
+}
+
+int xml_pull_parser::get()
+{
+  return _in ? _in->sbumpc() : eof;
+}
+
+void xml_pull_parser::expect(char c_)
+{
+  if (get() != c_)
+  {
+    parse_error(std::string("expected ") + c_);
+  }
+}
+
+void xml_pull_parser::skip_whitespace()
+{
+  while (is_whitespace(peek()))
+  {
+    get();
+  }
+}
+
+void xml_pull_parser::skip_until(const std::string& s_)
+{
+  // The last s_.size() characters read
+  std::string last;
+  while (last != s_)
+  {
+    const int c = get();
+    if (c == eof)
+    {
+      parse_error("unexpected end of document");
+    }
+    if (last.size() == s_.size())
+    {
+      last.erase(last.begin());
+    }
+    last += char(c);
+  }
+}
+
+void xml_pull_parser::read_name(std::string& out_)
+{
+  out_.clear();
+  while (is_name_char(peek()))
+  {
+    out_ += char(get());
+  }
+  if (out_.empty())
+  {
+    parse_error("missing name");
+  }
+}
+
+void xml_pull_parser::read_entity(std::string& out_)
+{
+  std::string entity;
+  for (int c = get(); c != ';'; c = get())
+  {
+    if (c == eof || entity.size() > 8)
+    {
+      parse_error("invalid entity");
+    }
+    entity += char(c);
+  }
+
+  if (entity == "lt")
+  {
+    out_ += '<';
+  }
+  else if (entity == "gt")
+  {
+    out_ += '>';
+  }
+  else if (entity == "amp")
+  {
+    out_ += '&';
+  }
+  else if (entity == "quot")
+  {
+    out_ += '"';
+  }
+  else if (entity == "apos")
+  {
+    out_ += '\'';
+  }
+  else if (entity.size() > 1 && entity[0] == '#')
+  {
+    const bool hex = entity[1] == 'x' || entity[1] == 'X';
+    const char* begin = entity.c_str() + (hex ? 2 : 1);
+    char* end = nullptr;
+    const unsigned long c = std::strtoul(begin, &end, hex ? 16 : 10);
+    if (end == begin || *end != 0 || c > 0x10ffff)
+    {
+      parse_error("invalid character reference");
+    }
+    append_utf8(c, out_);
+  }
+  else
+  {
+    parse_error("unknown entity &" + entity + ";");
+  }
+}
+
+void xml_pull_parser::read_start_element()
+{
+  read_name(_name);
+  _attribute_count = 0;
+
+  for (;;)
+  {
+    skip_whitespace();
+    const int c = peek();
+    if (c == '>')
+    {
+      get();
+      return;
+    }
+    else if (c == '/')
+    {
+      get();
+      expect('>');
+      _pending_end = true;
+      return;
+    }
+
+    if (_attribute_count == int(_attributes.size()))
+    {
+      _attributes.emplace_back();
+    }
+    std::pair<std::string, std::string>& a = _attributes[_attribute_count];
+    ++_attribute_count;
+
+    read_name(a.first);
+    skip_whitespace();
+    expect('=');
+    skip_whitespace();
+
+    const int quote = get();
+    if (quote != '"' && quote != '\'')
+    {
+      parse_error("missing quote");
+    }
+    a.second.clear();
+    for (int v = get(); v != quote; v = get())
+    {
+      if (v == eof)
+      {
+        parse_error("unexpected end of document");
+      }
+      else if (v == '&')
+      {
+        read_entity(a.second);
+      }
+      else
+      {
+        a.second += char(v);
+      }
+    }
+  }
+}
+
+void xml_pull_parser::read_end_element()
+{
+  read_name(_name);
+  skip_whitespace();
+  expect('>');
+  _attribute_count = 0;
+}
+
+void xml_pull_parser::read_text()
+{
+  _text.clear();
+  for (int c = peek(); c != eof && c != '<'; c = peek())
+  {
+    get();
+    if (c == '&')
+    {
+      read_entity(_text);
+    }
+    else
+    {
+      _text += char(c);
+    }
+  }
+}
+
+void xml_pull_parser::read_cdata()
+{
+  for (const char c : std::string("[CDATA["))
+  {
+    expect(c);
+  }
+  _text.clear();
+  while (_text.size() < 3 || _text.compare(_text.size() - 3, 3, "]]>") != 0)
+  {
+    const int c = get();
+    if (c == eof)
+    {
+      parse_error("unexpected end of document");
+    }
+    _text += char(c);
+  }
+  _text.resize(_text.size() - 3);
+}
+
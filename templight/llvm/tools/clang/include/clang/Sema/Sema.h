@@ -8599,6 +8599,7 @@ public:
   struct PrintableTraceEntry {
     bool IsTemplateBegin;
     std::string InstantiationKind;
+    unsigned InstantiationKindValue = 0;
     std::string Name;
     std::string FileName;
     int Line = 0;
@@ -8649,6 +8650,27 @@ public:
     std::string getFormatName() { return "text"; }
   };
 
+  /// \brief Writes fixed-size event records. Every name and file name is
+  /// written once, before the first event referring to it, thus the trace
+  /// can be processed while it is being written. The layout is described
+  /// in SemaTemplateInstantiate.cpp.
+  class BinaryPrinter : public TracePrinter {
+  public:
+    BinaryPrinter() : EventCount(0) {}
+
+    void startTrace(raw_ostream* os);
+    void endTrace(raw_ostream* os);
+    void printEntry(raw_ostream* os, const PrintableTraceEntry& Entry);
+
+    std::string getFormatName() { return "binary"; }
+
+  private:
+    unsigned getStringId(raw_ostream* os, const std::string& S);
+
+    unsigned EventCount;
+    llvm::StringMap<unsigned> StringIds;
+  };
+
 private:
   PrintableTraceEntry rawToPrintable(const RawTraceEntry& Entry);
 
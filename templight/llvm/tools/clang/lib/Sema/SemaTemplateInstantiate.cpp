@@ -161,6 +161,105 @@ void Sema::TextPrinter::printEntry(raw_ostream* os,
   }
 }
 
+// The binary trace starts with a header:
+//   char[8]  "TMPLBIN\0"
+//   uint32   version (2)
+// followed by records starting with their type (uint8). An event is a
+// 40 byte record:
+//   uint8    1 for TemplateBegin, 0 for TemplateEnd
+//   uint8    instantiation kind (the value of InstantiationKind)
+//   uint16   unused
+//   uint32   index of the name (TemplateBegin only)
+//   uint32   index of the file name (TemplateBegin only)
+//   uint32   line of the point of instantiation (TemplateBegin only)
+//   uint32   column of the point of instantiation (TemplateBegin only)
+//   uint32   unused
+//   double   timestamp
+//   uint64   memory usage
+// A string is written before the first event referring to it. The strings
+// are indexed in the order they appear in the trace:
+//   uint8    2
+//   uint8[3] unused
+//   uint32   length
+//   char[]   the characters
+// The last record marks the end of the trace:
+//   uint8    3
+//   uint8[3] unused
+//   uint32   number of events
+// Every number is little endian.
+namespace {
+
+const unsigned BinaryTraceNoString = 0xffffffff;
+
+enum BinaryTraceRecord {
+  BinaryTraceEnd = 0,
+  BinaryTraceBegin = 1,
+  BinaryTraceString = 2,
+  BinaryTraceFinished = 3
+};
+
+void writeLittleEndian(raw_ostream* os, uint64_t Value, unsigned Bytes) {
+  char Buffer[8];
+  for (unsigned i = 0; i < Bytes; ++i) {
+    Buffer[i] = static_cast<char>((Value >> (8 * i)) & 0xff);
+  }
+  os->write(Buffer, Bytes);
+}
+
+} // unnamed namespace
+
+void Sema::BinaryPrinter::startTrace(raw_ostream* os) {
+  os->write("TMPLBIN\0", 8);
+  writeLittleEndian(os, 2, 4);
+}
+
+void Sema::BinaryPrinter::endTrace(raw_ostream* os) {
+  writeLittleEndian(os, BinaryTraceFinished, 4);
+  writeLittleEndian(os, EventCount, 4);
+}
+
+void Sema::BinaryPrinter::printEntry(raw_ostream* os,
+  const PrintableTraceEntry& Entry) {
+  uint64_t TimeStampBits;
+  static_assert(sizeof(TimeStampBits) == sizeof(Entry.TimeStamp),
+    "double is expected to be 64 bits");
+  memcpy(&TimeStampBits, &Entry.TimeStamp, sizeof(TimeStampBits));
+
+  // The strings have to be written before the event
+  const unsigned NameId =
+    Entry.IsTemplateBegin ? getStringId(os, Entry.Name) : BinaryTraceNoString;
+  const unsigned FileId =
+    Entry.IsTemplateBegin ?
+      getStringId(os, Entry.FileName) : BinaryTraceNoString;
+
+  writeLittleEndian(os,
+    Entry.IsTemplateBegin ? BinaryTraceBegin : BinaryTraceEnd, 1);
+  writeLittleEndian(os, Entry.InstantiationKindValue, 1);
+  writeLittleEndian(os, 0, 2);
+  writeLittleEndian(os, NameId, 4);
+  writeLittleEndian(os, FileId, 4);
+  writeLittleEndian(os, Entry.IsTemplateBegin ? Entry.Line : 0, 4);
+  writeLittleEndian(os, Entry.IsTemplateBegin ? Entry.Column : 0, 4);
+  writeLittleEndian(os, 0, 4);
+  writeLittleEndian(os, TimeStampBits, 8);
+  writeLittleEndian(os, uint64_t(Entry.MemoryUsage), 8);
+  ++EventCount;
+}
+
+unsigned Sema::BinaryPrinter::getStringId(raw_ostream* os,
+  const std::string& S) {
+  llvm::StringMap<unsigned>::iterator I = StringIds.find(S);
+  if (I != StringIds.end()) {
+    return I->getValue();
+  }
+  const unsigned Id = StringIds.size();
+  StringIds[S] = Id;
+  writeLittleEndian(os, BinaryTraceString, 4);
+  writeLittleEndian(os, S.size(), 4);
+  os->write(S.data(), S.size());
+  return Id;
+}
+
 namespace { // unnamed namespace
 
 const char* InstantiationKindStrings[] = { "TemplateInstantiation",
@@ -267,6 +366,9 @@ void Sema::setTemplightFormat(const std::string& Format) {
   else if (Format == "txt") {
     TemplateTracePrinter.reset(new TextPrinter());
   }
+  else if (Format == "binary") {
+    TemplateTracePrinter.reset(new BinaryPrinter());
+  }
   else {
     llvm::errs() << "Error: Unrecoginized template trace format:" << Format << '\n';
   }
@@ -280,6 +382,7 @@ Sema::rawToPrintable(const Sema::RawTraceEntry& Entry) {
 
   Ret.IsTemplateBegin = Entry.IsTemplateBegin;
   Ret.InstantiationKind = InstantiationKindStrings[Entry.InstantiationKind];
+  Ret.InstantiationKindValue = Entry.InstantiationKind;
 
   if (Entry.IsTemplateBegin) {
     Decl *Template = reinterpret_cast<Decl*>(Entry.Entity);
@@ -0,0 +1,180 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "benchmark.hpp"
+
+#include <metashell/exception.hpp>
+#include <metashell/in_memory_displayer.hpp>
+
+#include <iomanip>
+#include <iostream>
+#include <map>
+
+using namespace metashell;
+
+namespace
+{
+  std::string argv0;
+
+  std::map<std::string, benchmark::benchmark_case>& cases()
+  {
+    static std::map<std::string, benchmark::benchmark_case> c;
+    return c;
+  }
+
+  bool run_case(const std::string& name_, const benchmark::benchmark_case& c_)
+  {
+    std::cout << name_ << ":" << std::endl;
+    try
+    {
+      c_(std::cout);
+      return true;
+    }
+    catch (const std::exception& e_)
+    {
+      std::cerr << "Error: " << e_.what() << std::endl;
+      return false;
+    }
+  }
+}
+
+benchmark::registration::registration(
+  const std::string& name_,
+  const benchmark_case& case_
+)
+{
+  cases()[name_] = case_;
+}
+
+int benchmark::run(int argc_, char* argv_[])
+{
+  argv0 = argv_[0];
+
+  bool success = true;
+  if (argc_ < 2)
+  {
+    for (const auto& c : cases())
+    {
+      success = run_case(c.first, c.second) && success;
+    }
+  }
+  else
+  {
+    for (int i = 1; i < argc_; ++i)
+    {
+      const auto c = cases().find(argv_[i]);
+      if (c == cases().end())
+      {
+        std::cerr << "Unknown benchmark: " << argv_[i] << std::endl;
+        success = false;
+      }
+      else
+      {
+        success = run_case(c->first, c->second) && success;
+      }
+    }
+  }
+  return success ? 0 : 1;
+}
+
+config benchmark::benchmark_config()
+{
+  config cfg = empty_config(argv0);
+#ifdef WINDOWS_HEADERS
+  const std::string windows_headers = WINDOWS_HEADERS;
+  cfg.include_path.push_back(windows_headers);
+  cfg.include_path.push_back(windows_headers + "\\mingw32");
+#endif
+  cfg.include_path.push_back(BOOST_INCLUDE_PATH);
+#ifdef LIBCXX_INCLUDE_PATH
+  cfg.include_path.push_back(LIBCXX_INCLUDE_PATH);
+#endif
+  // The cases measure the evaluations, not the cache
+  cfg.cache_memory_limit = 0;
+  return cfg;
+}
+
+void benchmark::extend_environment(shell& sh_, const std::string& code_)
+{
+  in_memory_displayer d;
+  if (!sh_.store_in_buffer(code_, d))
+  {
+    throw
+      exception(
+        "Failed to extend the environment with " + code_
+        + (d.errors().empty() ? std::string() : ": " + d.errors().front())
+      );
+  }
+  sh_.env().update(true);
+}
+
+std::chrono::microseconds benchmark::average_time(
+  unsigned repeat_,
+  const std::function<void ()>& f_
+)
+{
+  using std::chrono::steady_clock;
+
+  f_();
+
+  const steady_clock::time_point start = steady_clock::now();
+  for (unsigned i = 0; i != repeat_; ++i)
+  {
+    f_();
+  }
+  return
+    std::chrono::duration_cast<std::chrono::microseconds>(
+      steady_clock::now() - start
+    ) / (repeat_ == 0 ? 1 : repeat_);
+}
+
+void benchmark::display_time(
+  std::ostream& out_,
+  const std::string& name_,
+  std::chrono::microseconds t_
+)
+{
+  out_
+    << "  " << name_ << ": " << std::fixed << std::setprecision(1)
+    << t_.count() / 1000.0 << " ms" << std::endl;
+}
+
+void benchmark::display_throughput(
+  std::ostream& out_,
+  const std::string& name_,
+  unsigned count_,
+  std::chrono::microseconds t_
+)
+{
+  out_
+    << "  " << name_ << ": " << std::fixed << std::setprecision(1)
+    << (t_.count() == 0 ? 0.0 : count_ * 1000000.0 / t_.count()) << "/s"
+    << std::endl;
+}
+
+void benchmark::display_speedup(
+  std::ostream& out_,
+  std::chrono::microseconds before_,
+  std::chrono::microseconds after_
+)
+{
+  out_
+    << "  Speedup: " << std::fixed << std::setprecision(2)
+    << (after_.count() == 0 ?
+      0.0 :
+      static_cast<double>(before_.count()) / after_.count())
+    << "x" << std::endl;
+}
@@ -0,0 +1,88 @@
+#ifndef METASHELL_BENCHMARK_BENCHMARK_HPP
+#define METASHELL_BENCHMARK_BENCHMARK_HPP
+
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/config.hpp>
+#include <metashell/shell.hpp>
+
+#include <chrono>
+#include <functional>
+#include <iosfwd>
+#include <string>
+
+namespace metashell
+{
+  namespace benchmark
+  {
+    typedef std::function<void (std::ostream&)> benchmark_case;
+
+    // Used by METASHELL_BENCHMARK to register the cases before main starts
+    struct registration
+    {
+      registration(const std::string& name_, const benchmark_case& case_);
+    };
+
+    // Runs the cases whose names are in the arguments (or all of them when
+    // there are no arguments). Returns the exit code of the driver.
+    int run(int argc_, char* argv_[]);
+
+    // The configuration of Metashell used by the cases
+    config benchmark_config();
+
+    // Adds code_ to the environment of sh_ and waits until its precompiled
+    // header is built. Throws when the code is invalid.
+    void extend_environment(shell& sh_, const std::string& code_);
+
+    // The average time of running f_ repeat_ times (after one warm-up run)
+    std::chrono::microseconds average_time(
+      unsigned repeat_,
+      const std::function<void ()>& f_
+    );
+
+    void display_time(
+      std::ostream& out_,
+      const std::string& name_,
+      std::chrono::microseconds t_
+    );
+
+    // Displays how many operations were done per second when count_ of them
+    // took t_
+    void display_throughput(
+      std::ostream& out_,
+      const std::string& name_,
+      unsigned count_,
+      std::chrono::microseconds t_
+    );
+
+    void display_speedup(
+      std::ostream& out_,
+      std::chrono::microseconds before_,
+      std::chrono::microseconds after_
+    );
+  }
+}
+
+#define METASHELL_BENCHMARK(name) \
+  void name(std::ostream&); \
+  namespace \
+  { \
+    ::metashell::benchmark::registration name##_registration(#name, name); \
+  } \
+  void name(std::ostream& out_)
+
+#endif
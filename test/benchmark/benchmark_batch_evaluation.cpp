@@ -0,0 +1,80 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "benchmark.hpp"
+
+#include <metashell/evaluation_session.hpp>
+#include <metashell/metashell.hpp>
+#include <metashell/shell.hpp>
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+using namespace metashell;
+
+// Compares evaluating metaprograms one by one to evaluating them in one
+// translation unit
+METASHELL_BENCHMARK(batch_evaluation)
+{
+  const config cfg = benchmark::benchmark_config();
+  shell sh(cfg);
+  benchmark::extend_environment(sh, "#include <boost/mpl/vector.hpp>");
+
+  std::vector<std::string> exps;
+  for (int i = 1; i <= 200; ++i)
+  {
+    exps.push_back("boost::mpl::vector<char[" + std::to_string(i) + "]>");
+  }
+
+  evaluation_session session;
+
+  const auto one_by_one =
+    benchmark::average_time(
+      3,
+      [&]
+      {
+        for (const std::string& exp : exps)
+        {
+          eval_tmp_formatted(
+            sh.env(),
+            exp,
+            cfg,
+            shell::input_filename(),
+            session
+          );
+        }
+      }
+    );
+  const auto batch =
+    benchmark::average_time(
+      3,
+      [&]
+      {
+        eval_tmp_batch(
+          sh.env(),
+          exps,
+          cfg,
+          shell::input_filename(),
+          session
+        );
+      }
+    );
+
+  benchmark::display_throughput(out_, "One by one", exps.size(), one_by_one);
+  benchmark::display_throughput(out_, "Batch", exps.size(), batch);
+  benchmark::display_speedup(out_, one_by_one, batch);
+}
@@ -0,0 +1,79 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "benchmark.hpp"
+
+#include <metashell/evaluation_session.hpp>
+#include <metashell/metashell.hpp>
+#include <metashell/shell.hpp>
+
+#include <ostream>
+#include <string>
+
+using namespace metashell;
+
+// Compares evaluating a metaprogram with and without metashell::format in
+// one translation unit to parsing the two versions one after the other in an
+// environment using a precompiled header.
+METASHELL_BENCHMARK(formatted_evaluation)
+{
+  const config cfg = benchmark::benchmark_config();
+  shell sh(cfg);
+  benchmark::extend_environment(sh, "#include <boost/mpl/vector.hpp>");
+
+  const std::string exp = "boost::mpl::vector<int, double, char>";
+  evaluation_session session;
+
+  const auto two_parses =
+    benchmark::average_time(
+      20,
+      [&]
+      {
+        eval_tmp_unformatted(
+          sh.env(),
+          exp,
+          cfg,
+          shell::input_filename(),
+          session
+        );
+        eval_tmp_unformatted(
+          sh.env(),
+          "::metashell::format<" + exp + ">::type",
+          cfg,
+          shell::input_filename(),
+          session
+        );
+      }
+    );
+  const auto one_parse =
+    benchmark::average_time(
+      20,
+      [&]
+      {
+        eval_tmp_formatted(
+          sh.env(),
+          exp,
+          cfg,
+          shell::input_filename(),
+          session
+        );
+      }
+    );
+
+  benchmark::display_time(out_, "Two parses", two_parses);
+  benchmark::display_time(out_, "One parse", one_parse);
+  benchmark::display_speedup(out_, two_parses, one_parse);
+}
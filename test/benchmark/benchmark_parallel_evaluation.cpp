@@ -0,0 +1,77 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "benchmark.hpp"
+
+#include <metashell/evaluation_pool.hpp>
+#include <metashell/shell.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace metashell;
+
+// Evaluates the same batch of metaprograms with a growing number of workers
+// to show how the evaluation scales
+METASHELL_BENCHMARK(parallel_evaluation)
+{
+  const config cfg = benchmark::benchmark_config();
+  shell sh(cfg);
+  benchmark::extend_environment(sh, "#include <boost/mpl/vector.hpp>");
+
+  std::vector<std::string> exps;
+  for (int i = 1; i <= 400; ++i)
+  {
+    exps.push_back("boost::mpl::vector<char[" + std::to_string(i) + "]>");
+  }
+
+  const unsigned max_jobs = std::max(1u, std::thread::hardware_concurrency());
+
+  std::chrono::microseconds one_job(0);
+  for (unsigned jobs = 1; ; jobs = std::min(jobs * 2, max_jobs))
+  {
+    evaluation_pool pool(jobs, nullptr);
+    const auto t =
+      benchmark::average_time(
+        3,
+        [&]
+        {
+          pool.eval_tmp_batch(sh.env(), exps, cfg, shell::input_filename());
+        }
+      );
+
+    if (jobs == 1)
+    {
+      one_job = t;
+    }
+    benchmark::display_throughput(
+      out_,
+      std::to_string(jobs) + (jobs == 1 ? " job" : " jobs"),
+      exps.size(),
+      t
+    );
+    benchmark::display_speedup(out_, one_job, t);
+
+    if (jobs == max_jobs)
+    {
+      break;
+    }
+  }
+}
@@ -0,0 +1,149 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "benchmark.hpp"
+
+#include <metashell/clang_binary.hpp>
+#include <metashell/exception.hpp>
+#include <metashell/header_file_environment.hpp>
+#include <metashell/in_memory_environment.hpp>
+#include <metashell/shell.hpp>
+
+#include <just/temp.hpp>
+
+#include <boost/algorithm/string/trim.hpp>
+#include <boost/filesystem.hpp>
+
+#include <chrono>
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+using namespace metashell;
+
+namespace
+{
+  const unsigned repeat = 5;
+
+  void write_file(const std::string& fn_, const std::string& content_)
+  {
+    boost::filesystem::create_directories(
+      boost::filesystem::path(fn_).parent_path()
+    );
+    std::ofstream f(fn_.c_str());
+    f << content_;
+  }
+
+  // Building the precompiled header in the environment by saving the
+  // translation unit parsed by libclang
+  std::chrono::microseconds in_process(
+    const config& cfg_,
+    const std::string& content_
+  )
+  {
+    using std::chrono::steady_clock;
+
+    std::chrono::microseconds total(0);
+    for (unsigned i = 0; i != repeat; ++i)
+    {
+      header_file_environment env(cfg_, nullptr);
+      env.update(true);
+
+      const steady_clock::time_point start = steady_clock::now();
+      env.append(content_);
+      env.update(true);
+      total +=
+        std::chrono::duration_cast<std::chrono::microseconds>(
+          steady_clock::now() - start
+        );
+
+      if (!env.get().empty())
+      {
+        throw exception("Failed to build the precompiled header");
+      }
+    }
+    return total / repeat;
+  }
+
+  // Building the precompiled header by running the Clang binary, which is
+  // how it was done before
+  std::chrono::microseconds with_clang_binary(
+    const config& cfg_,
+    const std::string& content_
+  )
+  {
+    just::temp::directory dir;
+    in_memory_environment env(dir.path(), cfg_);
+    for (const unsaved_file& h : env.get_headers())
+    {
+      write_file(h.filename(), h.content());
+    }
+
+    const std::string fn = dir.path() + "/metashell_environment.hpp";
+    write_file(fn, content_);
+
+    std::vector<std::string> args = env.clang_arguments();
+    args.push_back("-iquote");
+    args.push_back(".");
+    args.push_back("-w");
+    args.push_back("-o");
+    args.push_back(fn + ".pch");
+    args.push_back(fn);
+
+    const clang_binary clang(cfg_.clang_path, nullptr);
+    return
+      benchmark::average_time(
+        repeat,
+        [&clang, &args]
+        {
+          const just::process::output o = clang.run(args);
+          const std::string err =
+            boost::algorithm::trim_copy(
+              o.standard_output() + o.standard_error()
+            );
+          if (
+            !err.empty()
+            // Clang displays this even when "-w" is used
+            && err != "warning: precompiled header used __DATE__ or __TIME__."
+          )
+          {
+            throw
+              exception(
+                "Failed to build the precompiled header: " + err
+              );
+          }
+        }
+      );
+  }
+}
+
+// Compares building the precompiled header of an environment in the
+// Metashell process to running the Clang binary to build it
+METASHELL_BENCHMARK(precompiled_header)
+{
+  const config cfg = benchmark::benchmark_config();
+  shell sh(cfg);
+  benchmark::extend_environment(sh, "#include <boost/mpl/vector.hpp>");
+  const std::string content = sh.env().get_all();
+
+  const auto spawning = with_clang_binary(cfg, content);
+  const auto saving = in_process(cfg, content);
+
+  benchmark::display_time(out_, "Clang binary", spawning);
+  benchmark::display_time(out_, "In process", saving);
+  benchmark::display_speedup(out_, spawning, saving);
+}
@@ -0,0 +1,73 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "benchmark.hpp"
+
+#include <metashell/evaluation_session.hpp>
+#include <metashell/metashell.hpp>
+#include <metashell/shell.hpp>
+
+#include <ostream>
+#include <string>
+
+using namespace metashell;
+
+// Evaluates the same metaprogram while the environment grows. Only the
+// top-level nodes of the main file are visited to find the type of the
+// variable, thus the evaluation time should not grow with the number of
+// declarations coming from the (precompiled) headers.
+METASHELL_BENCHMARK(type_lookup)
+{
+  const config cfg = benchmark::benchmark_config();
+  shell sh(cfg);
+  evaluation_session session;
+
+  const std::string headers[] = {
+    "",
+    "boost/mpl/vector.hpp",
+    "boost/mpl/map.hpp",
+    "boost/mpl/set.hpp",
+    "boost/mpl/list.hpp",
+    "boost/fusion/include/vector.hpp",
+    "boost/fusion/include/map.hpp"
+  };
+
+  for (const std::string& h : headers)
+  {
+    if (!h.empty())
+    {
+      benchmark::extend_environment(sh, "#include <" + h + ">");
+    }
+
+    benchmark::display_time(
+      out_,
+      h.empty() ? "Empty environment" : "+ " + h,
+      benchmark::average_time(
+        20,
+        [&]
+        {
+          eval_tmp_unformatted(
+            sh.env(),
+            "int",
+            cfg,
+            shell::input_filename(),
+            session
+          );
+        }
+      )
+    );
+  }
+}
@@ -43,6 +43,19 @@ mdb_test_shell::mdb_test_shell(
   env.append(line);
 }
 
+void mdb_test_shell::line_available(
+    const std::string& line,
+    metashell::iface::displayer& displayer_,
+    metashell::iface::history& history_)
+{
+  metashell::mdb_shell::line_available(line, displayer_, history_);
+
+  if (mp) {
+    const auto lock = lock_metaprogram();
+    mp->wait_until_loaded(mp->get_root_vertex());
+  }
+}
+
 bool mdb_test_shell::has_metaprogram() const {
   return static_cast<bool>(mp);
 }
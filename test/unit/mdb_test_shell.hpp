@@ -28,6 +28,16 @@ public:
   mdb_test_shell(const std::string& line = "");
   mdb_test_shell(metashell::shell& shell, const std::string& line = "");
 
+  using metashell::mdb_shell::line_available;
+
+  // Waits until the trace is loaded, thus the output of the commands does
+  // not depend on the speed of loading it
+  virtual void line_available(
+    const std::string& line,
+    metashell::iface::displayer& displayer_,
+    metashell::iface::history& history_
+  ) override;
+
   bool has_metaprogram() const;
   const metashell::metaprogram& get_metaprogram() const;
 
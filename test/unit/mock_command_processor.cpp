@@ -19,16 +19,17 @@
 using namespace metashell;
 
 mock_command_processor::mock_command_processor() :
-  code_complete_callback([](const std::string&, std::set<std::string>&) {})
+  code_complete_callback([](const std::string&, std::set<std::string>&) {}),
+  line_available_callback([](const std::string&) {})
 {}
 
 void mock_command_processor::line_available(
-  const std::string&,
+  const std::string& cmd_,
   iface::displayer&,
   iface::history&
 )
 {
-  // ignore
+  line_available_callback(cmd_);
 }
 
 void mock_command_processor::cancel_operation()
@@ -43,6 +43,7 @@ public:
 
   std::function<void(const std::string&, std::set<std::string>&)>
     code_complete_callback;
+  std::function<void(const std::string&)> line_available_callback;
 };
 
 #endif
@@ -30,7 +30,8 @@ mock_environment_detector::mock_environment_detector() :
   _default_clang_sysinclude_called_times(0),
   _extra_sysinclude_called_times(0),
   _path_of_executable_called_times(0),
-  _clang_binary_works_with_libclang_called_times(0)
+  _clang_binary_works_with_libclang_called_times(0),
+  _default_cache_dir_called_times(0)
 {}
 
 void mock_environment_detector::search_clang_binary_returns(
@@ -201,3 +202,20 @@ void mock_environment_detector::set_clang_binary_works_with_libclang_callback(
   _clang_binary_works_with_libclang_cb = cb_;
 }
 
+std::string mock_environment_detector::default_cache_dir()
+{
+  ++_default_cache_dir_called_times;
+  return _default_cache_dir_returns;
+}
+
+int mock_environment_detector::default_cache_dir_called_times() const
+{
+  return _default_cache_dir_called_times;
+}
+
+void mock_environment_detector::default_cache_dir_returns(
+  const std::string& result_
+)
+{
+  _default_cache_dir_returns = result_;
+}
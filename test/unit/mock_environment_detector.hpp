@@ -68,6 +68,10 @@ public:
   void set_clang_binary_works_with_libclang_callback(
     const std::function<bool(const std::string&)> cb_
   );
+
+  virtual std::string default_cache_dir();
+  int default_cache_dir_called_times() const;
+  void default_cache_dir_returns(const std::string& result_);
 private:
   std::string _search_clang_binary_returns;
   int _search_clang_binary_called_times;
@@ -96,6 +100,9 @@ private:
 
   int _clang_binary_works_with_libclang_called_times;
   std::function<bool(const std::string&)> _clang_binary_works_with_libclang_cb;
+
+  int _default_cache_dir_called_times;
+  std::string _default_cache_dir_returns;
 };
 
 #endif
@@ -225,3 +225,113 @@ JUST_TEST_CASE(test_it_is_an_error_to_specify_log_twice)
   JUST_ASSERT(r.should_error_at_exit());
 }
 
+
+JUST_TEST_CASE(test_evaluation_cache_is_enabled_by_default)
+{
+  const user_config cfg = parse_config({}).cfg;
+
+  JUST_ASSERT(cfg.cache_memory_limit > 0);
+}
+
+JUST_TEST_CASE(test_setting_the_memory_limit_of_the_evaluation_cache)
+{
+  const user_config cfg =
+    parse_config({"--cache_memory_limit", "1024"}).cfg;
+
+  JUST_ASSERT_EQUAL(1024u, cfg.cache_memory_limit);
+}
+
+JUST_TEST_CASE(test_disabling_the_evaluation_cache)
+{
+  JUST_ASSERT(parse_config({}).cfg.cache_enabled);
+  JUST_ASSERT(!parse_config({"--no_cache"}).cfg.cache_enabled);
+}
+
+JUST_TEST_CASE(test_setting_the_cache_directory)
+{
+  const user_config cfg = parse_config({"--cache_dir", "/foo"}).cfg;
+
+  JUST_ASSERT_EQUAL("/foo", cfg.cache_dir);
+}
+
+JUST_TEST_CASE(test_evaluation_results_are_not_stored_on_disc_by_default)
+{
+  JUST_ASSERT_EQUAL(0u, parse_config({}).cfg.cache_disc_limit);
+}
+
+JUST_TEST_CASE(test_setting_the_disc_limit_of_the_evaluation_cache)
+{
+  const user_config cfg = parse_config({"--cache_disc_limit", "1024"}).cfg;
+
+  JUST_ASSERT_EQUAL(1024u, cfg.cache_disc_limit);
+}
+
+JUST_TEST_CASE(test_setting_the_limit_of_the_precompiled_header_cache)
+{
+  const user_config cfg =
+    parse_config({"--precompiled_header_cache_limit", "1024"}).cfg;
+
+  JUST_ASSERT_EQUAL(1024u, cfg.precompiled_header_cache_limit);
+}
+
+JUST_TEST_CASE(test_batch_mode_uses_json_console)
+{
+  const user_config cfg = parse_config({"--batch", "foo.txt"}).cfg;
+
+  JUST_ASSERT_EQUAL("foo.txt", cfg.batch_file);
+  JUST_ASSERT_EQUAL(console_type::json, cfg.con_type);
+}
+
+JUST_TEST_CASE(test_setting_the_number_of_jobs)
+{
+  JUST_ASSERT_EQUAL(1u, parse_config({}).cfg.jobs);
+  JUST_ASSERT_EQUAL(4u, parse_config({"--jobs", "4"}).cfg.jobs);
+  JUST_ASSERT_EQUAL(4u, parse_config({"-j", "4"}).cfg.jobs);
+}
+
+JUST_TEST_CASE(test_setting_the_evaluation_limits)
+{
+  const user_config cfg =
+    parse_config(
+      {"--evaluation_timeout", "5", "--evaluation_memory_limit", "1024"}
+    ).cfg;
+
+  JUST_ASSERT(!parse_config({}).cfg.subprocess_evaluation);
+  JUST_ASSERT(
+    parse_config({"--subprocess_evaluation"}).cfg.subprocess_evaluation
+  );
+  JUST_ASSERT_EQUAL(5u, cfg.evaluation_timeout);
+  JUST_ASSERT_EQUAL(1024u, cfg.evaluation_memory_limit);
+}
+
+JUST_TEST_CASE(test_watching_the_headers)
+{
+  JUST_ASSERT(!parse_config({}).cfg.watch_headers);
+  JUST_ASSERT(parse_config({"--watch_headers"}).cfg.watch_headers);
+}
+
+JUST_TEST_CASE(test_enabling_modules)
+{
+  JUST_ASSERT(!parse_config({}).cfg.use_modules);
+  JUST_ASSERT(parse_config({"--modules"}).cfg.use_modules);
+}
+
+JUST_TEST_CASE(test_enabling_the_startup_profile)
+{
+  JUST_ASSERT(!parse_config({}).cfg.startup_profile);
+  JUST_ASSERT(parse_config({"--startup_profile"}).cfg.startup_profile);
+}
+
+JUST_TEST_CASE(test_prebuilding_the_precompiled_headers)
+{
+  JUST_ASSERT_EQUAL(
+    "",
+    parse_config({}).cfg.prebuild_precompiled_headers
+  );
+  JUST_ASSERT_EQUAL(
+    "/usr/share/metashell",
+    parse_config(
+      {"--prebuild_precompiled_headers", "/usr/share/metashell"}
+    ).cfg.prebuild_precompiled_headers
+  );
+}
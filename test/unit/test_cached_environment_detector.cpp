@@ -0,0 +1,115 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/cached_environment_detector.hpp>
+#include <metashell/config.hpp>
+
+#include "mock_environment_detector.hpp"
+
+#include <just/test.hpp>
+#include <just/temp.hpp>
+
+#include <fstream>
+
+using namespace metashell;
+
+namespace
+{
+  void write_file(const std::string& path_, const std::string& content_)
+  {
+    std::ofstream f(path_.c_str());
+    f << content_;
+  }
+}
+
+JUST_TEST_CASE(test_sysinclude_is_cached_between_detectors)
+{
+  just::temp::directory d;
+  const std::string clang = d.path() + "/clang";
+  write_file(clang, "clang binary");
+
+  mock_environment_detector envd;
+  envd.default_clang_sysinclude_returns_append("/usr/include");
+
+  const std::vector<std::string>
+    first =
+      cached_environment_detector(envd, d.path() + "/cache", nullptr)
+        .default_clang_sysinclude(clang);
+  const std::vector<std::string>
+    second =
+      cached_environment_detector(envd, d.path() + "/cache", nullptr)
+        .default_clang_sysinclude(clang);
+
+  JUST_ASSERT_EQUAL(1, envd.default_clang_sysinclude_called_times());
+  JUST_ASSERT_EQUAL_CONTAINER(first, second);
+  JUST_ASSERT_EQUAL(1u, second.size());
+  JUST_ASSERT_EQUAL("/usr/include", second[0]);
+}
+
+JUST_TEST_CASE(test_sysinclude_is_detected_again_when_clang_changes)
+{
+  just::temp::directory d;
+  const std::string clang = d.path() + "/clang";
+  write_file(clang, "clang binary");
+
+  mock_environment_detector envd;
+  cached_environment_detector cached(envd, d.path() + "/cache", nullptr);
+
+  cached.default_clang_sysinclude(clang);
+  write_file(clang, "new clang binary");
+  cached.default_clang_sysinclude(clang);
+
+  JUST_ASSERT_EQUAL(2, envd.default_clang_sysinclude_called_times());
+}
+
+JUST_TEST_CASE(test_nothing_is_cached_without_cache_directory)
+{
+  just::temp::directory d;
+  const std::string clang = d.path() + "/clang";
+  write_file(clang, "clang binary");
+
+  mock_environment_detector envd;
+  cached_environment_detector cached(envd, "", nullptr);
+
+  cached.default_clang_sysinclude(clang);
+  cached.default_clang_sysinclude(clang);
+
+  JUST_ASSERT_EQUAL(2, envd.default_clang_sysinclude_called_times());
+}
+
+JUST_TEST_CASE(test_libclang_check_is_cached_between_detectors)
+{
+  just::temp::directory d;
+  config cfg;
+  cfg.clang_path = d.path() + "/clang";
+  write_file(cfg.clang_path, "clang binary");
+
+  mock_environment_detector envd;
+  envd.set_clang_binary_works_with_libclang_callback(
+    [](const std::string&) { return true; }
+  );
+
+  JUST_ASSERT(
+    cached_environment_detector(envd, d.path() + "/cache", nullptr)
+      .clang_binary_works_with_libclang(cfg)
+  );
+  JUST_ASSERT(
+    cached_environment_detector(envd, d.path() + "/cache", nullptr)
+      .clang_binary_works_with_libclang(cfg)
+  );
+  JUST_ASSERT_EQUAL(1, envd.clang_binary_works_with_libclang_called_times());
+}
+
@@ -741,3 +741,79 @@ JUST_TEST_CASE(test_splash_enabled_is_copied_from_user_config)
   JUST_ASSERT(!cfg.splash_enabled);
 }
 
+
+JUST_TEST_CASE(test_cache_memory_limit_is_copied_from_user_config)
+{
+  user_config ucfg;
+  ucfg.cache_memory_limit = 1024;
+
+  mock_environment_detector envd;
+  std::ostringstream err;
+  const config cfg = metashell::detect_config(ucfg, envd, err, nullptr);
+
+  JUST_ASSERT_EQUAL(1024u, cfg.cache_memory_limit);
+}
+
+JUST_TEST_CASE(test_default_cache_dir_is_used_when_not_set_by_user)
+{
+  mock_environment_detector envd;
+  envd.default_cache_dir_returns("/home/foo/.cache/metashell");
+  std::ostringstream err;
+  const config cfg =
+    metashell::detect_config(user_config(), envd, err, nullptr);
+
+  JUST_ASSERT_EQUAL("/home/foo/.cache/metashell", cfg.cache_dir);
+}
+
+JUST_TEST_CASE(test_cache_dir_is_copied_from_user_config)
+{
+  user_config ucfg;
+  ucfg.cache_dir = "/foo";
+
+  mock_environment_detector envd;
+  envd.default_cache_dir_returns("/home/foo/.cache/metashell");
+  std::ostringstream err;
+  const config cfg = metashell::detect_config(ucfg, envd, err, nullptr);
+
+  JUST_ASSERT_EQUAL("/foo", cfg.cache_dir);
+}
+
+JUST_TEST_CASE(test_disabling_the_cache)
+{
+  user_config ucfg;
+  ucfg.cache_enabled = false;
+
+  mock_environment_detector envd;
+  envd.default_cache_dir_returns("/home/foo/.cache/metashell");
+  std::ostringstream err;
+  const config cfg = metashell::detect_config(ucfg, envd, err, nullptr);
+
+  JUST_ASSERT_EQUAL(0u, cfg.cache_memory_limit);
+  JUST_ASSERT_EQUAL("", cfg.cache_dir);
+  JUST_ASSERT_EQUAL(0u, cfg.precompiled_header_cache_limit);
+}
+
+JUST_TEST_CASE(test_zero_jobs_means_at_least_one_job)
+{
+  user_config ucfg;
+  ucfg.jobs = 0;
+
+  mock_environment_detector envd;
+  std::ostringstream err;
+  const config cfg = metashell::detect_config(ucfg, envd, err, nullptr);
+
+  JUST_ASSERT(cfg.jobs >= 1);
+}
+
+JUST_TEST_CASE(test_evaluation_limits_enable_subprocess_evaluation)
+{
+  user_config ucfg;
+  ucfg.evaluation_timeout = 5;
+
+  mock_environment_detector envd;
+  std::ostringstream err;
+  const config cfg = metashell::detect_config(ucfg, envd, err, nullptr);
+
+  JUST_ASSERT(cfg.subprocess_evaluation);
+  JUST_ASSERT_EQUAL(5u, cfg.evaluation_timeout);
+}
@@ -20,6 +20,8 @@
 #include <metashell/shell.hpp>
 
 #include <metashell/config.hpp>
+#include <metashell/content_hash.hpp>
+#include <metashell/headers.hpp>
 
 #include <just/test.hpp>
 #include <just/temp.hpp>
@@ -46,6 +48,12 @@ namespace
     std::ifstream f(path_.c_str());
     return !(f.fail() || f.bad());
   }
+
+  void write_file(const std::string& path_, const std::string& content_)
+  {
+    std::ofstream f(path_.c_str());
+    f << content_;
+  }
 }
 
 JUST_TEST_CASE(test_empty_in_memory_environment_is_empty)
@@ -66,6 +74,25 @@ JUST_TEST_CASE(test_append_text_to_in_memory_environment)
   test_append_text_to_environment(env);
 }
 
+JUST_TEST_CASE(test_digest_of_in_memory_environment_depends_on_content_only)
+{
+  const config cfg = empty_config(argv0::get());
+
+  in_memory_environment env1("foo", cfg);
+  env1.append("typedef int x;");
+  env1.append("typedef int y;");
+
+  in_memory_environment env2("foo", cfg);
+  env2.append("typedef int x;\ntypedef int y;");
+
+  JUST_ASSERT_EQUAL(env1.get_all(), env2.get_all());
+  JUST_ASSERT_EQUAL(env1.get_all_digest(), env2.get_all_digest());
+  JUST_ASSERT_EQUAL(
+    content_hash().add_raw(env1.get_all()).digest(),
+    env1.get_all_digest()
+  );
+}
+
 JUST_TEST_CASE(test_empty_header_file_environment_is_empty)
 {
   config cfg = empty_config(argv0::get());
@@ -86,6 +113,156 @@ JUST_TEST_CASE(test_append_text_to_header_file_environment)
   test_append_text_to_environment(env);
 }
 
+JUST_TEST_CASE(test_header_file_environment_serves_headers_from_memory)
+{
+  config cfg = empty_config(argv0::get());
+  cfg.use_precompiled_headers = false;
+
+  header_file_environment env(cfg, nullptr);
+  env.append("typedef int x;");
+
+  const std::string fn = env.internal_dir() + "/metashell_environment.hpp";
+  const headers& hs = env.get_headers();
+  const auto h =
+    std::find_if(
+      hs.begin(),
+      hs.end(),
+      [&fn] (const unsaved_file& f_) { return f_.filename() == fn; }
+    );
+
+  JUST_ASSERT(h != hs.end());
+  JUST_ASSERT_EQUAL("typedef int x;", h->content());
+  JUST_ASSERT(!file_exists(fn));
+}
+
+JUST_TEST_CASE(test_appended_definition_is_kept_out_of_precompiled_header)
+{
+  config cfg = empty_config(argv0::get());
+  cfg.use_precompiled_headers = true;
+
+  header_file_environment env(cfg, nullptr);
+  env.append("typedef int x;");
+
+  JUST_ASSERT_EQUAL("#include <metashell_environment_tail.hpp>\n", env.get());
+  JUST_ASSERT_EQUAL("typedef int x;", env.get_all());
+}
+
+JUST_TEST_CASE(test_included_header_gets_into_precompiled_header)
+{
+  config cfg = empty_config(argv0::get());
+  cfg.use_precompiled_headers = true;
+
+  header_file_environment env(cfg, nullptr);
+  env.append("typedef int x;");
+  env.append("#include <metashell/scalar.hpp>");
+
+  JUST_ASSERT_EQUAL("#include <metashell_environment_tail.hpp>\n", env.get());
+
+  env.update(true);
+
+  JUST_ASSERT(!env.rebuilding_precompiled_header());
+  JUST_ASSERT(bool(env.last_rebuild_time()));
+  JUST_ASSERT_EQUAL("", env.get());
+  JUST_ASSERT_EQUAL(
+    "typedef int x;\n#include <metashell/scalar.hpp>",
+    env.get_all()
+  );
+}
+
+JUST_TEST_CASE(test_include_during_rebuild_does_not_wait_for_the_rebuild)
+{
+  config cfg = empty_config(argv0::get());
+  cfg.use_precompiled_headers = true;
+
+  header_file_environment env(cfg, nullptr);
+  env.append("#include <metashell/scalar.hpp>");
+  env.append("#include <metashell/scalar.hpp> // again");
+
+  // The first rebuild has not been waited for
+  JUST_ASSERT(env.rebuilding_precompiled_header());
+  JUST_ASSERT(!env.last_rebuild_time());
+
+  env.update(true);
+
+  JUST_ASSERT(!env.rebuilding_precompiled_header());
+  JUST_ASSERT_EQUAL("", env.get());
+}
+
+JUST_TEST_CASE(test_include_during_warm_up_does_not_wait_for_the_warm_up)
+{
+  config cfg = empty_config(argv0::get());
+  cfg.use_precompiled_headers = true;
+
+  // The shell precompiles its built-in definitions this way at startup
+  header_file_environment env(cfg, nullptr);
+  env.append("typedef int x;");
+  env.precompile_in_background();
+
+  env.append("#include <metashell/scalar.hpp>");
+
+  JUST_ASSERT(env.rebuilding_precompiled_header());
+  JUST_ASSERT(!env.last_rebuild_time());
+  JUST_ASSERT_EQUAL("#include <metashell_environment_tail.hpp>\n", env.get());
+
+  env.update(true);
+
+  JUST_ASSERT(bool(env.last_rebuild_time()));
+  JUST_ASSERT_EQUAL("", env.get());
+  JUST_ASSERT_EQUAL(
+    "typedef int x;\n#include <metashell/scalar.hpp>",
+    env.get_all()
+  );
+}
+
+JUST_TEST_CASE(test_failed_rebuild_of_precompiled_header_is_not_repeated)
+{
+  config cfg = empty_config(argv0::get());
+  cfg.use_precompiled_headers = true;
+
+  header_file_environment env(cfg, nullptr);
+  env.append("#include <metashell_no_such_header.hpp>");
+  env.update(true);
+
+  JUST_ASSERT(!env.rebuilding_precompiled_header());
+  JUST_ASSERT(!env.last_rebuild_time());
+  JUST_ASSERT_EQUAL("#include <metashell_environment_tail.hpp>\n", env.get());
+
+  env.append("#include <metashell/scalar.hpp>");
+
+  JUST_ASSERT(!env.rebuilding_precompiled_header());
+}
+
+JUST_TEST_CASE(test_headers_included_by_the_tail_are_not_known)
+{
+  config cfg = empty_config(argv0::get());
+  cfg.use_precompiled_headers = true;
+
+  header_file_environment env(cfg, nullptr);
+  env.append("typedef int x;");
+  env.update(true);
+
+  JUST_ASSERT(env.dependencies_known());
+
+  env.append("#include <metashell/scalar.hpp>");
+
+  JUST_ASSERT(!env.dependencies_known());
+
+  env.update(true);
+
+  JUST_ASSERT(env.dependencies_known());
+}
+
+JUST_TEST_CASE(test_dependencies_are_not_known_without_precompiled_headers)
+{
+  config cfg = empty_config(argv0::get());
+  cfg.use_precompiled_headers = false;
+
+  header_file_environment env(cfg, nullptr);
+
+  JUST_ASSERT(!env.dependencies_known());
+  JUST_ASSERT(!in_memory_environment("foo", cfg).dependencies_known());
+}
+
 JUST_TEST_CASE(test_reload_environment_rebuilds_the_environment_object)
 {
   in_memory_displayer d;
@@ -97,6 +274,52 @@ JUST_TEST_CASE(test_reload_environment_rebuilds_the_environment_object)
   JUST_ASSERT_NOT_EQUAL(old_env_ptr, &sh.env());
 }
 
+JUST_TEST_CASE(test_reload_environment_rebuilds_only_when_a_header_changed)
+{
+  just::temp::directory dir;
+  const std::string header = dir.path() + "/reloaded.hpp";
+  write_file(header, "typedef int x;");
+
+  config cfg = test_config();
+  cfg.use_precompiled_headers = true;
+  cfg.include_path.push_back(dir.path());
+
+  in_memory_displayer d;
+  shell sh(cfg);
+  sh.line_available("#include <reloaded.hpp>", d);
+  const environment* old_env_ptr = &sh.env();
+
+  sh.line_available("#msh environment reload", d);
+
+  JUST_ASSERT_EQUAL(old_env_ptr, &sh.env());
+  JUST_ASSERT_EQUAL_CONTAINER(
+    {text("None of the included headers has changed.")},
+    d.comments()
+  );
+
+  write_file(header, "typedef double x;");
+  d.clear();
+  sh.line_available("#msh environment reload", d);
+  sh.line_available("x", d);
+
+  JUST_ASSERT_EQUAL(old_env_ptr, &sh.env());
+  JUST_ASSERT_EMPTY_CONTAINER(d.comments());
+  JUST_ASSERT_EQUAL_CONTAINER({type("double")}, d.types());
+}
+
+JUST_TEST_CASE(test_in_memory_environment_precompiles_nothing)
+{
+  const config cfg = empty_config(argv0::get());
+  in_memory_environment env("foo", cfg);
+  env.append("typedef int x;");
+
+  env.precompile_in_background();
+
+  JUST_ASSERT(!env.rebuilding_precompiled_header());
+  JUST_ASSERT(!env.last_rebuild_time());
+  JUST_ASSERT(!env.create_successor(cfg, nullptr));
+}
+
 JUST_TEST_CASE(test_template_depth_is_set_by_the_environment)
 {
   config cfg;
@@ -111,6 +334,58 @@ JUST_TEST_CASE(test_template_depth_is_set_by_the_environment)
   );
 }
 
+JUST_TEST_CASE(test_modules_are_enabled_by_the_environment)
+{
+  config cfg;
+  cfg.cache_dir = "/cache";
+
+  const in_memory_environment plain(".", cfg);
+  cfg.use_modules = true;
+  const in_memory_environment modules(".", cfg);
+
+  const auto& ps = plain.clang_arguments();
+  const auto& ms = modules.clang_arguments();
+
+  JUST_ASSERT(std::find(ps.begin(), ps.end(), "-fmodules") == ps.end());
+  JUST_ASSERT(std::find(ms.begin(), ms.end(), "-fmodules") != ms.end());
+  JUST_ASSERT(
+    std::find(ms.begin(), ms.end(), "-fmodules-cache-path=/cache/modules")
+    != ms.end()
+  );
+}
+
+JUST_TEST_CASE(test_evaluation_through_a_module)
+{
+  just::temp::directory dir;
+  // The modules are compiled on their own, thus they do not see the macros
+  // of the environment
+  write_file(
+    dir.path() + "/modular.hpp",
+    "#ifdef METASHELL_TEST_MACRO\n"
+    "  typedef METASHELL_TEST_MACRO x;\n"
+    "#else\n"
+    "  typedef int x;\n"
+    "#endif\n"
+  );
+  write_file(
+    dir.path() + "/module.modulemap",
+    "module modular {\n  header \"modular.hpp\"\n  export *\n}\n"
+  );
+
+  config cfg = test_config();
+  cfg.use_modules = true;
+  cfg.include_path.push_back(dir.path());
+
+  in_memory_displayer d;
+  shell sh(cfg);
+  sh.line_available("#define METASHELL_TEST_MACRO double", d);
+  sh.line_available("#include <modular.hpp>", d);
+  sh.line_available("x", d);
+
+  JUST_ASSERT_EMPTY_CONTAINER(d.errors());
+  JUST_ASSERT_EQUAL_CONTAINER({type("int")}, d.types());
+}
+
 JUST_TEST_CASE(test_invalid_environment_command_displays_an_error)
 {
   in_memory_displayer d;
@@ -0,0 +1,106 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/environment_snapshot.hpp>
+#include <metashell/in_memory_environment.hpp>
+#include <metashell/config.hpp>
+
+#include <just/test.hpp>
+
+#include "test_config.hpp"
+#include "argv0.hpp"
+
+#include <algorithm>
+#include <sstream>
+
+using namespace metashell;
+
+namespace
+{
+  bool same_headers(const headers& a_, const headers& b_)
+  {
+    return
+      a_.internal_dir() == b_.internal_dir()
+      && a_.size() == b_.size()
+      && std::equal(
+        a_.begin(),
+        a_.end(),
+        b_.begin(),
+        [] (const unsaved_file& x_, const unsaved_file& y_)
+        {
+          return
+            x_.filename() == y_.filename() && x_.content() == y_.content();
+        }
+      );
+  }
+
+  void assert_same_environment(const environment& a_, const environment& b_)
+  {
+    JUST_ASSERT_EQUAL(a_.get(), b_.get());
+    JUST_ASSERT_EQUAL(a_.get_appended("int x;"), b_.get_appended("int x;"));
+    JUST_ASSERT_EQUAL(a_.get_all(), b_.get_all());
+    JUST_ASSERT_EQUAL(a_.get_all_digest(), b_.get_all_digest());
+    JUST_ASSERT_EQUAL(
+      a_.get_dependencies_digest(),
+      b_.get_dependencies_digest()
+    );
+    JUST_ASSERT_EQUAL(a_.dependencies_known(), b_.dependencies_known());
+    JUST_ASSERT_EQUAL(a_.internal_dir(), b_.internal_dir());
+    JUST_ASSERT(a_.clang_arguments() == b_.clang_arguments());
+    JUST_ASSERT(same_headers(a_.get_headers(), b_.get_headers()));
+  }
+}
+
+JUST_TEST_CASE(test_environment_snapshot_copies_the_environment)
+{
+  in_memory_environment env("foo", empty_config(argv0::get()));
+  env.append("typedef int x;");
+
+  assert_same_environment(env, environment_snapshot(env));
+}
+
+JUST_TEST_CASE(test_environment_snapshot_serialisation)
+{
+  in_memory_environment env("foo", empty_config(argv0::get()));
+  env.append("typedef int x;");
+  env.append("\n\n12 bytes\n");
+
+  std::ostringstream out;
+  write_environment(out, environment_snapshot(env));
+
+  environment_snapshot read;
+  std::istringstream in(out.str());
+  JUST_ASSERT(read_environment(in, read));
+
+  assert_same_environment(env, read);
+}
+
+JUST_TEST_CASE(test_environment_snapshot_reading_invalid_data)
+{
+  in_memory_environment env("foo", empty_config(argv0::get()));
+
+  std::ostringstream out;
+  write_environment(out, environment_snapshot(env));
+  const std::string data = out.str();
+
+  environment_snapshot read;
+  std::istringstream truncated(data.substr(0, data.size() / 2));
+  JUST_ASSERT(!read_environment(truncated, read));
+
+  std::istringstream other("metashell evaluation result 1\n");
+  JUST_ASSERT(!read_environment(other, read));
+}
+
@@ -39,6 +39,14 @@ JUST_TEST_CASE(test_non_existing_class)
   JUST_ASSERT(!d.errors().empty());
 }
 
+JUST_TEST_CASE(test_error_is_not_repeated_by_the_formatted_metaprogram)
+{
+  in_memory_displayer d;
+  shell sh(test_config());
+  sh.line_available("hello", d);
+  JUST_ASSERT_EQUAL(1u, d.errors().size());
+}
+
 JUST_TEST_CASE(test_accept_empty_input)
 {
   in_memory_displayer d;
@@ -421,3 +429,96 @@ JUST_TEST_CASE(test_prompt_is_different_in_multiline_input)
   JUST_ASSERT_EQUAL("...>", sh.prompt());
 }
 
+
+JUST_TEST_CASE(test_variable_with_the_same_name_in_the_environment_is_ignored)
+{
+  in_memory_displayer d;
+  shell sh(test_config());
+  sh.store_in_buffer(
+    "namespace foo { ::metashell::impl::wrap<double> __metashell_v; }",
+    d
+  );
+  sh.line_available("int", d);
+
+  JUST_ASSERT_EMPTY_CONTAINER(d.errors());
+  JUST_ASSERT_EQUAL_CONTAINER({type("int")}, d.types());
+}
+
+JUST_TEST_CASE(test_evaluating_metaprograms_in_one_batch)
+{
+  in_memory_displayer d;
+  shell sh(test_config());
+  sh.run_metaprograms({"int", "double"}, d);
+
+  JUST_ASSERT_EMPTY_CONTAINER(d.errors());
+  JUST_ASSERT_EQUAL_CONTAINER({"int", "double"}, d.cpp_codes());
+  JUST_ASSERT_EQUAL_CONTAINER({type("int"), type("double")}, d.types());
+}
+
+JUST_TEST_CASE(test_error_in_batch_does_not_break_other_metaprograms)
+{
+  in_memory_displayer d;
+  shell sh(test_config());
+  sh.run_metaprograms({"int", "hello", "double"}, d);
+
+  JUST_ASSERT(!d.errors().empty());
+  JUST_ASSERT_EQUAL_CONTAINER({type("int"), type("double")}, d.types());
+}
+
+JUST_TEST_CASE(test_errors_of_multi_line_metaprograms_in_batch)
+{
+  in_memory_displayer d;
+  shell sh(test_config());
+  sh.run_metaprograms({"const\nint", "int\nhello", "double"}, d);
+
+  JUST_ASSERT(!d.errors().empty());
+  JUST_ASSERT_EQUAL_CONTAINER({type("const int"), type("double")}, d.types());
+}
+
+JUST_TEST_CASE(test_lines_evaluated_together_keep_the_environment_changes)
+{
+  in_memory_displayer d;
+  null_history h;
+  shell sh(test_config());
+  sh.lines_available({"int", "typedef char x;", "x", "double"}, d, h);
+
+  JUST_ASSERT_EMPTY_CONTAINER(d.errors());
+  JUST_ASSERT_EQUAL_CONTAINER({"int", "x", "double"}, d.cpp_codes());
+  JUST_ASSERT_EQUAL_CONTAINER(
+    {type("int"), type("char"), type("double")},
+    d.types()
+  );
+}
+
+JUST_TEST_CASE(test_evaluating_empty_batch)
+{
+  in_memory_displayer d;
+  shell sh(test_config());
+  sh.run_metaprograms({}, d);
+
+  JUST_ASSERT_EMPTY_CONTAINER(d.cpp_codes());
+  JUST_ASSERT_EMPTY_CONTAINER(d.types());
+  JUST_ASSERT_EMPTY_CONTAINER(d.errors());
+}
+
+JUST_TEST_CASE(test_batch_evaluated_on_multiple_threads_keeps_the_order)
+{
+  config cfg = test_config();
+  cfg.jobs = 3;
+
+  in_memory_displayer d;
+  shell sh(cfg);
+  sh.run_metaprograms({"char", "short", "int", "long", "double"}, d);
+
+  JUST_ASSERT_EMPTY_CONTAINER(d.errors());
+  JUST_ASSERT_EQUAL_CONTAINER(
+    {
+      type("char"),
+      type("short"),
+      type("int"),
+      type("long"),
+      type("double")
+    },
+    d.types()
+  );
+}
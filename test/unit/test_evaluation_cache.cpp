@@ -0,0 +1,145 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/evaluation_cache.hpp>
+#include <metashell/in_memory_environment.hpp>
+
+#include "test_config.hpp"
+
+#include <just/test.hpp>
+
+#include <string>
+
+using namespace metashell;
+
+namespace
+{
+  result result_with_output(const std::string& output_)
+  {
+    const std::vector<std::string> no_errors;
+    return result(output_, no_errors.begin(), no_errors.end(), "");
+  }
+
+  std::string key_of(const std::string& exp_)
+  {
+    const in_memory_environment env("__metashell_internal", test_config());
+    return evaluation_cache::key(env, exp_, "<stdin>", true, false);
+  }
+}
+
+JUST_TEST_CASE(test_evaluation_cache_is_empty_by_default)
+{
+  const evaluation_cache c(1024);
+
+  JUST_ASSERT_EQUAL(0u, c.size());
+  JUST_ASSERT_EQUAL(0u, c.memory_usage());
+  JUST_ASSERT_EQUAL(0u, c.hits());
+  JUST_ASSERT_EQUAL(0u, c.misses());
+}
+
+JUST_TEST_CASE(test_evaluation_cache_miss)
+{
+  evaluation_cache c(1024);
+
+  JUST_ASSERT(!c.find(key_of("int")));
+  JUST_ASSERT_EQUAL(1u, c.misses());
+}
+
+JUST_TEST_CASE(test_evaluation_cache_hit)
+{
+  evaluation_cache c(1024);
+  c.store(key_of("int"), result_with_output("int"));
+
+  const boost::optional<result> r = c.find(key_of("int"));
+
+  JUST_ASSERT(bool(r));
+  JUST_ASSERT_EQUAL("int", r->output);
+  JUST_ASSERT_EQUAL(1u, c.hits());
+  JUST_ASSERT_EQUAL(0u, c.misses());
+}
+
+JUST_TEST_CASE(test_evaluation_cache_key_depends_on_the_expression)
+{
+  JUST_ASSERT(key_of("int") != key_of("double"));
+}
+
+JUST_TEST_CASE(test_evaluation_cache_key_depends_on_the_environment)
+{
+  in_memory_environment env("__metashell_internal", test_config());
+  const std::string before =
+    evaluation_cache::key(env, "int", "<stdin>", true, false);
+
+  env.append("typedef int x;");
+
+  JUST_ASSERT(
+    before != evaluation_cache::key(env, "int", "<stdin>", true, false)
+  );
+}
+
+JUST_TEST_CASE(test_evaluation_cache_key_does_not_depend_on_internal_dir)
+{
+  const in_memory_environment env1("/tmp/foo", test_config());
+  const in_memory_environment env2("/tmp/bar", test_config());
+
+  JUST_ASSERT_EQUAL(
+    evaluation_cache::key(env1, "int", "<stdin>", true, false),
+    evaluation_cache::key(env2, "int", "<stdin>", true, false)
+  );
+}
+
+JUST_TEST_CASE(test_evaluation_cache_key_depends_on_formatting)
+{
+  const in_memory_environment env("__metashell_internal", test_config());
+
+  JUST_ASSERT(
+    evaluation_cache::key(env, "int", "<stdin>", true, false)
+    != evaluation_cache::key(env, "int", "<stdin>", false, false)
+  );
+}
+
+JUST_TEST_CASE(test_least_recently_used_result_is_dropped_from_cache)
+{
+  evaluation_cache c(1024);
+  c.store(key_of("a"), result_with_output(std::string(300, 'a')));
+  c.store(key_of("b"), result_with_output(std::string(300, 'b')));
+  c.find(key_of("a"));
+  c.store(key_of("c"), result_with_output(std::string(300, 'c')));
+
+  JUST_ASSERT(c.memory_usage() <= c.memory_limit());
+  JUST_ASSERT(bool(c.find(key_of("a"))));
+  JUST_ASSERT(!c.find(key_of("b")));
+  JUST_ASSERT(bool(c.find(key_of("c"))));
+}
+
+JUST_TEST_CASE(test_result_larger_than_the_limit_is_not_cached)
+{
+  evaluation_cache c(16);
+  c.store(key_of("int"), result_with_output("int"));
+
+  JUST_ASSERT_EQUAL(0u, c.size());
+  JUST_ASSERT_EQUAL(0u, c.memory_usage());
+}
+
+JUST_TEST_CASE(test_clearing_the_evaluation_cache)
+{
+  evaluation_cache c(1024);
+  c.store(key_of("int"), result_with_output("int"));
+  c.clear();
+
+  JUST_ASSERT_EQUAL(0u, c.size());
+  JUST_ASSERT_EQUAL(0u, c.memory_usage());
+  JUST_ASSERT(!c.find(key_of("int")));
+}
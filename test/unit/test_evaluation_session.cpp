@@ -0,0 +1,118 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "test_config.hpp"
+
+#include <metashell/evaluation_session.hpp>
+#include <metashell/in_memory_environment.hpp>
+#include <metashell/metashell.hpp>
+
+#include <just/test.hpp>
+
+using namespace metashell;
+
+namespace
+{
+  const char wrap_definition[] =
+    "namespace metashell { namespace impl { "
+      "template <class T> struct wrap {}; "
+    "} }";
+
+  result eval(
+    const environment& env_,
+    const std::string& exp_,
+    evaluation_session& session_
+  )
+  {
+    return
+      eval_tmp_unformatted(env_, exp_, test_config(), "<stdin>", session_);
+  }
+}
+
+JUST_TEST_CASE(test_new_session_has_no_translation_unit)
+{
+  evaluation_session s;
+
+  JUST_ASSERT(!s.has_translation_unit());
+}
+
+JUST_TEST_CASE(test_session_keeps_translation_unit_after_evaluation)
+{
+  in_memory_environment env("foo", test_config());
+  env.append(wrap_definition);
+  evaluation_session s;
+
+  const result r = eval(env, "int", s);
+
+  JUST_ASSERT_EQUAL("int", r.output);
+  JUST_ASSERT(s.has_translation_unit());
+}
+
+JUST_TEST_CASE(test_session_evaluates_different_expressions)
+{
+  in_memory_environment env("foo", test_config());
+  env.append(wrap_definition);
+  evaluation_session s;
+
+  const result r1 = eval(env, "int", s);
+  const result r2 = eval(env, "double", s);
+
+  JUST_ASSERT_EQUAL("int", r1.output);
+  JUST_ASSERT_EQUAL("double", r2.output);
+}
+
+JUST_TEST_CASE(test_session_notices_environment_change)
+{
+  in_memory_environment env("foo", test_config());
+  env.append(wrap_definition);
+  evaluation_session s;
+
+  const result r1 = eval(env, "x", s);
+  env.append("typedef int x;");
+  const result r2 = eval(env, "x", s);
+
+  JUST_ASSERT(r1.has_errors());
+  JUST_ASSERT(!r2.has_errors());
+  JUST_ASSERT_EQUAL("int", r2.output);
+}
+
+JUST_TEST_CASE(test_session_notices_clang_argument_change)
+{
+  in_memory_environment env("foo", test_config());
+  env.append(wrap_definition);
+  evaluation_session s;
+
+  const result r1 = eval(env, "FOO", s);
+  env.add_clang_arg("-DFOO=int");
+  const result r2 = eval(env, "FOO", s);
+
+  JUST_ASSERT(r1.has_errors());
+  JUST_ASSERT(!r2.has_errors());
+  JUST_ASSERT_EQUAL("int", r2.output);
+}
+
+JUST_TEST_CASE(test_reset_session_drops_translation_unit)
+{
+  in_memory_environment env("foo", test_config());
+  env.append(wrap_definition);
+  evaluation_session s;
+
+  eval(env, "int", s);
+  s.reset();
+
+  JUST_ASSERT(!s.has_translation_unit());
+}
+
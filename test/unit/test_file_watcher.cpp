@@ -0,0 +1,88 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/file_watcher.hpp>
+
+#include <just/test.hpp>
+#include <just/temp.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <string>
+
+using namespace metashell;
+
+#ifdef __linux__
+
+namespace
+{
+  void write_file(const std::string& path_, const std::string& content_)
+  {
+    std::ofstream f(path_.c_str());
+    f << content_;
+  }
+}
+
+JUST_TEST_CASE(test_file_watcher_notices_changes)
+{
+  just::temp::directory d;
+  const std::string header = d.path() + "/foo.hpp";
+  write_file(header, "typedef int x;");
+
+  file_watcher w(nullptr);
+  w.watch({header});
+
+  JUST_ASSERT(!w.changed());
+
+  write_file(header, "typedef double x;");
+
+  JUST_ASSERT(w.changed());
+  JUST_ASSERT(!w.changed());
+}
+
+JUST_TEST_CASE(test_file_watcher_calls_the_callback_in_the_background)
+{
+  just::temp::directory d;
+  const std::string header = d.path() + "/foo.hpp";
+  write_file(header, "typedef int x;");
+
+  std::mutex m;
+  std::condition_variable cv;
+  bool called = false;
+  file_watcher
+    w(
+      nullptr,
+      [&m, &cv, &called]
+      {
+        const std::lock_guard<std::mutex> lock(m);
+        called = true;
+        cv.notify_one();
+      }
+    );
+  w.watch({header});
+
+  write_file(header, "typedef double x;");
+
+  std::unique_lock<std::mutex> lock(m);
+  JUST_ASSERT(
+    cv.wait_for(lock, std::chrono::seconds(10), [&called] { return called; })
+  );
+  JUST_ASSERT(w.changed());
+}
+
+#endif
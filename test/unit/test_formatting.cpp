@@ -18,6 +18,7 @@
 #include "test_config.hpp"
 
 #include <metashell/shell.hpp>
+#include <metashell/metashell.hpp>
 #include <metashell/path_builder.hpp>
 #include <metashell/in_memory_displayer.hpp>
 
@@ -111,3 +112,53 @@ JUST_TEST_CASE(test_nested_mpl_vector_formatting)
   );
 }
 
+
+JUST_TEST_CASE(test_errors_of_unformatted_evaluation_are_displayed_once)
+{
+  in_memory_displayer d;
+  shell sh(test_config());
+  sh.line_available("hello", d);
+
+  const result r =
+    eval_tmp_unformatted(
+      sh.env(),
+      "hello",
+      test_config(),
+      shell::input_filename(),
+      nullptr
+    );
+
+  JUST_ASSERT_EMPTY_CONTAINER(d.types());
+  JUST_ASSERT_EQUAL_CONTAINER(r.errors, d.errors());
+}
+
+JUST_TEST_CASE(test_errors_of_formatter_are_displayed)
+{
+  in_memory_displayer d;
+  shell sh(test_config());
+  sh.line_available("struct foo_tag {};", d);
+  sh.line_available("struct foo { typedef foo_tag tag; };", d);
+  sh.line_available(
+    "namespace metashell"
+    "{"
+      "template <>"
+      "struct format_impl<foo_tag>"
+      "{"
+        "typedef format_impl type;"
+
+        "template <class T>"
+        "struct apply"
+        "{"
+          "typedef typename T::nonexisting_type type;"
+        "};"
+      "};"
+    "}",
+    d
+  );
+  JUST_ASSERT_EMPTY_CONTAINER(d.errors());
+
+  sh.line_available("foo", d);
+
+  JUST_ASSERT_EMPTY_CONTAINER(d.types());
+  JUST_ASSERT(!d.errors().empty());
+}
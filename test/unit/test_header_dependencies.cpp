@@ -0,0 +1,94 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/header_dependencies.hpp>
+
+#include <just/test.hpp>
+#include <just/temp.hpp>
+
+#include <cstdio>
+#include <fstream>
+
+using namespace metashell;
+
+namespace
+{
+  void write_file(const std::string& path_, const std::string& content_)
+  {
+    std::ofstream f(path_.c_str());
+    f << content_;
+  }
+}
+
+JUST_TEST_CASE(test_unchanged_header_is_not_reported_as_changed)
+{
+  just::temp::directory d;
+  const std::string fn = d.path() + "/foo.hpp";
+  write_file(fn, "typedef int x;");
+
+  header_dependencies deps;
+  deps.add(fn);
+
+  JUST_ASSERT(!deps.changed());
+}
+
+JUST_TEST_CASE(test_header_with_new_content_is_reported_as_changed)
+{
+  just::temp::directory d;
+  const std::string fn = d.path() + "/foo.hpp";
+  write_file(fn, "typedef int x;");
+
+  header_dependencies deps;
+  deps.add(fn);
+  // Same size and (most likely) same modification time
+  write_file(fn, "typedef int y;");
+
+  JUST_ASSERT(deps.changed());
+}
+
+JUST_TEST_CASE(test_deleted_header_is_reported_as_changed)
+{
+  just::temp::directory d;
+  const std::string fn = d.path() + "/foo.hpp";
+  write_file(fn, "typedef int x;");
+
+  header_dependencies deps;
+  deps.add(fn);
+  std::remove(fn.c_str());
+
+  JUST_ASSERT(deps.changed());
+}
+
+JUST_TEST_CASE(test_digest_of_header_dependencies_depends_on_content)
+{
+  just::temp::directory d;
+  const std::string fn = d.path() + "/foo.hpp";
+
+  write_file(fn, "typedef int x;");
+  header_dependencies deps1;
+  deps1.add(fn);
+  header_dependencies deps2;
+  deps2.add(fn);
+
+  write_file(fn, "typedef int y;");
+  header_dependencies deps3;
+  deps3.add(fn);
+
+  JUST_ASSERT_EQUAL(deps1.digest(), deps2.digest());
+  JUST_ASSERT_NOT_EQUAL(deps1.digest(), deps3.digest());
+  JUST_ASSERT_EQUAL(1u, deps1.paths().size());
+}
+
@@ -19,6 +19,7 @@
 #include <metashell/null_json_writer.hpp>
 #include <metashell/in_memory_displayer.hpp>
 #include <metashell/command_processor_queue.hpp>
+#include <metashell/null_history.hpp>
 
 #include "mock_json_writer.hpp"
 #include "mock_command_processor.hpp"
@@ -218,6 +219,69 @@ JUST_TEST_CASE(test_code_completion_without_code)
   JUST_ASSERT_EQUAL("int", *l);
 }
 
+JUST_TEST_CASE(test_cmd_batch_command_without_cmds_field)
+{
+  null_json_writer jw;
+  in_memory_displayer d;
+  command_processor_queue cpq;
+  const line_reader r =
+    build_json_line_reader(
+      string_reader{
+        "{\"type\":\"cmd_batch\"}",
+        "{\"type\":\"cmd\",\"cmd\":\"int\"}"
+      },
+      d,
+      jw,
+      cpq
+    );
+
+  const boost::optional<std::string> l = r(">");
+
+  // generates an error
+  JUST_ASSERT_EQUAL_CONTAINER(
+    {"The cmds field of the cmd_batch command is missing"},
+    d.errors()
+  );
+
+  // skipped
+  JUST_ASSERT(boost::none != l);
+  JUST_ASSERT_EQUAL("int", *l);
+}
+
+JUST_TEST_CASE(test_json_line_reader_cmd_batch_passes_the_commands)
+{
+  null_json_writer jw;
+  null_displayer d;
+  null_history h;
+
+  std::vector<std::string> lines;
+
+  mock_command_processor* cp = new mock_command_processor;
+  cp->line_available_callback =
+    [&lines](const std::string& cmd_) { lines.push_back(cmd_); };
+
+  command_processor_queue cpq;
+  cpq.history(h);
+  cpq.push(std::unique_ptr<iface::command_processor>(cp));
+
+  const line_reader r =
+    build_json_line_reader(
+      string_reader{
+        "{\"type\":\"cmd_batch\",\"cmds\":[\"int\",\"char\"]}",
+        "{\"type\":\"cmd\",\"cmd\":\"double\"}"
+      },
+      d,
+      jw,
+      cpq
+    );
+
+  const boost::optional<std::string> l = r(">");
+
+  JUST_ASSERT_EQUAL_CONTAINER({"int", "char"}, lines);
+  JUST_ASSERT(boost::none != l);
+  JUST_ASSERT_EQUAL("double", *l);
+}
+
 JUST_TEST_CASE(test_json_line_reader_code_completion_gets_code_completion)
 {
   null_json_writer jw;
@@ -15,9 +15,14 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <metashell/metaprogram.hpp>
+#include <metashell/metaprogram_builder.hpp>
 
 #include <just/test.hpp>
 
+#include <functional>
+#include <string>
+#include <vector>
+
 using namespace metashell;
 
 template<class T>
@@ -57,7 +62,7 @@ JUST_TEST_CASE(test_metaprogram_constructor) {
   JUST_ASSERT_EQUAL(mp.get_num_edges(), 0u);
 
   JUST_ASSERT_EQUAL(
-      mp.get_vertex_property(mp.get_root_vertex()).name,
+      mp.get_vertex_name(mp.get_root_vertex()),
       "some_type");
 
   assert_state_equal(mp.get_state(),
@@ -93,7 +98,7 @@ JUST_TEST_CASE(test_metaprogram_with_single_non_root_vertex) {
   JUST_ASSERT_EQUAL(mp.get_num_vertices(), 2u);
   JUST_ASSERT_EQUAL(mp.get_num_edges(), 1u);
 
-  JUST_ASSERT_EQUAL(mp.get_vertex_property(vertex_a).name, "A");
+  JUST_ASSERT_EQUAL(mp.get_vertex_name(vertex_a), "A");
   JUST_ASSERT_EQUAL(mp.get_edge_property(edge_root_a).kind,
       instantiation_kind::template_instantiation);
   JUST_ASSERT_EQUAL(mp.get_edge_property(edge_root_a).point_of_instantiation,
@@ -145,7 +150,7 @@ JUST_TEST_CASE(test_metaprogram_with_single_non_root_vertex_parallel_edge) {
   JUST_ASSERT_EQUAL(mp.get_num_vertices(), 2u);
   JUST_ASSERT_EQUAL(mp.get_num_edges(), 2u);
 
-  JUST_ASSERT_EQUAL(mp.get_vertex_property(vertex_a).name, "A");
+  JUST_ASSERT_EQUAL(mp.get_vertex_name(vertex_a), "A");
   JUST_ASSERT_EQUAL(mp.get_edge_property(edge_root_a_ti).kind,
       instantiation_kind::template_instantiation);
   JUST_ASSERT_EQUAL(mp.get_edge_property(edge_root_a_ti).point_of_instantiation,
@@ -205,7 +210,7 @@ JUST_TEST_CASE(test_metaprogram_step_back_with_single_non_root_vertex) {
   JUST_ASSERT_EQUAL(mp.get_num_vertices(), 2u);
   JUST_ASSERT_EQUAL(mp.get_num_edges(), 1u);
 
-  JUST_ASSERT_EQUAL(mp.get_vertex_property(vertex_a).name, "A");
+  JUST_ASSERT_EQUAL(mp.get_vertex_name(vertex_a), "A");
   JUST_ASSERT_EQUAL(mp.get_edge_property(edge_root_a).kind,
       instantiation_kind::template_instantiation);
   JUST_ASSERT_EQUAL(mp.get_edge_property(edge_root_a).point_of_instantiation,
@@ -256,7 +261,7 @@ JUST_TEST_CASE(
   JUST_ASSERT_EQUAL(mp.get_num_vertices(), 2u);
   JUST_ASSERT_EQUAL(mp.get_num_edges(), 2u);
 
-  JUST_ASSERT_EQUAL(mp.get_vertex_property(vertex_a).name, "A");
+  JUST_ASSERT_EQUAL(mp.get_vertex_name(vertex_a), "A");
   JUST_ASSERT_EQUAL(mp.get_edge_property(edge_root_a_ti).kind,
       instantiation_kind::template_instantiation);
   JUST_ASSERT_EQUAL(mp.get_edge_property(edge_root_a_ti).point_of_instantiation,
@@ -346,3 +351,194 @@ JUST_TEST_CASE(test_metaprogram_constructor_full_mode_false) {
 
   JUST_ASSERT(!mp.is_in_full_mode());
 }
+
+namespace {
+
+typedef std::function<void (metaprogram_builder&)> event_t;
+
+event_t template_begin(const std::string& name) {
+  return [name](metaprogram_builder& builder) {
+    builder.handle_template_begin(
+        instantiation_kind::template_instantiation,
+        name,
+        file_location("foo.cpp", 10, 20),
+        0.0,
+        0);
+  };
+}
+
+event_t template_end() {
+  return [](metaprogram_builder& builder) {
+    builder.handle_template_end(
+        instantiation_kind::template_instantiation, 0.0, 0);
+  };
+}
+
+// Processes the next event every time the metaprogram waits for one
+class step_by_step_loader : public metaprogram::loader {
+public:
+  step_by_step_loader(metaprogram& mp, const std::vector<event_t>& events) :
+    mp(mp),
+    builder(mp),
+    events(events),
+    processed_events(0)
+  {}
+
+  virtual bool is_open(metaprogram::vertex_descriptor vertex) const override {
+    return
+      processed_events < events.size() &&
+      (vertex == mp.get_root_vertex() || builder.is_open(vertex));
+  }
+
+  virtual bool wait_for_more_events() override {
+    if (processed_events == events.size()) {
+      return false;
+    }
+    events[processed_events++](builder);
+    return true;
+  }
+
+  std::size_t get_processed_events() const {
+    return processed_events;
+  }
+
+private:
+  metaprogram& mp;
+  metaprogram_builder builder;
+  std::vector<event_t> events;
+  std::size_t processed_events;
+};
+
+boost::string_ref current_name(const metaprogram& mp) {
+  return mp.get_vertex_name(mp.get_current_vertex());
+}
+
+}
+
+JUST_TEST_CASE(test_metaprogram_step_while_loading) {
+  metaprogram mp(false, "some_type", type("the_result_type"));
+  step_by_step_loader loader(
+      mp,
+      {
+        template_begin("A"),
+        template_begin("B"),
+        template_end(),
+        template_end(),
+        template_begin("C"),
+        template_end()
+      });
+  mp.set_loader(&loader);
+
+  mp.step();
+  JUST_ASSERT_EQUAL(current_name(mp), "A");
+  JUST_ASSERT_EQUAL(loader.get_processed_events(), 1u);
+
+  mp.step();
+  JUST_ASSERT_EQUAL(current_name(mp), "B");
+  JUST_ASSERT_EQUAL(loader.get_processed_events(), 2u);
+  JUST_ASSERT_EQUAL(mp.get_backtrace_length(), 2u);
+
+  mp.step();
+  JUST_ASSERT_EQUAL(current_name(mp), "C");
+  JUST_ASSERT_EQUAL(loader.get_processed_events(), 5u);
+  JUST_ASSERT_EQUAL(mp.get_backtrace_length(), 1u);
+
+  mp.step();
+  JUST_ASSERT(mp.is_finished());
+  JUST_ASSERT_EQUAL(loader.get_processed_events(), 6u);
+}
+
+JUST_TEST_CASE(test_metaprogram_step_back_while_loading) {
+  metaprogram mp(false, "some_type", type("the_result_type"));
+  step_by_step_loader loader(
+      mp,
+      {
+        template_begin("A"),
+        template_begin("B"),
+        template_end(),
+        template_begin("C"),
+        template_end(),
+        template_end()
+      });
+  mp.set_loader(&loader);
+
+  mp.step();
+  mp.step();
+  JUST_ASSERT_EQUAL(current_name(mp), "B");
+
+  mp.step_back();
+  JUST_ASSERT_EQUAL(current_name(mp), "A");
+
+  mp.step();
+  JUST_ASSERT_EQUAL(current_name(mp), "B");
+  JUST_ASSERT_EQUAL(loader.get_processed_events(), 2u);
+
+  mp.step();
+  JUST_ASSERT_EQUAL(current_name(mp), "C");
+  JUST_ASSERT_EQUAL(mp.get_backtrace_length(), 2u);
+
+  while (!mp.is_at_start()) {
+    mp.step_back();
+  }
+  assert_state_equal(mp.get_state(),
+        {false, false, false, false},
+        {boost::none, boost::none, boost::none, boost::none},
+        {boost::none}
+    );
+  JUST_ASSERT(mp.get_state().continuations.empty());
+
+  // The whole trace is loaded by now
+  std::vector<std::string> visited;
+  while (!mp.is_finished()) {
+    mp.step();
+    if (!mp.is_finished()) {
+      visited.push_back(current_name(mp).to_string());
+    }
+  }
+  JUST_ASSERT_EQUAL(loader.get_processed_events(), 6u);
+  JUST_ASSERT_EQUAL_CONTAINER(visited, {"A", "B", "C"});
+}
+
+JUST_TEST_CASE(test_metaprogram_wait_until_vertex_is_loaded) {
+  metaprogram mp(false, "some_type", type("the_result_type"));
+  step_by_step_loader loader(
+      mp,
+      {
+        template_begin("A"),
+        template_begin("B"),
+        template_end(),
+        template_end(),
+        template_begin("C"),
+        template_end()
+      });
+  mp.set_loader(&loader);
+
+  mp.step();
+  mp.wait_until_loaded(mp.get_current_vertex());
+  JUST_ASSERT_EQUAL(loader.get_processed_events(), 4u);
+
+  mp.wait_until_loaded(mp.get_root_vertex());
+  JUST_ASSERT_EQUAL(loader.get_processed_events(), 6u);
+}
+
+JUST_TEST_CASE(test_metaprogram_builder_reuses_renamed_vertex) {
+  metaprogram mp(false, "some_type", type("the_result_type"));
+  metaprogram_builder builder(
+      mp,
+      [&mp](metaprogram::edge_descriptor edge) {
+        mp.set_vertex_name(mp.get_target(edge), "B");
+      });
+
+  template_begin("A")(builder);
+  template_end()(builder);
+  template_begin("A")(builder);
+  template_end()(builder);
+  template_begin("B")(builder);
+  template_end()(builder);
+  builder.finish();
+
+  JUST_ASSERT_EQUAL(mp.get_num_vertices(), 3u);
+  JUST_ASSERT_EQUAL(mp.get_num_edges(), 3u);
+  JUST_ASSERT_EQUAL(mp.get_vertex_name(1), "B");
+  JUST_ASSERT_EQUAL(mp.get_vertex_name(2), "B");
+}
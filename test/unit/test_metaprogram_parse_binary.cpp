@@ -0,0 +1,279 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/exception.hpp>
+#include <metashell/metaprogram.hpp>
+
+#include <boost/graph/lookup_edge.hpp>
+
+#include <just/test.hpp>
+#include <just/temp.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace metashell;
+
+namespace
+{
+  // Builds traces in the format written by templight
+  class binary_trace
+  {
+  public:
+    binary_trace() : _records(), _event_count(0) {}
+
+    binary_trace& begin(
+      int kind_,
+      std::uint32_t name_,
+      std::uint32_t file_,
+      int line_,
+      int column_
+    )
+    {
+      return event(true, kind_, name_, file_, line_, column_);
+    }
+
+    binary_trace& end(int kind_)
+    {
+      return event(false, kind_, 0xffffffff, 0xffffffff, 0, 0);
+    }
+
+    binary_trace& string(const std::string& s_)
+    {
+      write(_records, 2, 4);
+      write(_records, s_.size(), 4);
+      _records += s_;
+      return *this;
+    }
+
+    std::string get() const
+    {
+      std::string result("TMPLBIN\0", 8);
+      write(result, 2, 4);
+      result += _records;
+      write(result, 3, 4);
+      write(result, _event_count, 4);
+      return result;
+    }
+  private:
+    std::string _records;
+    int _event_count;
+
+    static void write(std::string& out_, std::uint64_t value_, int bytes_)
+    {
+      for (int i = 0; i != bytes_; ++i)
+      {
+        out_ += char((value_ >> (8 * i)) & 0xff);
+      }
+    }
+
+    binary_trace& event(
+      bool begin_,
+      int kind_,
+      std::uint32_t name_,
+      std::uint32_t file_,
+      int line_,
+      int column_
+    )
+    {
+      const double timestamp = 1.0;
+      std::uint64_t timestamp_bits;
+      std::memcpy(&timestamp_bits, &timestamp, sizeof(timestamp_bits));
+
+      write(_records, begin_ ? 1 : 0, 1);
+      write(_records, kind_, 1);
+      write(_records, 0, 2);
+      write(_records, name_, 4);
+      write(_records, file_, 4);
+      write(_records, line_, 4);
+      write(_records, column_, 4);
+      write(_records, 0, 4);
+      write(_records, timestamp_bits, 8);
+      write(_records, 0, 8);
+      ++_event_count;
+      return *this;
+    }
+  };
+
+  metaprogram parse(const std::string& trace_)
+  {
+    return
+      metaprogram::create_from_binary_string(
+        trace_,
+        true,
+        "some_type",
+        type("the_result_type")
+      );
+  }
+}
+
+JUST_TEST_CASE(test_templight_binary_parse_empty)
+{
+  const metaprogram mp = parse(binary_trace().get());
+
+  JUST_ASSERT_EQUAL(mp.get_evaluation_result(), type("the_result_type"));
+  JUST_ASSERT_EQUAL(mp.get_num_vertices(), 1u);
+  JUST_ASSERT_EQUAL(mp.get_num_edges(), 0u);
+}
+
+JUST_TEST_CASE(test_templight_binary_parse_two_nested_node)
+{
+  const metaprogram mp =
+    parse(
+      binary_trace()
+        .string("metashell::foo")
+        .string("foo.hpp")
+        .begin(0, 0, 1, 10, 20)
+        .string("metashell::bar")
+        .begin(8, 2, 1, 20, 30)
+        .end(8)
+        .end(0)
+        .get()
+    );
+
+  JUST_ASSERT_EQUAL(mp.get_num_vertices(), 3u);
+  JUST_ASSERT_EQUAL(mp.get_num_edges(), 2u);
+  JUST_ASSERT_EQUAL(mp.get_vertex_name(1), "metashell::foo");
+  JUST_ASSERT_EQUAL(mp.get_vertex_name(2), "metashell::bar");
+
+  metaprogram::edge_descriptor edge;
+  bool found;
+  std::tie(edge, found) = boost::lookup_edge(1, 2, mp.get_graph());
+
+  JUST_ASSERT(found);
+  JUST_ASSERT_EQUAL(
+    mp.get_edge_property(edge).kind,
+    instantiation_kind::memoization
+  );
+  JUST_ASSERT_EQUAL(
+    mp.get_edge_property(edge).point_of_instantiation,
+    file_location("foo.hpp", 20, 30)
+  );
+}
+
+JUST_TEST_CASE(test_templight_binary_parse_invalid_magic)
+{
+  std::string trace = binary_trace().get();
+  trace[0] = 'X';
+
+  JUST_ASSERT_THROWS(exception, parse(trace));
+}
+
+JUST_TEST_CASE(test_templight_binary_parse_truncated)
+{
+  const std::string trace =
+    binary_trace().string("foo").begin(0, 0, 0, 1, 1).end(0).get();
+
+  JUST_ASSERT_THROWS(exception, parse(trace.substr(0, trace.size() - 1)));
+}
+
+JUST_TEST_CASE(test_templight_binary_parse_invalid_string_index)
+{
+  JUST_ASSERT_THROWS(
+    exception,
+    parse(binary_trace().string("foo").begin(0, 1, 0, 1, 1).end(0).get())
+  );
+}
+
+JUST_TEST_CASE(test_templight_binary_parse_invalid_kind)
+{
+  JUST_ASSERT_THROWS(
+    exception,
+    parse(binary_trace().string("foo").begin(9, 0, 0, 1, 1).end(9).get())
+  );
+}
+
+JUST_TEST_CASE(test_templight_binary_parse_without_template_end)
+{
+  JUST_ASSERT_THROWS(
+    exception,
+    parse(binary_trace().string("foo").begin(0, 0, 0, 1, 1).get())
+  );
+}
+
+JUST_TEST_CASE(test_templight_binary_parse_from_file)
+{
+  just::temp::directory d;
+  const std::string binary = d.path() + "/trace.bin";
+  const std::string xml = d.path() + "/trace.xml";
+  {
+    std::ofstream f(binary.c_str(), std::ios::binary);
+    f << binary_trace().string("foo").begin(0, 0, 0, 1, 1).end(0).get();
+  }
+  {
+    std::ofstream f(xml.c_str());
+    f << "<?xml version=\"1.0\" standalone=\"yes\"?>\n<Trace>\n</Trace>\n";
+  }
+
+  JUST_ASSERT(metaprogram::is_binary_trace_file(binary));
+  JUST_ASSERT(!metaprogram::is_binary_trace_file(xml));
+  JUST_ASSERT(!metaprogram::is_binary_trace_file(d.path() + "/missing"));
+
+  const metaprogram mp =
+    metaprogram::create_from_binary_file(
+      binary,
+      false,
+      "some_type",
+      type("the_result_type")
+    );
+  JUST_ASSERT_EQUAL(mp.get_num_vertices(), 2u);
+}
+
+JUST_TEST_CASE(test_templight_binary_parse_string_used_before_written)
+{
+  JUST_ASSERT_THROWS(
+    exception,
+    parse(binary_trace().begin(0, 0, 0, 1, 1).string("foo").end(0).get())
+  );
+}
+
+JUST_TEST_CASE(test_templight_binary_parse_invalid_event_count)
+{
+  std::string trace =
+    binary_trace().string("foo").begin(0, 0, 0, 1, 1).end(0).get();
+  trace[trace.size() - 4] = 3;
+
+  JUST_ASSERT_THROWS(exception, parse(trace));
+}
+
+JUST_TEST_CASE(test_templight_binary_parse_from_stream)
+{
+  std::istringstream s(
+    binary_trace().string("foo").begin(0, 0, 0, 1, 1).end(0).get()
+  );
+
+  const metaprogram mp =
+    metaprogram::create_from_binary_stream(
+      s,
+      false,
+      "some_type",
+      type("the_result_type")
+    );
+
+  JUST_ASSERT_EQUAL(mp.get_num_vertices(), 2u);
+  JUST_ASSERT_EQUAL(mp.get_vertex_name(1), "foo");
+}
+
+JUST_TEST_CASE(test_templight_binary_parse_is_binary_trace)
+{
+  JUST_ASSERT(metaprogram::is_binary_trace(binary_trace().get()));
+  JUST_ASSERT(!metaprogram::is_binary_trace("<?xml version=\"1.0\"?>"));
+  JUST_ASSERT(!metaprogram::is_binary_trace("TMPL"));
+}
@@ -53,8 +53,8 @@ void test_single_node_templight_parsing(
   JUST_ASSERT_EQUAL(mp.get_evaluation_result(), type("the_result_type"));
   JUST_ASSERT_EQUAL(mp.get_num_vertices(), 2u);
   JUST_ASSERT_EQUAL(mp.get_num_edges(), 1u);
-  JUST_ASSERT_EQUAL(mp.get_vertex_property(0).name, "some_type");
-  JUST_ASSERT_EQUAL(mp.get_vertex_property(1).name, actual_type);
+  JUST_ASSERT_EQUAL(mp.get_vertex_name(0), "some_type");
+  JUST_ASSERT_EQUAL(mp.get_vertex_name(1), actual_type);
 
   metaprogram::edge_descriptor edge;
   bool found;
@@ -77,7 +77,7 @@ JUST_TEST_CASE(test_templight_xml_parse_empty)
   JUST_ASSERT_EQUAL(mp.get_evaluation_result(), type("the_result_type"));
   JUST_ASSERT_EQUAL(mp.get_num_vertices(), 1u);
   JUST_ASSERT_EQUAL(mp.get_num_edges(), 0u);
-  JUST_ASSERT_EQUAL(mp.get_vertex_property(0).name, "some_type");
+  JUST_ASSERT_EQUAL(mp.get_vertex_name(0), "some_type");
 }
 
 JUST_TEST_CASE(test_templight_xml_parse_one_node_with_different_kinds)
@@ -186,9 +186,9 @@ JUST_TEST_CASE(test_templight_xml_parse_two_nested_node)
   JUST_ASSERT_EQUAL(mp.get_evaluation_result(), type("the_result_type"));
   JUST_ASSERT_EQUAL(mp.get_num_vertices(), 3u);
   JUST_ASSERT_EQUAL(mp.get_num_edges(), 2u);
-  JUST_ASSERT_EQUAL(mp.get_vertex_property(0).name, "some_type");
-  JUST_ASSERT_EQUAL(mp.get_vertex_property(1).name, "metashell::foo");
-  JUST_ASSERT_EQUAL(mp.get_vertex_property(2).name, "metashell::bar");
+  JUST_ASSERT_EQUAL(mp.get_vertex_name(0), "some_type");
+  JUST_ASSERT_EQUAL(mp.get_vertex_name(1), "metashell::foo");
+  JUST_ASSERT_EQUAL(mp.get_vertex_name(2), "metashell::bar");
 
   metaprogram::edge_descriptor edge;
   bool found;
@@ -242,9 +242,9 @@ JUST_TEST_CASE(test_templight_xml_parse_two_sequential_node)
   JUST_ASSERT_EQUAL(mp.get_evaluation_result(), type("the_result_type"));
   JUST_ASSERT_EQUAL(mp.get_num_vertices(), 3u);
   JUST_ASSERT_EQUAL(mp.get_num_edges(), 2u);
-  JUST_ASSERT_EQUAL(mp.get_vertex_property(0).name, "some_type");
-  JUST_ASSERT_EQUAL(mp.get_vertex_property(1).name, "metashell::foo");
-  JUST_ASSERT_EQUAL(mp.get_vertex_property(2).name, "metashell::bar");
+  JUST_ASSERT_EQUAL(mp.get_vertex_name(0), "some_type");
+  JUST_ASSERT_EQUAL(mp.get_vertex_name(1), "metashell::foo");
+  JUST_ASSERT_EQUAL(mp.get_vertex_name(2), "metashell::bar");
 
   metaprogram::edge_descriptor edge;
   bool found;
@@ -382,3 +382,42 @@ JUST_TEST_CASE(test_templight_xml_parse_syntax_error_unknown_kind)
     metaprogram::create_from_xml_string(
         xml, false, "some_type", type("the_result_type")));
 }
+
+JUST_TEST_CASE(test_templight_xml_parse_escaped_context)
+{
+  test_single_node_templight_parsing(
+      "metashell::foo&lt;int, &apos;&amp;&apos;&gt;",
+      "metashell::foo<int, '&'>",
+      "TemplateInstantiation",
+       instantiation_kind::template_instantiation);
+}
+
+JUST_TEST_CASE(test_templight_xml_parse_syntax_error_missing_trace)
+{
+  const std::string xml =
+  "<?xml version=\"1.0\" standalone=\"yes\"?>\n"
+  "<Foo>\n"
+  "</Foo>\n";
+
+  JUST_ASSERT_THROWS(exception,
+    metaprogram::create_from_xml_string(
+        xml, false, "some_type", type("the_result_type")));
+}
+
+JUST_TEST_CASE(test_templight_xml_parse_syntax_error_missing_field)
+{
+  const std::string xml =
+  "<?xml version=\"1.0\" standalone=\"yes\"?>\n"
+  "<Trace>\n"
+  "<TemplateBegin>\n"
+  "<Kind>TemplateInstantiation</Kind>\n"
+  "<PointOfInstantiation>bar.hpp|20|30</PointOfInstantiation>\n"
+  "<TimeStamp time = \"60.0\"/>\n"
+  "<MemoryUsage bytes = \"0\"/>\n"
+  "</TemplateBegin>\n"
+  "</Trace>\n";
+
+  JUST_ASSERT_THROWS(exception,
+    metaprogram::create_from_xml_string(
+        xml, false, "some_type", type("the_result_type")));
+}
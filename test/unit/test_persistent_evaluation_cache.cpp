@@ -0,0 +1,132 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/persistent_evaluation_cache.hpp>
+
+#include <just/test.hpp>
+#include <just/temp.hpp>
+
+#include <boost/filesystem.hpp>
+
+#include <ctime>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace metashell;
+
+namespace
+{
+  result result_with(
+    const std::string& output_,
+    const std::vector<std::string>& errors_ = std::vector<std::string>()
+  )
+  {
+    return result(output_, errors_.begin(), errors_.end(), "");
+  }
+
+  std::string write_temporary_file(
+    const just::temp::directory& d_,
+    const std::string& name_,
+    std::time_t age_
+  )
+  {
+    const std::string path = d_.path() + "/" + name_ + ".tmp";
+    {
+      std::ofstream f(path.c_str());
+      f << "partially written result";
+    }
+    boost::filesystem::last_write_time(path, std::time(nullptr) - age_);
+    return path;
+  }
+}
+
+JUST_TEST_CASE(test_persistent_evaluation_cache_miss)
+{
+  just::temp::directory d;
+  persistent_evaluation_cache c(d.path(), 1024, nullptr);
+
+  JUST_ASSERT(!c.find("foo"));
+}
+
+JUST_TEST_CASE(test_persistent_evaluation_cache_is_shared_between_instances)
+{
+  just::temp::directory d;
+  persistent_evaluation_cache(d.path(), 1024, nullptr)
+    .store("foo", result_with("int"));
+
+  persistent_evaluation_cache c(d.path(), 1024, nullptr);
+  const boost::optional<result> r = c.find("foo");
+
+  JUST_ASSERT(bool(r));
+  JUST_ASSERT_EQUAL("int", r->output);
+  JUST_ASSERT(!r->has_errors());
+}
+
+JUST_TEST_CASE(test_errors_are_stored_in_persistent_evaluation_cache)
+{
+  just::temp::directory d;
+  persistent_evaluation_cache c(d.path(), 1024, nullptr);
+  c.store("foo", result_with("", {"first\nerror", ""}));
+
+  const boost::optional<result> r = c.find("foo");
+
+  JUST_ASSERT(bool(r));
+  JUST_ASSERT_EQUAL(2u, r->errors.size());
+  JUST_ASSERT_EQUAL("first\nerror", r->errors[0]);
+  JUST_ASSERT_EQUAL("", r->errors[1]);
+}
+
+JUST_TEST_CASE(test_persistent_evaluation_cache_size_is_limited)
+{
+  just::temp::directory d;
+  persistent_evaluation_cache c(d.path(), 1024, nullptr);
+  c.store("a", result_with(std::string(400, 'a')));
+  c.store("b", result_with(std::string(400, 'b')));
+  c.store("c", result_with(std::string(400, 'c')));
+
+  JUST_ASSERT(bool(c.find("c")));
+  JUST_ASSERT(!(c.find("a") && c.find("b")));
+}
+
+JUST_TEST_CASE(test_persistent_evaluation_cache_total_size_is_shared)
+{
+  just::temp::directory d;
+  persistent_evaluation_cache(d.path(), 1024, nullptr)
+    .store("a", result_with(std::string(400, 'a')));
+  persistent_evaluation_cache(d.path(), 1024, nullptr)
+    .store("b", result_with(std::string(400, 'b')));
+
+  persistent_evaluation_cache c(d.path(), 1024, nullptr);
+  c.store("c", result_with(std::string(400, 'c')));
+
+  JUST_ASSERT(bool(c.find("c")));
+  JUST_ASSERT(!(c.find("a") && c.find("b")));
+}
+
+JUST_TEST_CASE(test_persistent_evaluation_cache_removes_stale_temporary_files)
+{
+  just::temp::directory d;
+  const std::string stale = write_temporary_file(d, "stale", 24 * 60 * 60);
+  const std::string recent = write_temporary_file(d, "recent", 0);
+
+  persistent_evaluation_cache c(d.path(), 1024, nullptr);
+  c.store("foo", result_with("int"));
+
+  JUST_ASSERT(!boost::filesystem::exists(stale));
+  JUST_ASSERT(boost::filesystem::exists(recent));
+  JUST_ASSERT(bool(c.find("foo")));
+}
@@ -0,0 +1,57 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/in_memory_displayer.hpp>
+#include <metashell/shell.hpp>
+#include "argv0.hpp"
+
+#include <just/test.hpp>
+
+using namespace metashell;
+
+JUST_TEST_CASE(test_precompiled_headers_status_without_precompiled_headers)
+{
+  config cfg = empty_config(argv0::get());
+  cfg.use_precompiled_headers = false;
+
+  in_memory_displayer d;
+  shell sh(cfg);
+  sh.line_available("#msh precompiled_headers status", d);
+
+  JUST_ASSERT_EQUAL_CONTAINER(
+    {text("Precompiled headers are not used.")},
+    d.comments()
+  );
+}
+
+JUST_TEST_CASE(test_precompiled_headers_status_after_rebuild)
+{
+  config cfg = empty_config(argv0::get());
+  cfg.use_precompiled_headers = true;
+
+  in_memory_displayer d;
+  shell sh(cfg);
+  sh.env().update(true);
+  sh.line_available("#msh precompiled_headers status", d);
+
+  JUST_ASSERT_EQUAL(1u, d.comments().size());
+  JUST_ASSERT(
+    d.comments().front().paragraphs.front().content.find(
+      "The precompiled header is not being rebuilt. The last rebuild took"
+    ) == 0
+  );
+}
+
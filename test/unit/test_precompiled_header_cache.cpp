@@ -0,0 +1,139 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/precompiled_header_cache.hpp>
+
+#include <just/test.hpp>
+#include <just/temp.hpp>
+
+#include <boost/filesystem.hpp>
+
+#include <fstream>
+
+using namespace metashell;
+
+namespace
+{
+  void write_file(const std::string& path_, const std::string& content_)
+  {
+    std::ofstream f(path_.c_str());
+    f << content_;
+  }
+
+  // Pretends to precompile the header and counts how many times it was
+  // called
+  precompiled_header_cache::builder fake_builder(
+    const std::string& dependency_,
+    int& calls_
+  )
+  {
+    return
+      [&dependency_, &calls_](
+        const std::string& header_,
+        const std::string&,
+        const std::vector<std::string>&
+      )
+      {
+        ++calls_;
+        write_file(header_ + ".pch", "precompiled");
+        header_dependencies deps;
+        deps.add(dependency_);
+        return deps;
+      };
+  }
+}
+
+JUST_TEST_CASE(test_precompiled_header_is_reused_from_the_cache)
+{
+  just::temp::directory d;
+  const std::string dep = d.path() + "/foo.hpp";
+  write_file(dep, "typedef int x;");
+  int calls = 0;
+
+  precompiled_header_cache cache(d.path() + "/cache", 1024 * 1024, nullptr);
+  const precompiled_header_cache::entry e1 =
+    cache.get("#include <foo.hpp>", {"-I/a"}, "/a", fake_builder(dep, calls));
+  const precompiled_header_cache::entry e2 =
+    cache.get("#include <foo.hpp>", {"-I/b"}, "/b", fake_builder(dep, calls));
+
+  JUST_ASSERT_EQUAL(1, calls);
+  JUST_ASSERT_EQUAL(e1.header, e2.header);
+  JUST_ASSERT(boost::filesystem::exists(e1.header + ".pch"));
+  JUST_ASSERT(bool(e2.lock));
+}
+
+JUST_TEST_CASE(test_precompiled_header_is_rebuilt_when_a_dependency_changes)
+{
+  just::temp::directory d;
+  const std::string dep = d.path() + "/foo.hpp";
+  write_file(dep, "typedef int x;");
+  int calls = 0;
+
+  precompiled_header_cache cache(d.path() + "/cache", 1024 * 1024, nullptr);
+  const precompiled_header_cache::entry e1 =
+    cache.get("#include <foo.hpp>", {}, "/a", fake_builder(dep, calls));
+  write_file(dep, "typedef int y;");
+  const precompiled_header_cache::entry e2 =
+    cache.get("#include <foo.hpp>", {}, "/a", fake_builder(dep, calls));
+
+  JUST_ASSERT_EQUAL(2, calls);
+  JUST_ASSERT_NOT_EQUAL(e1.header, e2.header);
+}
+
+JUST_TEST_CASE(test_precompiled_headers_in_use_are_not_evicted)
+{
+  just::temp::directory d;
+  const std::string dep = d.path() + "/foo.hpp";
+  write_file(dep, "typedef int x;");
+  int calls = 0;
+
+  precompiled_header_cache cache(d.path() + "/cache", 1, nullptr);
+  precompiled_header_cache::entry e1 =
+    cache.get("typedef int a;", {}, "/a", fake_builder(dep, calls));
+  const std::string unused = e1.header;
+  e1.lock.reset();
+  const precompiled_header_cache::entry e2 =
+    cache.get("typedef int b;", {}, "/a", fake_builder(dep, calls));
+  const precompiled_header_cache::entry e3 =
+    cache.get("typedef int c;", {}, "/a", fake_builder(dep, calls));
+
+  JUST_ASSERT(!boost::filesystem::exists(unused + ".pch"));
+  JUST_ASSERT(boost::filesystem::exists(e2.header + ".pch"));
+  JUST_ASSERT(boost::filesystem::exists(e3.header + ".pch"));
+}
+
+
+JUST_TEST_CASE(test_finding_precompiled_header_in_the_cache)
+{
+  just::temp::directory d;
+  const std::string dep = d.path() + "/foo.hpp";
+  write_file(dep, "typedef int x;");
+  int calls = 0;
+
+  precompiled_header_cache cache(d.path() + "/cache", 1024 * 1024, nullptr);
+  JUST_ASSERT(!cache.find("#include <foo.hpp>", {"-I/a"}, "/a"));
+  JUST_ASSERT(!boost::filesystem::exists(d.path() + "/cache"));
+
+  const precompiled_header_cache::entry e =
+    cache.get("#include <foo.hpp>", {"-I/a"}, "/a", fake_builder(dep, calls));
+  const boost::optional<precompiled_header_cache::entry>
+    found = cache.find("#include <foo.hpp>", {"-I/b"}, "/b");
+
+  JUST_ASSERT(bool(found));
+  JUST_ASSERT_EQUAL(e.header, found->header);
+  JUST_ASSERT(!found->lock);
+  JUST_ASSERT(!cache.find("#include <foo.hpp>", {"-I/c"}, "/b"));
+}
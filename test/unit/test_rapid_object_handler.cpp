@@ -196,6 +196,44 @@ JUST_TEST_CASE(test_rapid_object_handler_whitelisted_fields)
   test_whitelisted_field("type");
   test_whitelisted_field("cmd");
   test_whitelisted_field("code");
+  test_whitelisted_field("cmds");
+}
+
+JUST_TEST_CASE(test_rapid_object_handler_array_of_strings)
+{
+  null_displayer d;
+  rapid_object_handler r(d);
+
+  JUST_ASSERT(r.StartObject());
+  JUST_ASSERT(r.Key("cmds", sizeof("cmds") - 1, true));
+  JUST_ASSERT(r.StartArray());
+  JUST_ASSERT(r.String("int", sizeof("int") - 1, true));
+  JUST_ASSERT(r.String("char", sizeof("char") - 1, true));
+  JUST_ASSERT(r.EndArray(2));
+  JUST_ASSERT(r.EndObject(1));
+
+  JUST_ASSERT(!r.failed());
+
+  const boost::optional<std::vector<std::string>> f = r.array_field("cmds");
+
+  JUST_ASSERT(f != boost::none);
+  JUST_ASSERT_EQUAL_CONTAINER({"int", "char"}, *f);
+  JUST_ASSERT(r.field("cmds") == boost::none);
+}
+
+JUST_TEST_CASE(test_rapid_object_handler_is_failed_after_nested_array)
+{
+  in_memory_displayer d;
+  rapid_object_handler r(d);
+
+  r.StartObject();
+  r.Key("cmds", sizeof("cmds") - 1, true);
+  r.StartArray();
+  const bool b = r.StartArray();
+
+  JUST_ASSERT(!b);
+  JUST_ASSERT(r.failed());
+  JUST_ASSERT_EQUAL_CONTAINER({"Unexpected array"}, d.errors());
 }
 
 JUST_TEST_CASE(test_new_rapid_object_handler_is_failed_after_nested_object)
@@ -0,0 +1,58 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/serialisation.hpp>
+
+#include <just/test.hpp>
+
+#include <sstream>
+
+using namespace metashell;
+
+JUST_TEST_CASE(test_strings_are_read_back_as_they_were_written)
+{
+  std::ostringstream out;
+  write_string(out, "foo\nbar");
+  write_string(out, "");
+  write_string(out, "12");
+
+  std::istringstream in(out.str());
+  std::string a, b, c;
+
+  JUST_ASSERT(read_string(in, a));
+  JUST_ASSERT(read_string(in, b));
+  JUST_ASSERT(read_string(in, c));
+  JUST_ASSERT_EQUAL("foo\nbar", a);
+  JUST_ASSERT_EQUAL("", b);
+  JUST_ASSERT_EQUAL("12", c);
+}
+
+JUST_TEST_CASE(test_reading_a_truncated_string_fails)
+{
+  std::istringstream in("5\nfoo");
+  std::string s;
+
+  JUST_ASSERT(!read_string(in, s));
+}
+
+JUST_TEST_CASE(test_reading_a_string_without_a_length_fails)
+{
+  std::istringstream in("foo");
+  std::string s;
+
+  JUST_ASSERT(!read_string(in, s));
+}
+
@@ -18,6 +18,7 @@
 #include "argv0.hpp"
 
 #include <metashell/shell.hpp>
+#include <metashell/header_file_environment.hpp>
 #include <metashell/path_builder.hpp>
 #include <metashell/in_memory_displayer.hpp>
 
@@ -83,6 +84,33 @@ JUST_TEST_CASE(test_env_two_level_environment_stack)
   JUST_ASSERT_EQUAL(old_env, sh.env().get_all());
 }
 
+JUST_TEST_CASE(test_env_pop_reuses_the_pushed_environment)
+{
+  metashell::in_memory_displayer d;
+  metashell::shell sh(metashell::test_config());
+
+  const metashell::environment* pushed = &sh.env();
+  sh.push_environment();
+  sh.store_in_buffer("typedef int x;", d);
+  sh.pop_environment();
+
+  JUST_ASSERT_EQUAL(pushed, &sh.env());
+}
+
+JUST_TEST_CASE(test_env_pop_after_reload_rebuilds_the_environment)
+{
+  metashell::in_memory_displayer d;
+  metashell::shell sh(metashell::test_config());
+
+  sh.push_environment();
+  const std::string old_env = sh.env().get_all();
+  sh.store_in_buffer("typedef int x;", d);
+  sh.rebuild_environment();
+  sh.pop_environment();
+
+  JUST_ASSERT_EQUAL(old_env, sh.env().get_all());
+}
+
 JUST_TEST_CASE(test_displaying_the_size_of_the_empty_environment_stack)
 {
   metashell::in_memory_displayer d;
@@ -230,3 +258,20 @@ JUST_TEST_CASE(test_restoring_after_environment_reset_from_environment_stack)
   JUST_ASSERT_EMPTY_CONTAINER(d.errors());
 }
 
+JUST_TEST_CASE(test_default_environment_is_precompiled_in_the_background)
+{
+  metashell::config cfg = metashell::test_config();
+  cfg.use_precompiled_headers = true;
+  metashell::in_memory_displayer d;
+  metashell::shell sh(cfg);
+
+  const metashell::header_file_environment& env =
+    dynamic_cast<const metashell::header_file_environment&>(sh.env());
+  JUST_ASSERT(env.rebuilding_precompiled_header());
+
+  sh.line_available("#msh environment reset", d);
+
+  const metashell::header_file_environment& reset_env =
+    dynamic_cast<const metashell::header_file_environment&>(sh.env());
+  JUST_ASSERT(reset_env.rebuilding_precompiled_header());
+}
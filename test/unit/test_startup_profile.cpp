@@ -0,0 +1,40 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/startup_profile.hpp>
+
+#include <just/test.hpp>
+
+#include <sstream>
+
+using namespace metashell;
+
+JUST_TEST_CASE(test_startup_profile_displays_the_phases_and_the_total)
+{
+  startup_profile p;
+  p.phase_finished("First phase");
+  p.phase_finished("Second phase");
+
+  std::ostringstream s;
+  p.display(s);
+
+  const std::string out = s.str();
+  JUST_ASSERT(out.find("First phase: ") != std::string::npos);
+  JUST_ASSERT(out.find("Second phase: ") != std::string::npos);
+  JUST_ASSERT(out.find("Total: ") != std::string::npos);
+  JUST_ASSERT(out.find("First phase") < out.find("Second phase"));
+}
+
@@ -0,0 +1,101 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/string_table.hpp>
+
+#include <just/test.hpp>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace metashell;
+
+JUST_TEST_CASE(test_string_table_same_string_gets_same_id)
+{
+  string_table t;
+
+  const string_table::id foo = t.intern("foo");
+  const string_table::id bar = t.intern("bar");
+
+  JUST_ASSERT(foo != bar);
+  JUST_ASSERT_EQUAL(t.intern(std::string("foo")), foo);
+  JUST_ASSERT_EQUAL(t.intern("bar"), bar);
+  JUST_ASSERT_EQUAL(t.size(), 2u);
+}
+
+JUST_TEST_CASE(test_string_table_get)
+{
+  string_table t;
+
+  const string_table::id empty = t.intern("");
+  const string_table::id foo = t.intern("foo");
+
+  JUST_ASSERT_EQUAL(t.get(empty), "");
+  JUST_ASSERT_EQUAL(t.get(foo), "foo");
+}
+
+JUST_TEST_CASE(test_string_table_strings_do_not_move)
+{
+  string_table t;
+
+  const std::string long_string(100000, 'x');
+  const string_table::id foo = t.intern("foo");
+  const string_table::id long_id = t.intern(long_string);
+  const char* foo_data = t.get(foo).data();
+
+  std::vector<string_table::id> ids;
+  for (int i = 0; i != 10000; ++i) {
+    ids.push_back(t.intern("foo<" + std::to_string(i) + ">"));
+  }
+
+  JUST_ASSERT_EQUAL(t.get(foo).data(), foo_data);
+  JUST_ASSERT_EQUAL(t.get(long_id), long_string);
+  for (int i = 0; i != 10000; ++i) {
+    const std::string s = "foo<" + std::to_string(i) + ">";
+    JUST_ASSERT_EQUAL(t.get(ids[i]), s);
+    JUST_ASSERT_EQUAL(t.intern(s), ids[i]);
+  }
+  JUST_ASSERT_EQUAL(t.size(), 10002u);
+}
+
+JUST_TEST_CASE(test_string_table_copy_keeps_ids)
+{
+  string_table t;
+  const string_table::id foo = t.intern("foo");
+  const string_table::id bar = t.intern("bar");
+
+  string_table copy(t);
+  t = string_table();
+
+  JUST_ASSERT_EQUAL(copy.get(foo), "foo");
+  JUST_ASSERT_EQUAL(copy.get(bar), "bar");
+  JUST_ASSERT_EQUAL(copy.intern("bar"), bar);
+  JUST_ASSERT_EQUAL(t.size(), 0u);
+}
+
+JUST_TEST_CASE(test_string_table_moved_from_table_is_empty)
+{
+  string_table t;
+  const string_table::id foo = t.intern("foo");
+
+  string_table moved(std::move(t));
+
+  JUST_ASSERT_EQUAL(moved.get(foo), "foo");
+  JUST_ASSERT_EQUAL(t.size(), 0u);
+  JUST_ASSERT_EQUAL(t.intern("bar"), 0u);
+}
+
@@ -0,0 +1,225 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/subprocess_evaluator.hpp>
+#include <metashell/exception.hpp>
+
+#include <just/test.hpp>
+
+#include <boost/lexical_cast.hpp>
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#  include <poll.h>
+#  include <unistd.h>
+#endif
+
+using namespace metashell;
+
+namespace
+{
+  result result_with_output(const std::string& output_)
+  {
+    const std::vector<std::string> no_errors;
+    return result(output_, no_errors.begin(), no_errors.end(), "");
+  }
+
+  result echo(const std::string& exp_)
+  {
+    return result_with_output(exp_);
+  }
+
+  subprocess_evaluator::evaluator_factory always(
+    const subprocess_evaluator::evaluator& f_
+  )
+  {
+    return [f_] (const std::string&) { return f_; };
+  }
+
+  std::string env()
+  {
+    return "env";
+  }
+
+#ifndef _WIN32
+  result pid_of_evaluator(const std::string&)
+  {
+    return result_with_output(boost::lexical_cast<std::string>(getpid()));
+  }
+
+  bool fails(subprocess_evaluator& e_)
+  {
+    const result r = e_.evaluate("int", "env", env);
+    return r.has_errors() && !e_.evaluated();
+  }
+#endif
+}
+
+JUST_TEST_CASE(test_subprocess_evaluator_returns_the_result)
+{
+  subprocess_evaluator e(always(echo), 0, 0, nullptr);
+
+  const result r = e.evaluate("int", "env", env);
+
+  JUST_ASSERT_EQUAL("int", r.output);
+  JUST_ASSERT(!r.has_errors());
+  JUST_ASSERT(e.evaluated());
+}
+
+JUST_TEST_CASE(test_subprocess_evaluator_passes_the_environment)
+{
+  subprocess_evaluator
+    e(
+      [] (const std::string& env_) -> subprocess_evaluator::evaluator
+      {
+        return
+          [env_] (const std::string& exp_)
+          {
+            return result_with_output(env_ + " " + exp_);
+          };
+      },
+      0,
+      0,
+      nullptr
+    );
+
+  JUST_ASSERT_EQUAL("env int", e.evaluate("int", "key", env).output);
+  JUST_ASSERT_EQUAL(
+    "env2 int",
+    e.evaluate("int", "key2", [] { return std::string("env2"); }).output
+  );
+}
+
+#ifndef _WIN32
+
+JUST_TEST_CASE(test_subprocess_evaluator_returns_exceptions_as_errors)
+{
+  subprocess_evaluator
+    e(
+      always([] (const std::string&) -> result { throw exception("foo"); }),
+      0,
+      0,
+      nullptr
+    );
+
+  const result r = e.evaluate("int", "env", env);
+
+  JUST_ASSERT_EQUAL(1u, r.errors.size());
+  JUST_ASSERT_EQUAL("foo", r.errors.front());
+  JUST_ASSERT(!e.evaluated());
+}
+
+JUST_TEST_CASE(test_subprocess_evaluator_returns_exceptions_of_the_factory)
+{
+  subprocess_evaluator
+    e(
+      [] (const std::string&) -> subprocess_evaluator::evaluator
+      {
+        throw exception("invalid environment");
+      },
+      0,
+      0,
+      nullptr
+    );
+
+  const result r = e.evaluate("int", "env", env);
+
+  JUST_ASSERT_EQUAL(1u, r.errors.size());
+  JUST_ASSERT_EQUAL("invalid environment", r.errors.front());
+}
+
+JUST_TEST_CASE(test_subprocess_evaluator_times_out)
+{
+  subprocess_evaluator
+    e(
+      always([] (const std::string&) -> result { for (;;) { sleep(1); } }),
+      1,
+      0,
+      nullptr
+    );
+
+  JUST_ASSERT(fails(e));
+}
+
+JUST_TEST_CASE(test_subprocess_evaluator_survives_a_crash)
+{
+  subprocess_evaluator
+    e(
+      [] (const std::string& env_) -> subprocess_evaluator::evaluator
+      {
+        if (env_ == "crash")
+        {
+          return [] (const std::string&) -> result { std::abort(); };
+        }
+        else
+        {
+          return echo;
+        }
+      },
+      0,
+      0,
+      nullptr
+    );
+
+  JUST_ASSERT(
+    e.evaluate("int", "env1", [] { return std::string("crash"); })
+      .has_errors()
+  );
+  JUST_ASSERT(!e.evaluated());
+  JUST_ASSERT_EQUAL("int", e.evaluate("int", "env2", env).output);
+  JUST_ASSERT(e.evaluated());
+}
+
+JUST_TEST_CASE(test_subprocess_evaluator_reuses_the_child_process)
+{
+  subprocess_evaluator e(always(pid_of_evaluator), 0, 0, nullptr);
+
+  const std::string pid1 = e.evaluate("a", "env", env).output;
+  const std::string pid2 = e.evaluate("b", "env", env).output;
+  const std::string pid3 = e.evaluate("c", "env2", env).output;
+
+  JUST_ASSERT_EQUAL(pid1, pid2);
+  JUST_ASSERT_EQUAL(pid1, pid3);
+  JUST_ASSERT_NOT_EQUAL(boost::lexical_cast<std::string>(getpid()), pid1);
+}
+
+JUST_TEST_CASE(test_subprocess_evaluator_does_not_inherit_file_descriptors)
+{
+  int fds[2];
+  JUST_ASSERT_EQUAL(0, pipe(fds));
+
+  subprocess_evaluator e(always(echo), 0, 0, nullptr);
+  close(fds[1]);
+
+  // The end of the pipe is reached when the launcher process has closed its
+  // copy of the write end as well
+  pollfd p;
+  p.fd = fds[0];
+  p.events = POLLIN;
+  p.revents = 0;
+  char c;
+  JUST_ASSERT_EQUAL(1, poll(&p, 1, 10000));
+  JUST_ASSERT_EQUAL(0, read(fds[0], &c, 1));
+  close(fds[0]);
+
+  JUST_ASSERT_EQUAL("int", e.evaluate("int", "env", env).output);
+}
+
+#endif
+
@@ -0,0 +1,232 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/exception.hpp>
+#include <metashell/templight_trace_reader.hpp>
+
+#include <just/test.hpp>
+
+#include <fstream>
+#include <mutex>
+#include <string>
+
+using namespace metashell;
+
+namespace
+{
+  const std::string xml_header =
+    "<?xml version=\"1.0\" standalone=\"yes\"?>\n<Trace>\n";
+
+  std::string xml_template_begin(int n_)
+  {
+    const std::string name = "foo<" + std::to_string(n_) + ">";
+    return
+      "<TemplateBegin>\n"
+      "<Kind>TemplateInstantiation</Kind>\n"
+      "<Context context = \"" + name + "\"/>\n"
+      "<PointOfInstantiation>foo.hpp|1|2</PointOfInstantiation>\n"
+      "<TimeStamp time = \"1.0\"/>\n"
+      "<MemoryUsage bytes = \"0\"/>\n"
+      "</TemplateBegin>\n";
+  }
+
+  const std::string xml_template_end =
+    "<TemplateEnd>\n"
+    "<Kind>TemplateInstantiation</Kind>\n"
+    "<TimeStamp time = \"2.0\"/>\n"
+    "<MemoryUsage bytes = \"0\"/>\n"
+    "</TemplateEnd>\n";
+
+  std::string xml_event(int n_)
+  {
+    return xml_template_begin(n_) + xml_template_end;
+  }
+
+  // Writes the trace the way templight does
+  void write_trace(
+    const templight_trace_reader& reader_,
+    const std::string& trace_
+  )
+  {
+    std::ofstream f(reader_.get_path().c_str(), std::ios::binary);
+    f << trace_;
+  }
+
+  // Waits for the end of the trace
+  void load(templight_trace_reader& reader_, metaprogram& mp_)
+  {
+    std::lock_guard<templight_trace_reader> lock(reader_);
+    mp_.set_loader(&reader_);
+    mp_.wait_until_loaded(mp_.get_root_vertex());
+  }
+}
+
+JUST_TEST_CASE(test_templight_trace_reader_xml)
+{
+  metaprogram mp(false, "some_type", type("the_result_type"));
+  templight_trace_reader reader(false, mp);
+
+  std::string trace = xml_header;
+  // It does not fit into the buffer of a pipe
+  for (int i = 0; i != 1000; ++i)
+  {
+    trace += xml_event(i);
+  }
+  trace += "</Trace>\n";
+  write_trace(reader, trace);
+
+  JUST_ASSERT(reader.evaluation_finished());
+  load(reader, mp);
+
+  std::lock_guard<templight_trace_reader> lock(reader);
+  JUST_ASSERT(reader.is_loaded());
+  JUST_ASSERT(!reader.take_error());
+  JUST_ASSERT_EQUAL(mp.get_num_vertices(), 1001u);
+}
+
+JUST_TEST_CASE(test_templight_trace_reader_binary)
+{
+  metaprogram mp(false, "some_type", type("the_result_type"));
+  templight_trace_reader reader(true, mp);
+
+  write_trace(
+    reader,
+    std::string("TMPLBIN\0\2\0\0\0", 12)
+    + std::string("\2\0\0\0\3\0\0\0foo", 11)
+    + std::string("\1\0\0\0\0\0\0\0\0\0\0\0\1\0\0\0\1\0\0\0", 20)
+    + std::string(20, '\0')
+    + std::string(40, '\0')
+    + std::string("\3\0\0\0\2\0\0\0", 8)
+  );
+
+  JUST_ASSERT(reader.evaluation_finished());
+  load(reader, mp);
+
+  std::lock_guard<templight_trace_reader> lock(reader);
+  JUST_ASSERT(!reader.take_error());
+  JUST_ASSERT_EQUAL(mp.get_num_vertices(), 2u);
+  JUST_ASSERT_EQUAL(mp.get_vertex_name(1), "foo");
+}
+
+JUST_TEST_CASE(test_templight_trace_reader_binary_not_supported)
+{
+  metaprogram mp(false, "some_type", type("the_result_type"));
+  templight_trace_reader reader(true, mp);
+
+  write_trace(reader, xml_header + xml_event(0) + "</Trace>\n");
+
+  JUST_ASSERT(!reader.evaluation_finished());
+}
+
+JUST_TEST_CASE(test_templight_trace_reader_invalid_trace)
+{
+  metaprogram mp(false, "some_type", type("the_result_type"));
+  templight_trace_reader reader(false, mp);
+
+  write_trace(reader, "<Trace>\n<TemplateEnd>\n</TemplateEnd>\n</Trace>\n");
+
+  JUST_ASSERT(reader.evaluation_finished());
+  load(reader, mp);
+
+  std::lock_guard<templight_trace_reader> lock(reader);
+  JUST_ASSERT(reader.is_loaded());
+  JUST_ASSERT(bool(reader.take_error()));
+  JUST_ASSERT(!reader.take_error());
+}
+
+JUST_TEST_CASE(test_templight_trace_reader_nothing_written)
+{
+  metaprogram mp(false, "some_type", type("the_result_type"));
+  templight_trace_reader reader(true, mp);
+
+  JUST_ASSERT(!reader.evaluation_finished());
+}
+
+JUST_TEST_CASE(test_templight_trace_reader_edge_added_is_called)
+{
+  metaprogram mp(false, "some_type", type("the_result_type"));
+  int edges = 0;
+  templight_trace_reader
+    reader(false, mp, [&edges](metaprogram::edge_descriptor) { ++edges; });
+
+  write_trace(
+    reader,
+    xml_header + xml_event(0) + xml_event(1) + xml_event(0) + "</Trace>\n"
+  );
+
+  JUST_ASSERT(reader.evaluation_finished());
+  load(reader, mp);
+
+  JUST_ASSERT_EQUAL(edges, 3);
+}
+
+JUST_TEST_CASE(test_templight_trace_reader_step_while_trace_is_written)
+{
+  metaprogram mp(false, "some_type", type("the_result_type"));
+  templight_trace_reader reader(false, mp);
+
+  std::ofstream f(reader.get_path().c_str(), std::ios::binary);
+  f << xml_header << xml_template_begin(0) << std::flush;
+
+  {
+    std::lock_guard<templight_trace_reader> lock(reader);
+    mp.set_loader(&reader);
+
+    // It waits until the first event arrives
+    mp.step();
+    JUST_ASSERT_EQUAL(
+      mp.get_vertex_name(mp.get_current_vertex()),
+      "foo<0>"
+    );
+    JUST_ASSERT(!reader.is_loaded());
+  }
+
+  f << xml_template_end << "</Trace>\n";
+  f.close();
+
+  JUST_ASSERT(reader.evaluation_finished());
+
+  std::lock_guard<templight_trace_reader> lock(reader);
+  mp.step();
+  JUST_ASSERT(mp.is_finished());
+  JUST_ASSERT(reader.is_loaded());
+  JUST_ASSERT(!reader.take_error());
+}
+
+JUST_TEST_CASE(test_templight_trace_reader_trace_larger_than_the_queue)
+{
+  metaprogram mp(false, "some_type", type("the_result_type"));
+  templight_trace_reader reader(false, mp);
+
+  // Templight is blocked while the builder catches up
+  {
+    std::ofstream f(reader.get_path().c_str(), std::ios::binary);
+    f << xml_header;
+    for (int i = 0; i != 40000; ++i)
+    {
+      f << xml_event(i % 100);
+    }
+    f << "</Trace>\n";
+  }
+
+  JUST_ASSERT(reader.evaluation_finished());
+  load(reader, mp);
+
+  std::lock_guard<templight_trace_reader> lock(reader);
+  JUST_ASSERT(reader.is_loaded());
+  JUST_ASSERT(!reader.take_error());
+  JUST_ASSERT_EQUAL(mp.get_num_vertices(), 101u);
+}
@@ -0,0 +1,111 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2015, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/xml_pull_parser.hpp>
+#include <metashell/exception.hpp>
+
+#include <just/test.hpp>
+
+#include <sstream>
+
+using namespace metashell;
+
+namespace
+{
+  typedef xml_pull_parser::token token;
+}
+
+JUST_TEST_CASE(test_xml_pull_parser_reads_elements_and_text)
+{
+  std::istringstream s(
+    "<?xml version=\"1.0\" standalone=\"yes\"?>\n"
+    "<!-- comment --><a><b>foo</b></a>"
+  );
+  xml_pull_parser p(s);
+
+  JUST_ASSERT(token::text == p.next());
+  JUST_ASSERT_EQUAL("\n", p.text());
+  JUST_ASSERT(token::start_element == p.next());
+  JUST_ASSERT_EQUAL("a", p.name());
+  JUST_ASSERT(token::start_element == p.next());
+  JUST_ASSERT_EQUAL("b", p.name());
+  JUST_ASSERT(token::text == p.next());
+  JUST_ASSERT_EQUAL("foo", p.text());
+  JUST_ASSERT(token::end_element == p.next());
+  JUST_ASSERT_EQUAL("b", p.name());
+  JUST_ASSERT(token::end_element == p.next());
+  JUST_ASSERT_EQUAL("a", p.name());
+  JUST_ASSERT(token::end_of_document == p.next());
+}
+
+JUST_TEST_CASE(test_xml_pull_parser_reads_attributes_of_empty_element)
+{
+  std::istringstream s("<a x = \"1\" y='&lt;2&gt;'/>");
+  xml_pull_parser p(s);
+
+  JUST_ASSERT(token::start_element == p.next());
+  JUST_ASSERT_EQUAL("1", *p.attribute("x"));
+  JUST_ASSERT_EQUAL("<2>", *p.attribute("y"));
+  JUST_ASSERT(p.attribute("z") == nullptr);
+  JUST_ASSERT(token::end_element == p.next());
+  JUST_ASSERT_EQUAL("a", p.name());
+  JUST_ASSERT(token::end_of_document == p.next());
+}
+
+JUST_TEST_CASE(test_xml_pull_parser_decodes_entities)
+{
+  std::istringstream s("<a>&amp;&quot;&apos;&#65;&#x42;&#xe9;</a>");
+  xml_pull_parser p(s);
+
+  p.next();
+  JUST_ASSERT(token::text == p.next());
+  JUST_ASSERT_EQUAL("&\"'AB\xc3\xa9", p.text());
+}
+
+JUST_TEST_CASE(test_xml_pull_parser_reads_cdata)
+{
+  std::istringstream s("<a><![CDATA[<b>]]></a>");
+  xml_pull_parser p(s);
+
+  p.next();
+  JUST_ASSERT(token::text == p.next());
+  JUST_ASSERT_EQUAL("<b>", p.text());
+}
+
+JUST_TEST_CASE(test_xml_pull_parser_skips_comment_ending_with_dashes)
+{
+  std::istringstream s("<!-- x --->");
+  xml_pull_parser p(s);
+
+  JUST_ASSERT(token::end_of_document == p.next());
+}
+
+JUST_TEST_CASE(test_xml_pull_parser_reports_unknown_entity)
+{
+  std::istringstream s("<a>&foo;</a>");
+  xml_pull_parser p(s);
+
+  p.next();
+  JUST_ASSERT_THROWS(exception, p.next());
+}
+
+JUST_TEST_CASE(test_xml_pull_parser_reports_unterminated_attribute)
+{
+  std::istringstream s("<a x=\"1");
+  xml_pull_parser p(s);
+
+  JUST_ASSERT_THROWS(exception, p.next());
+}